@@ -1,6 +1,6 @@
 include(GNUInstallDirs)
 
-set(INSTALL_TARGETS psm psm_srgb) # Always include core psm and psm_srgb
+set(INSTALL_TARGETS psm psm_core psm_srgb) # Always include core psm targets
 
 foreach(module ${PSM_MODULES})
   string(TOUPPER "${module}" MODULE_UPPER)
@@ -4,6 +4,12 @@ set(PSM_MODULES adjust_channels orgb adobe_rgb display_p3 pro_photo_rgb)
 option(BUILD_PSM_CLI "Build the PSM CLI tool" ON)
 option(BUILD_PSM_GUI "Build the PSM GUI tool" ON)
 
+# Option to compile in the psm::metrics performance counters
+option(ENABLE_PSM_METRICS "Collect psm::metrics performance counters" OFF)
+
+# Option to emit USDT tracepoints for bpftrace/perf (Linux, needs sys/sdt.h)
+option(ENABLE_PSM_USDT "Emit USDT tracepoints on conversion hot paths" OFF)
+
 # Dynamically create WITH_<module> options
 foreach(module ${PSM_MODULES})
   string(TOUPPER "${module}" MODULE_UPPER) # Convert to uppercase for
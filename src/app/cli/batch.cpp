@@ -0,0 +1,719 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.hpp"
+#include "image_processor/image_processor.hpp"
+#include "output_cache.hpp"
+
+namespace psm_cli {
+
+namespace {
+namespace fs = std::filesystem;
+
+// Bytes of decoded images in flight across all workers
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t limit) : limit_(limit) {}
+
+  // Waits until @p bytes fit next to the images in flight; an image larger
+  // than the whole budget is admitted once nothing else is in flight
+  void acquire(size_t bytes) {
+    std::unique_lock lock(mutex_);
+    released_.wait(lock, [&] {
+      return in_flight_ == 0 || in_flight_ + bytes <= limit_;
+    });
+    in_flight_ += bytes;
+  }
+
+  void release(size_t bytes) {
+    {
+      std::lock_guard lock(mutex_);
+      in_flight_ -= bytes;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  size_t limit_;
+  size_t in_flight_ = 0;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+class BudgetReservation {
+ public:
+  BudgetReservation(MemoryBudget& budget, size_t bytes)
+      : budget_(budget), bytes_(bytes) {
+    budget_.acquire(bytes_);
+  }
+  ~BudgetReservation() { budget_.release(bytes_); }
+
+  BudgetReservation(const BudgetReservation&) = delete;
+  BudgetReservation& operator=(const BudgetReservation&) = delete;
+
+ private:
+  MemoryBudget& budget_;
+  size_t bytes_;
+};
+
+// Upper bound on the memory one image needs while it is converted: the
+// decoded image and the processed output, plus the adjustment buffer when
+// adjusting in another space, a few rows when streaming, or the pool of tiles
+// (an input and an output band each, two per thread plus two) when tiling. A
+// crop shrinks the decoded image; a resize adds its float buffer of the input
+// rows at the output width, and the output is then at the resized size
+size_t estimate_image_bytes(const CLIOptions& options) {
+  const ImageInfo info = read_image_info(options.input_file);
+  const size_t channels = load_options(options).keep_alpha ? 4 : 3;
+  const size_t pixel_bytes =
+      channels * static_cast<size_t>(info.bit_depth / 8);
+  if (options.stream) {
+    return static_cast<size_t>(info.width) * pixel_bytes * 4;
+  }
+  if (options.tiled) {
+    constexpr size_t kTileBytes = size_t{8} << 20;
+    const size_t threads = static_cast<size_t>(
+        options.jobs > 0 ? options.jobs
+                         : std::max(std::thread::hardware_concurrency(), 1u));
+    const size_t tile_bytes =
+        std::max(kTileBytes, static_cast<size_t>(info.width) * pixel_bytes);
+    return (2 * threads + 2) * 2 * tile_bytes;
+  }
+
+  int width = info.width;
+  int height = info.height;
+  if (options.crop) {
+    width = std::min(width, options.crop->width);
+    height = std::min(height, options.crop->height);
+  }
+  const size_t decoded_bytes =
+      static_cast<size_t>(width) * height * pixel_bytes;
+  const size_t copies =
+      options.adjust_values && options.from_space != options.to_space ? 3 : 2;
+  if (!options.resize) {
+    return decoded_bytes * copies;
+  }
+  const auto [resized_width, resized_height] =
+      resized_size(*options.resize, width, height);
+  const size_t filter_bytes = static_cast<size_t>(resized_width) * height *
+                              channels * sizeof(float);
+  return decoded_bytes + filter_bytes +
+         static_cast<size_t>(resized_width) * resized_height * pixel_bytes *
+             copies;
+}
+
+uintmax_t file_size_or_zero(const std::string& path) {
+  std::error_code error;
+  const uintmax_t size = fs::file_size(path, error);
+  return error ? 0 : size;
+}
+
+struct BatchStats {
+  std::atomic<size_t> converted{0};
+  std::atomic<uintmax_t> bytes_read{0};
+  std::atomic<uintmax_t> bytes_written{0};
+  std::atomic<size_t> cache_hits{0};
+  std::atomic<size_t> cache_misses{0};
+  StatsWriter* writer = nullptr;  ///< --stats records, if requested
+
+  std::mutex failures_mutex;
+  std::vector<std::pair<std::string, std::string>> failures;
+
+  void succeed(const BatchJob& job, const PipelineImage& image) {
+    converted++;
+    bytes_read += file_size_or_zero(job.input_file);
+    bytes_written += file_size_or_zero(job.output_file);
+    if (writer) {
+      writer->image(image);
+    }
+  }
+
+  void fail(const BatchJob& job, const PipelineImage& image,
+            const std::exception& e) {
+    std::cerr << std::format("Failed to convert {}: {}\n", job.input_file,
+                             e.what());
+    if (writer) {
+      writer->image(image, e.what());
+    }
+    std::lock_guard lock(failures_mutex);
+    failures.emplace_back(job.input_file, e.what());
+  }
+};
+
+// Sets up @p image for @p job; its options are set even if creating the
+// output directory throws, so the failure is reported with the job's files
+void start_image(const CLIOptions& options, const BatchJob& job,
+                 PipelineImage& image) {
+  image.options = options;
+  image.options.input_file = job.input_file;
+  image.options.output_file = job.output_file;
+
+  const fs::path parent = fs::path(job.output_file).parent_path();
+  if (!parent.empty()) {
+    fs::create_directories(parent);
+  }
+}
+
+// Restores the job's output from @p cache; on a miss returns the key to
+// store the output under once it is written
+std::optional<std::string> restore_output(const OutputCache& cache,
+                                          PipelineImage& image,
+                                          const BatchJob& job,
+                                          BatchStats& stats) {
+  std::string key = cache.key(image.options);
+  if (!key.empty() && cache.restore(key, job.output_file)) {
+    stats.cache_hits++;
+    image.stats.cached = true;
+    stats.succeed(job, image);
+    return std::nullopt;
+  }
+  stats.cache_misses++;
+  return key;
+}
+
+void store_output(const OutputCache* cache, const std::string& key,
+                  const BatchJob& job) {
+  if (cache && !key.empty()) {
+    cache->store(key, job.output_file);
+  }
+}
+
+void convert_one(const CLIOptions& options, const BatchJob& job,
+                 const ImageStages& stages, ImageDecoder& decoder,
+                 ImageEncoder& encoder, MemoryBudget* budget,
+                 const OutputCache* cache, BatchStats& stats) {
+  PipelineImage image;
+  try {
+    start_image(options, job, image);
+    std::string cache_key;
+    if (cache) {
+      std::optional<std::string> key =
+          restore_output(*cache, image, job, stats);
+      if (!key) {
+        return;
+      }
+      cache_key = std::move(*key);
+    }
+    if (budget) {
+      const BudgetReservation reservation(
+          *budget, estimate_image_bytes(image.options));
+      run_stages(stages, image, decoder, encoder);
+    } else {
+      run_stages(stages, image, decoder, encoder);
+    }
+    store_output(cache, cache_key, job);
+    stats.succeed(job, image);
+  } catch (const std::exception& e) {
+    stats.fail(job, image, e);
+  }
+}
+
+// An image in the pipeline, with the memory it reserved until it is written
+struct PipelineItem {
+  const BatchJob* job = nullptr;
+  PipelineImage image;
+  std::string cache_key;  ///< Where the output goes in the cache, if any
+  std::optional<BudgetReservation> reservation;
+};
+
+using ItemQueue = BoundedQueue<std::unique_ptr<PipelineItem>>;
+
+// Nanoseconds the threads of one stage spent working, waiting for an image
+// from the stage before, and held back by a full queue or the memory budget
+struct StageTimes {
+  std::atomic<int64_t> busy{0};
+  std::atomic<int64_t> starved{0};
+  std::atomic<int64_t> blocked{0};
+};
+
+class Stopwatch {
+ public:
+  // Nanoseconds since the previous lap
+  int64_t lap() {
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = now - last_;
+    last_ = now;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point last_ =
+      std::chrono::steady_clock::now();
+};
+
+// Decodes the next images of @p jobs and hands them to @p output
+void decode_stage(const CLIOptions& options, const std::vector<BatchJob>& jobs,
+                  std::atomic<size_t>& next, const ImageStages& stages,
+                  MemoryBudget* budget, const OutputCache* cache,
+                  ItemQueue& output, StageTimes& times, BatchStats& stats) {
+  ImageDecoder decoder;
+  Stopwatch stopwatch;
+  for (size_t i = next++; i < jobs.size(); i = next++) {
+    auto item = std::make_unique<PipelineItem>();
+    item->job = &jobs[i];
+    try {
+      start_image(options, jobs[i], item->image);
+      if (cache) {
+        std::optional<std::string> key =
+            restore_output(*cache, item->image, jobs[i], stats);
+        if (!key) {
+          times.busy += stopwatch.lap();
+          continue;
+        }
+        item->cache_key = std::move(*key);
+      }
+      if (budget) {
+        const size_t bytes = estimate_image_bytes(item->image.options);
+        times.busy += stopwatch.lap();
+        item->reservation.emplace(*budget, bytes);
+        times.blocked += stopwatch.lap();
+      }
+      stages.decode(item->image, decoder);
+    } catch (const std::exception& e) {
+      stats.fail(jobs[i], item->image, e);
+      times.busy += stopwatch.lap();
+      continue;
+    }
+    times.busy += stopwatch.lap();
+    output.push(std::move(item));
+    times.blocked += stopwatch.lap();
+  }
+}
+
+// Takes images from @p input, runs @p work on them and hands them to
+// @p output, or counts them as converted at the end of the pipeline
+template <typename Work>
+void run_stage(ItemQueue& input, ItemQueue* output, const OutputCache* cache,
+               StageTimes& times, BatchStats& stats, Work work) {
+  Stopwatch stopwatch;
+  std::unique_ptr<PipelineItem> item;
+  while (input.pop(item)) {
+    times.starved += stopwatch.lap();
+    try {
+      work(item->image);
+    } catch (const std::exception& e) {
+      stats.fail(*item->job, item->image, e);
+      item.reset();
+      times.busy += stopwatch.lap();
+      continue;
+    }
+    if (!output) {
+      store_output(cache, item->cache_key, *item->job);
+      stats.succeed(*item->job, item->image);
+      item.reset();
+      times.busy += stopwatch.lap();
+      continue;
+    }
+    times.busy += stopwatch.lap();
+    output->push(std::move(item));
+    times.blocked += stopwatch.lap();
+  }
+  times.starved += stopwatch.lap();
+}
+
+// Starts @p count threads running @p body
+template <typename Body>
+std::vector<std::jthread> start_threads(int count, const Body& body) {
+  std::vector<std::jthread> threads;
+  for (int i = 0; i < count; ++i) {
+    threads.emplace_back(body);
+  }
+  return threads;
+}
+
+void join_all(std::vector<std::jthread>& threads) {
+  for (std::jthread& thread : threads) {
+    thread.join();
+  }
+}
+
+void print_utilization(const PipelineThreads& threads,
+                       const std::array<StageTimes, 3>& times,
+                       double seconds) {
+  constexpr std::array<const char*, 3> kNames{"decode", "convert", "encode"};
+  const std::array<int, 3> counts{threads.decode, threads.convert,
+                                  threads.encode};
+
+  std::cout << "Stage utilization (busy / waiting for input / waiting for "
+               "output):\n";
+  size_t bottleneck = 0;
+  double bottleneck_busy = -1.0;
+  for (size_t stage = 0; stage < times.size(); ++stage) {
+    const double capacity =
+        std::max(seconds, 1e-9) * 1e9 * static_cast<double>(counts[stage]);
+    const auto percent = [&](const std::atomic<int64_t>& ns) {
+      return 100.0 * static_cast<double>(ns.load()) / capacity;
+    };
+    const double busy = percent(times[stage].busy);
+    std::cout << std::format(
+        "  {:<8} {} thread(s): {:5.1f}% / {:5.1f}% / {:5.1f}%\n",
+        kNames[stage], counts[stage], busy, percent(times[stage].starved),
+        percent(times[stage].blocked));
+    if (busy > bottleneck_busy) {
+      bottleneck = stage;
+      bottleneck_busy = busy;
+    }
+  }
+  std::cout << std::format("Bottleneck: {} stage\n", kNames[bottleneck]);
+}
+
+// Runs the stages on separate thread groups connected by bounded queues
+void run_pipeline(const CLIOptions& options, const std::vector<BatchJob>& jobs,
+                  const ImageStages& stages, MemoryBudget* budget,
+                  const OutputCache* cache, BatchStats& stats,
+                  std::array<StageTimes, 3>& times) {
+  const PipelineThreads& threads = *options.pipeline;
+  // One queued image per thread of the stage taking from the queue keeps
+  // every thread fed without letting a fast stage run far ahead
+  ItemQueue decoded(static_cast<size_t>(threads.convert));
+  ItemQueue converted(static_cast<size_t>(threads.encode));
+  std::atomic<size_t> next{0};
+
+  auto decoders = start_threads(threads.decode, [&] {
+    decode_stage(options, jobs, next, stages, budget, cache, decoded, times[0],
+                 stats);
+  });
+  auto converters = start_threads(threads.convert, [&] {
+    run_stage(decoded, &converted, cache, times[1], stats, stages.convert);
+  });
+  auto encoders = start_threads(threads.encode, [&] {
+    ImageEncoder encoder(options.png);
+    run_stage(converted, nullptr, cache, times[2], stats,
+              [&](PipelineImage& image) { stages.encode(image, encoder); });
+  });
+
+  join_all(decoders);
+  decoded.close();
+  join_all(converters);
+  converted.close();
+  join_all(encoders);
+}
+
+void print_summary(BatchStats& stats, size_t total, double seconds,
+                   bool cached) {
+  constexpr double kMiB = 1024.0 * 1024.0;
+  const size_t converted = stats.converted;
+  const double elapsed = std::max(seconds, 1e-9);
+
+  std::cout << std::format(
+      "Batch: {} of {} images converted, {} failed in {:.2f} s\n", converted,
+      total, stats.failures.size(), seconds);
+  std::cout << std::format(
+      "Throughput: {:.1f} images/s, {:.1f} MiB/s read, {:.1f} MiB/s "
+      "written\n",
+      static_cast<double>(converted) / elapsed,
+      static_cast<double>(stats.bytes_read) / kMiB / elapsed,
+      static_cast<double>(stats.bytes_written) / kMiB / elapsed);
+  if (cached) {
+    const size_t lookups = stats.cache_hits + stats.cache_misses;
+    std::cout << std::format(
+        "Cache: {} hits, {} misses ({:.1f}% hit rate)\n",
+        stats.cache_hits.load(), stats.cache_misses.load(),
+        lookups ? 100.0 * static_cast<double>(stats.cache_hits) /
+                      static_cast<double>(lookups)
+                : 0.0);
+  }
+
+  if (!stats.failures.empty()) {
+    std::sort(stats.failures.begin(), stats.failures.end());
+    std::cerr << "Failed images:\n";
+    for (const auto& [input, message] : stats.failures) {
+      std::cerr << std::format("  {}: {}\n", input, message);
+    }
+  }
+}
+
+void append_matching(const fs::path& directory, std::string_view pattern,
+                     std::vector<std::string>& inputs) {
+  std::error_code error;
+  fs::directory_iterator entries(directory.empty() ? "." : directory, error);
+  if (error) {
+    throw std::runtime_error(std::format("Cannot read directory {}: {}",
+                                         directory.string(), error.message()));
+  }
+
+  std::vector<std::string> matches;
+  for (const auto& entry : entries) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    const std::string name = entry.path().filename().string();
+    const bool matches_pattern = pattern.empty()
+                                     ? detect_format(name) !=
+                                           ImageFormat::UNKNOWN
+                                     : wildcard_match(pattern, name);
+    if (matches_pattern) {
+      matches.push_back((directory / name).string());
+    }
+  }
+  std::sort(matches.begin(), matches.end());
+  inputs.insert(inputs.end(), matches.begin(), matches.end());
+}
+
+void append_list(const std::string& list_file,
+                 std::vector<std::string>& inputs) {
+  std::ifstream list(list_file);
+  if (!list) {
+    throw std::runtime_error(
+        std::format("Cannot read input list: {}", list_file));
+  }
+
+  std::string line;
+  while (std::getline(list, line)) {
+    const auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    const auto last = line.find_last_not_of(" \t\r");
+    inputs.push_back(line.substr(first, last - first + 1));
+  }
+}
+
+void replace_all(std::string& text, std::string_view from,
+                 std::string_view to) {
+  for (size_t pos = text.find(from); pos != std::string::npos;
+       pos = text.find(from, pos + to.size())) {
+    text.replace(pos, from.size(), to);
+  }
+}
+}  // anonymous namespace
+
+bool is_batch(const CLIOptions& options) {
+  return !options.input_dir.empty() || !options.input_list.empty() ||
+         has_wildcards(options.input_file);
+}
+
+bool has_wildcards(const std::string& path) {
+  return path.find_first_of("*?") != std::string::npos;
+}
+
+bool wildcard_match(std::string_view pattern, std::string_view name) {
+  // Greedy matching with backtracking to the last '*'
+  size_t p = 0;
+  size_t n = 0;
+  size_t star = std::string_view::npos;
+  size_t star_n = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      ++p;
+      ++n;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      star_n = n;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      n = ++star_n;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+std::string expand_output_template(const std::string& output_template,
+                                   const std::string& input_file,
+                                   size_t index) {
+  std::string result = output_template;
+  const bool has_placeholder =
+      result.find("{name}") != std::string::npos ||
+      result.find("{index}") != std::string::npos;
+  std::error_code error;
+  if (fs::is_directory(output_template, error) ||
+      output_template.ends_with('/') || output_template.ends_with('\\') ||
+      (!has_placeholder && !fs::path(output_template).has_extension())) {
+    result = (fs::path(output_template) / "{name}.{ext}").string();
+  } else if (!has_placeholder) {
+    throw std::invalid_argument(std::format(
+        "Output template must contain {{name}} or {{index}}: {}",
+        output_template));
+  }
+
+  const fs::path input(input_file);
+  std::string extension = input.extension().string();
+  if (!extension.empty()) {
+    extension.erase(0, 1);
+  }
+  replace_all(result, "{name}", input.stem().string());
+  replace_all(result, "{ext}", extension);
+  replace_all(result, "{dir}", input.parent_path().string());
+  replace_all(result, "{index}", std::to_string(index));
+  return result;
+}
+
+std::vector<BatchJob> collect_batch_jobs(const CLIOptions& options) {
+  if (is_stdio_path(options.output_file)) {
+    throw std::invalid_argument("A batch cannot be written to stdout");
+  }
+
+  std::vector<std::string> inputs;
+  if (has_wildcards(options.input_file)) {
+    const fs::path pattern(options.input_file);
+    if (has_wildcards(pattern.parent_path().string())) {
+      throw std::invalid_argument(std::format(
+          "Wildcards are only supported in the file name: {}",
+          options.input_file));
+    }
+    append_matching(pattern.parent_path(), pattern.filename().string(),
+                    inputs);
+  } else if (!options.input_file.empty()) {
+    inputs.push_back(options.input_file);
+  }
+  if (!options.input_dir.empty()) {
+    append_matching(options.input_dir, {}, inputs);
+  }
+  if (!options.input_list.empty()) {
+    append_list(options.input_list, inputs);
+  }
+
+  std::vector<BatchJob> jobs;
+  std::map<std::string, std::string> output_owners;
+  for (const std::string& input : inputs) {
+    BatchJob job{input,
+                 expand_output_template(options.output_file, input,
+                                        jobs.size())};
+    const auto [owner, inserted] =
+        output_owners.emplace(job.output_file, input);
+    if (!inserted) {
+      throw std::invalid_argument(
+          std::format("{} and {} would both be written to {}",
+                      owner->second, input, job.output_file));
+    }
+    jobs.push_back(std::move(job));
+  }
+  return jobs;
+}
+
+ImageStages timed_stages(const ImageStages& stages) {
+  return ImageStages{
+      .decode =
+          [decode = stages.decode](PipelineImage& image,
+                                   ImageDecoder& decoder) {
+            const StageTimer timer(image.stats.stages[0]);
+            decode(image, decoder);
+          },
+      // A one-pass image was converted and encoded within the decode stage,
+      // so nothing is left to time
+      .convert =
+          [convert = stages.convert](PipelineImage& image) {
+            if (image.one_pass) {
+              return;
+            }
+            const StageTimer timer(image.stats.stages[1]);
+            convert(image);
+          },
+      .encode =
+          [encode = stages.encode](PipelineImage& image,
+                                   ImageEncoder& encoder) {
+            if (image.one_pass) {
+              return;
+            }
+            const StageTimer timer(image.stats.stages[2]);
+            encode(image, encoder);
+          }};
+}
+
+void run_stages(const ImageStages& stages, PipelineImage& image,
+                ImageDecoder& decoder, ImageEncoder& encoder) {
+  stages.decode(image, decoder);
+  stages.convert(image);
+  stages.encode(image, encoder);
+}
+
+int run_batch(const CLIOptions& options, const ImageStages& untimed_stages,
+              StatsWriter* stats_writer) {
+  const ImageStages stages =
+      stats_writer ? timed_stages(untimed_stages) : untimed_stages;
+  const std::vector<BatchJob> jobs = collect_batch_jobs(options);
+  if (jobs.empty()) {
+    std::cerr << "No input images found\n";
+    return 1;
+  }
+
+  std::optional<MemoryBudget> budget;
+  if (options.memory_budget_mb > 0) {
+    budget.emplace(options.memory_budget_mb * size_t{1024 * 1024});
+  }
+
+  std::optional<OutputCache> cache;
+  if (!options.cache_dir.empty()) {
+    cache.emplace(options.cache_dir);
+  }
+
+  BatchStats stats;
+  stats.writer = stats_writer;
+  std::array<StageTimes, 3> stage_times;
+  const auto start = std::chrono::steady_clock::now();
+  if (options.pipeline) {
+    if (options.jobs > 0) {
+      std::cout << "--jobs has no effect with --pipeline\n";
+    }
+    std::cout << std::format(
+        "Converting {} images in a pipeline of {} decode, {} convert and {} "
+        "encode threads\n",
+        jobs.size(), options.pipeline->decode, options.pipeline->convert,
+        options.pipeline->encode);
+    run_pipeline(options, jobs, stages, budget ? &*budget : nullptr,
+                 cache ? &*cache : nullptr, stats, stage_times);
+  } else {
+    const size_t workers = std::min(
+        jobs.size(),
+        static_cast<size_t>(options.jobs > 0
+                                ? options.jobs
+                                : std::max(std::thread::hardware_concurrency(),
+                                           1u)));
+    std::cout << std::format("Converting {} images on {} workers\n",
+                             jobs.size(), workers);
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+      ImageDecoder decoder;
+      ImageEncoder encoder(options.png);
+      for (size_t i = next++; i < jobs.size(); i = next++) {
+        convert_one(options, jobs[i], stages, decoder, encoder,
+                    budget ? &*budget : nullptr, cache ? &*cache : nullptr,
+                    stats);
+      }
+    };
+
+    std::vector<std::jthread> pool;
+    for (size_t i = 1; i < workers; ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    join_all(pool);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  print_summary(stats, jobs.size(), elapsed.count(), cache.has_value());
+  if (options.pipeline) {
+    print_utilization(*options.pipeline, stage_times, elapsed.count());
+  }
+  if (stats_writer) {
+    stats_writer->run(elapsed.count());
+  }
+  return stats.failures.empty() ? 0 : 1;
+}
+
+}  // namespace psm_cli
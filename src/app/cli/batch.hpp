@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cli_parser.hpp"
+#include "image_io/image_io.hpp"
+#include "image_processor/image_processor.hpp"
+#include "run_stats.hpp"
+
+namespace psm_cli {
+
+/// One input image of a batch and the file it is converted to
+struct BatchJob {
+  std::string input_file;
+  std::string output_file;
+};
+
+/// One image on its way through the decode, convert and encode stages
+struct PipelineImage {
+  CLIOptions options;  ///< The options with this image's input and output
+  ImageVariant image;  ///< The decoded image, replaced by the processed one
+  std::optional<YCbCrImage> ycbcr;  ///< The decoded planes with --ycbcr
+  /// What the decode stage read when it wrote the image in one pass
+  std::optional<PassInfo> one_pass;
+  ImageStats stats;  ///< Stage times, filled in by timed_stages
+};
+
+/**
+ * @brief The conversion of one image, split into the stages a pipelined batch
+ * runs on separate threads
+ *
+ * Each stage throws std::exception on failure, which fails only that image.
+ * Images the decode stage converts in one pass (tiled, streamed or mapped)
+ * get a one_pass and are skipped by the later stages.
+ */
+struct ImageStages {
+  /// Reads and decodes options.input_file
+  std::function<void(PipelineImage& image, ImageDecoder& decoder)> decode;
+  /// Converts and adjusts the decoded image in memory
+  std::function<void(PipelineImage& image)> convert;
+  /// Encodes and writes options.output_file
+  std::function<void(PipelineImage& image, ImageEncoder& encoder)> encode;
+};
+
+/// Runs the stages of @p stages on @p image one after the other
+void run_stages(const ImageStages& stages, PipelineImage& image,
+                ImageDecoder& decoder, ImageEncoder& encoder);
+
+/// @p stages with each stage adding its wall and CPU time to image.stats
+ImageStages timed_stages(const ImageStages& stages);
+
+/// True if -i is a wildcard pattern or --input-dir/--input-list is given
+bool is_batch(const CLIOptions& options);
+
+/// True if @p path contains a '*' or '?' wildcard
+bool has_wildcards(const std::string& path);
+
+/**
+ * @brief Matches a file name against a pattern where '*' matches any run of
+ * characters and '?' matches one character
+ */
+bool wildcard_match(std::string_view pattern, std::string_view name);
+
+/**
+ * @brief Output path of the @p index-th input under an output template
+ *
+ * {name} is replaced by the input's file name without extension, {ext} by its
+ * extension without the dot, {dir} by its directory and {index} by
+ * @p index. An existing directory, a template ending in a path separator, or
+ * one with no placeholder and no extension stands for
+ * "<template>/{name}.{ext}".
+ *
+ * @throws std::invalid_argument if the template has neither {name} nor
+ * {index}, so every input would get the same output
+ */
+std::string expand_output_template(const std::string& output_template,
+                                   const std::string& input_file,
+                                   std::size_t index);
+
+/**
+ * @brief Inputs of a batch with their outputs, in sorted order
+ *
+ * Collects the files matching a wildcard -i, the supported images in
+ * --input-dir (not recursive) and the paths listed in --input-list (one per
+ * line; blank lines and lines starting with '#' are skipped).
+ *
+ * @throws std::runtime_error if a directory or list cannot be read
+ * @throws std::invalid_argument if the output is stdout
+ */
+std::vector<BatchJob> collect_batch_jobs(const CLIOptions& options);
+
+/**
+ * @brief Converts every input of the batch with @p stages
+ *
+ * By default options.jobs workers (0 = one per core) each run all stages of
+ * one image at a time, keeping an ImageDecoder and an ImageEncoder for all
+ * the images they convert. With options.pipeline the stages run on separate
+ * groups of threads instead, connected by BoundedQueue: decoding the next
+ * images overlaps with converting and encoding earlier ones, and a full queue
+ * holds back the stage before it, so at most one image per thread plus the
+ * queued ones are in memory. The utilization of each stage is printed so the
+ * stage that limits throughput stands out.
+ *
+ * With options.memory_budget_mb set, an image waits before decoding until the
+ * estimated memory of the images in flight, its own included, fits the
+ * budget; an image larger than the whole budget still runs, alone. A failing
+ * image is reported and counted without stopping the batch. A summary with
+ * throughput is printed at the end.
+ *
+ * With options.cache_dir set, each image is first looked up in an
+ * OutputCache; a hit links or copies the earlier output into place and skips
+ * every stage, and a converted output is added to the cache. The summary
+ * then includes the hits and misses.
+ *
+ * With @p stats_writer, the stages are timed and every image and the run
+ * get a record.
+ *
+ * @return 0 if every image was converted, 1 otherwise
+ */
+int run_batch(const CLIOptions& options, const ImageStages& stages,
+              StatsWriter* stats_writer = nullptr);
+
+}  // namespace psm_cli
@@ -0,0 +1,198 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "image_io/image_io.hpp"
+#include "image_processor/image_processor.hpp"
+
+namespace psm_cli {
+
+namespace {
+// Runs work(band) for every band on a fixed set of threads, band 0 on the
+// calling thread, so that timing a run does not include starting threads
+class BandRunner {
+ public:
+  explicit BandRunner(int threads)
+      : start_(threads), done_(threads), errors_(threads) {
+    for (int band = 1; band < threads; ++band) {
+      workers_.emplace_back([this, band] {
+        for (;;) {
+          start_.arrive_and_wait();
+          if (stop_) {
+            return;
+          }
+          run_band(band);
+          done_.arrive_and_wait();
+        }
+      });
+    }
+  }
+
+  ~BandRunner() {
+    stop_ = true;
+    start_.arrive_and_wait();
+  }
+
+  BandRunner(const BandRunner&) = delete;
+  BandRunner& operator=(const BandRunner&) = delete;
+
+  void run(const std::function<void(int)>& work) {
+    work_ = &work;
+    start_.arrive_and_wait();
+    run_band(0);
+    done_.arrive_and_wait();
+    for (std::exception_ptr& error : errors_) {
+      if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+      }
+    }
+  }
+
+ private:
+  void run_band(int band) {
+    try {
+      (*work_)(band);
+    } catch (...) {
+      errors_[band] = std::current_exception();
+    }
+  }
+
+  std::barrier<> start_;
+  std::barrier<> done_;
+  // Written before arriving at start_, read after it, so the barrier orders
+  // them
+  const std::function<void(int)>* work_ = nullptr;
+  bool stop_ = false;
+  std::vector<std::exception_ptr> errors_;
+  std::vector<std::jthread> workers_;  // Joined before the barriers go
+};
+
+struct BenchStage {
+  const char* name;
+  std::function<void(int)> work;
+};
+
+// Seconds of the sample at quantile @p q of sorted @p samples
+double quantile(const std::vector<double>& samples, double q) {
+  const auto rank = static_cast<size_t>(
+      std::ceil(q * static_cast<double>(samples.size())));
+  return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+}
+
+template <typename DataType>
+void bench_image(const ImageData<DataType>& image, const CLIOptions& options) {
+  const auto channels = static_cast<size_t>(image.channels());
+  const std::span<const DataType> input{image.data(), image.size()};
+  std::vector<DataType> hub(input.size());
+  std::vector<DataType> output(input.size());
+  const size_t pixels = input.size() / channels;
+  const double megapixels = static_cast<double>(pixels) / 1e6;
+  const int iterations = options.bench_iterations;
+  const int warm_up = std::max(1, iterations / 10);
+
+  std::cout << std::format(
+      "Benchmarking {}x{} {}-bit image ({:.2f} MPix), {} to {}{}: {} runs "
+      "per stage after {} warm-up\n",
+      image.width(), image.height(), sizeof(DataType) * 8, megapixels,
+      options.from_space, options.to_space,
+      options.adjust_values ? " with adjustment" : "", iterations, warm_up);
+  std::cout << std::format("{:>7}  {:<20}{:>9}{:>11}{:>11}{:>10}\n",
+                           "Threads", "Stage", "min ms", "median ms",
+                           "p99 ms", "MPix/s");
+
+  for (const int threads : options.bench_threads) {
+    BandRunner runner(threads);
+    std::vector<std::vector<DataType>> scratch(threads);
+    // Samples [first, first + count) of band @p band
+    const auto band_span = [&](auto& samples, int band) {
+      const size_t first = pixels * band / threads;
+      const size_t last = pixels * (band + 1) / threads;
+      return std::span(samples).subspan(first * channels,
+                                        (last - first) * channels);
+    };
+
+    const std::array<BenchStage, 3> stages{
+        BenchStage{"to sRGB",
+                   [&](int band) {
+                     convert_to_hub<DataType>(band_span(input, band),
+                                              band_span(hub, band),
+                                              options.from_space,
+                                              image.channels());
+                   }},
+        BenchStage{options.adjust_values ? "from sRGB + adjust"
+                                         : "from sRGB",
+                   [&](int band) {
+                     process_hub_pixels<DataType>(
+                         band_span(std::as_const(hub), band),
+                         band_span(output, band), scratch[band], options,
+                         image.channels());
+                   }},
+        BenchStage{"whole conversion", [&](int band) {
+                     process_pixels<DataType>(band_span(input, band),
+                                              band_span(output, band),
+                                              scratch[band], options,
+                                              image.channels());
+                   }}};
+
+    for (const BenchStage& stage : stages) {
+      std::vector<double> samples;
+      samples.reserve(iterations);
+      for (int i = 0; i < warm_up + iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        runner.run(stage.work);
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (i >= warm_up) {
+          samples.push_back(elapsed.count());
+        }
+      }
+      std::sort(samples.begin(), samples.end());
+      const double median = quantile(samples, 0.5);
+      std::cout << std::format(
+          "{:>7}  {:<20}{:>9.3f}{:>11.3f}{:>11.3f}{:>10.1f}\n", threads,
+          stage.name, samples.front() * 1e3, median * 1e3,
+          quantile(samples, 0.99) * 1e3, megapixels / median);
+    }
+  }
+}
+}  // anonymous namespace
+
+int run_bench(const CLIOptions& options) {
+  if (options.ycbcr || options.stream || options.tiled || options.resize) {
+    std::cout << "--ycbcr, --stream, --tiled and --resize have no effect with "
+                 "--bench\n";
+  }
+
+  std::cout << std::format("Loading image: {}\n", options.input_file);
+  ImageDecoder decoder;
+  const ImageVariant image =
+      decoder.decode(options.input_file, load_options(options));
+  std::visit(
+      [&](const auto& image_data) {
+        using DataType = std::decay_t<decltype(*image_data.data())>;
+        if (!image_data) {
+          throw std::runtime_error(
+              std::format("Failed to load image: {}", options.input_file));
+        }
+        bench_image<DataType>(image_data, options);
+      },
+      image);
+  return 0;
+}
+
+}  // namespace psm_cli
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "cli_parser.hpp"
+
+namespace psm_cli {
+
+/**
+ * @brief Times the conversion selected in @p options on the decoded
+ * options.input_file, options.bench_iterations times per stage
+ *
+ * The input is decoded once, so the timings cover only psm's work on real
+ * content. Each stage runs a few untimed warm-up iterations first, then the
+ * timed ones, and min, median and p99 latency plus MPix/s at the median are
+ * printed. The stages are the source half of the conversion (to sRGB), the
+ * target half with any adjustment (from sRGB), and the whole conversion as a
+ * normal run performs it. For every count in options.bench_threads the image
+ * is split into that many bands, converted on a fixed set of threads so that
+ * starting threads is not timed.
+ *
+ * @return 0
+ * @throws std::runtime_error if the input cannot be decoded
+ */
+int run_bench(const CLIOptions& options);
+
+}  // namespace psm_cli
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace psm_cli {
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue
+ *
+ * Slots are claimed with a compare-and-swap on the head or tail position and
+ * published through a per-slot sequence number (Vyukov's bounded queue), so
+ * try_push and try_pop never take a lock. push and pop block with
+ * std::atomic::wait while the queue is full or empty, which is what gives a
+ * pipeline back-pressure: a fast producer stops once @p capacity items are
+ * queued instead of growing the backlog.
+ *
+ * @tparam T Movable item type; moved in and out of its slot
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  /// @param capacity Maximum number of queued items, rounded up to a power
+  /// of two of at least 2 (with one slot, full and empty look the same)
+  explicit BoundedQueue(size_t capacity)
+      : capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        slots_(std::make_unique<Slot[]>(capacity_)) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /// Moves @p item into the queue unless it is full
+  bool try_push(T& item) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[position & (capacity_ - 1)];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::ptrdiff_t>(sequence - position);
+      if (lag == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          slot.item = std::move(item);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          pushes_.fetch_add(1, std::memory_order_release);
+          pushes_.notify_all();
+          return true;
+        }
+      } else if (lag < 0) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Moves the oldest item into @p item unless the queue is empty
+  bool try_pop(T& item) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[position & (capacity_ - 1)];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+      if (lag == 0) {
+        if (head_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          item = std::move(slot.item);
+          slot.item = T{};
+          slot.sequence.store(position + capacity_, std::memory_order_release);
+          pops_.fetch_add(1, std::memory_order_release);
+          pops_.notify_all();
+          return true;
+        }
+      } else if (lag < 0) {
+        return false;
+      } else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Moves @p item into the queue, waiting while it is full
+  void push(T item) {
+    for (;;) {
+      // Sample the counter before trying, so a pop between the failed try
+      // and the wait changes it and the wait returns at once
+      const uint32_t pops = pops_.load(std::memory_order_acquire);
+      if (try_push(item)) {
+        return;
+      }
+      pops_.wait(pops, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * @brief Moves the oldest item into @p item, waiting while the queue is
+   * empty
+   *
+   * @return false once the queue is closed and drained
+   */
+  bool pop(T& item) {
+    for (;;) {
+      const uint32_t pushes = pushes_.load(std::memory_order_acquire);
+      if (try_pop(item)) {
+        return true;
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        // An item pushed before close() is still delivered
+        return try_pop(item);
+      }
+      pushes_.wait(pushes, std::memory_order_acquire);
+    }
+  }
+
+  /// Wakes the consumers once no more items will be pushed
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    pushes_.fetch_add(1, std::memory_order_release);
+    pushes_.notify_all();
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T item{};
+  };
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  // Producers and consumers contend on different cache lines
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<uint32_t> pushes_{0};
+  std::atomic<uint32_t> pops_{0};
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace psm_cli
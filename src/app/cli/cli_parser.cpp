@@ -8,13 +8,63 @@ void print_usage(const char* program_name) {
   std::cout
       << "Usage: " << program_name << " [options]\n"
       << "Options:\n"
-      << "  -i, --input FILE       Input image file\n"
-      << "  -o, --output FILE      Output image file\n"
+      << "  -i, --input FILE       Input image file, - for stdin, or a quoted "
+         "wildcard pattern such as 'photos/*.jpg' for a batch\n"
+      << "  -o, --output FILE      Output image file, - for stdout, or for a "
+         "batch an output directory or template using {name}, {ext}, {dir}, "
+         "{index}\n"
+      << "  --in-format F          Input format: png, jpeg, ppm, pam, pfm or "
+         "raw (default: by extension, detected for stdin)\n"
+      << "  --out-format F         Output format (default: by extension, the "
+         "input's format for stdout)\n"
+      << "  --input-dir DIR        Batch: convert every image in DIR\n"
+      << "  --input-list FILE      Batch: convert the images listed in FILE, "
+         "one per line\n"
+      << "  -j, --jobs N           Batch: convert on N workers; --tiled: on N "
+         "threads (default: one per core)\n"
+      << "  --memory-budget MB     Batch: limit the memory of images in "
+         "flight\n"
+      << "  --pipeline D,C,E       Batch: decode, convert and encode in "
+         "separate stages on D, C and E threads\n"
+      << "  --cache-dir DIR        Batch: reuse earlier outputs of unchanged "
+         "inputs and options from DIR\n"
+      << "  --serve SOCKET         Serve conversions on the Unix domain socket "
+         "SOCKET until interrupted\n"
+      << "  --connect SOCKET       Have the server on SOCKET convert -i to -o\n"
       << "  -f, --from COLORSPACE  Source color space (sRGB, AdobeRGB, "
          "DisplayP3, oRGB, ProPhotoRGB)\n"
       << "  -t, --to COLORSPACE    Target color space (sRGB, AdobeRGB, "
          "DisplayP3, oRGB, ProPhotoRGB)\n"
+      << "  -t, --to SPACE:FILE    Also write FILE in SPACE; repeat for more "
+         "targets, the input is decoded once (instead of -o)\n"
       << "  -a, --adjust R,G,B     Adjust channels by percent (e.g., 10,5,-5)\n"
+      << "  --max-dim N            Decode JPEGs at 1/2, 1/4 or 1/8 scale so "
+         "the longer side fits N\n"
+      << "  --scale 1/N            Decode JPEGs at 1/N scale (N = 2, 4, 8)\n"
+      << "  --crop X,Y,W,H         Decode and convert only the W x H region "
+         "at X,Y (in pixels after --max-dim/--scale)\n"
+      << "  --resize WxH           Resize in linear light before converting; "
+         "0 for W or H keeps the aspect ratio (e.g., 800x0)\n"
+      << "  --resize-filter F      Resize filter: lanczos3 (default) or "
+         "mitchell\n"
+      << "  --ycbcr                Convert JPEGs directly from their YCbCr "
+         "planes\n"
+      << "  --png-profile P        PNG encoding: fastest, balanced (default) "
+         "or smallest\n"
+      << "  --png-threads N        Compress PNGs on N threads (0 = all cores)\n"
+      << "  -s, --stream           Process row by row with constant memory\n"
+      << "  --tiled                Process bands of rows on -j threads with "
+         "bounded memory, for images too large to load\n"
+      << "  --scratch-dir DIR      Spill interlaced PNGs to DIR when streaming "
+         "or tiling (default with --tiled or stdin: the temporary "
+         "directory)\n"
+      << "  --scratch-compress     Deflate spilled data to save scratch space\n"
+      << "  --bench N              Convert the decoded input N times in "
+         "memory and report latency and MPix/s per stage\n"
+      << "  --bench-threads LIST   Benchmark on each of these thread counts "
+         "(e.g., 1,2,4; default: 1)\n"
+      << "  --stats json           Print a JSON record per image and per run "
+         "instead of progress messages (single images and batches)\n"
       << "  -h, --help             Show this help message\n";
 }
 
@@ -36,8 +86,139 @@ psm::Percent parse_adjust_arg(const std::string& adjust_arg) {
   return psm::Percent{r_percent, g_percent, b_percent};
 }
 
+int parse_scale_arg(const std::string& scale_arg) {
+  // Expected format: "1/N", or just "N"
+  const std::string denom =
+      scale_arg.starts_with("1/") ? scale_arg.substr(2) : scale_arg;
+  const int scale_denom = std::stoi(denom);
+
+  if (scale_denom != 1 && scale_denom != 2 && scale_denom != 4 &&
+      scale_denom != 8) {
+    throw std::invalid_argument(
+        "Invalid scale. Expected: 1/1, 1/2, 1/4 or 1/8");
+  }
+  return scale_denom;
+}
+
+psm_cli::CropRegion parse_crop_arg(const std::string& crop_arg) {
+  // Expected format: "X,Y,W,H"
+  int values[4];
+  size_t start = 0;
+  for (int i = 0; i < 4; ++i) {
+    const size_t comma = crop_arg.find(',', start);
+    if ((comma == std::string::npos) != (i == 3)) {
+      throw std::invalid_argument("Invalid crop. Expected: X,Y,W,H");
+    }
+    values[i] = std::stoi(crop_arg.substr(start, comma - start));
+    start = comma + 1;
+  }
+
+  const psm_cli::CropRegion crop{values[0], values[1], values[2], values[3]};
+  if (crop.x < 0 || crop.y < 0 || crop.width <= 0 || crop.height <= 0) {
+    throw std::invalid_argument(
+        "Crop X and Y must be at least 0, W and H at least 1");
+  }
+  return crop;
+}
+
+psm_cli::ResizeOptions parse_resize_arg(const std::string& resize_arg) {
+  // Expected format: "WxH", either side 0 to follow the other
+  const size_t x = resize_arg.find('x');
+  if (x == std::string::npos) {
+    throw std::invalid_argument("Invalid resize. Expected: WxH");
+  }
+  psm_cli::ResizeOptions resize;
+  resize.width = std::stoi(resize_arg.substr(0, x));
+  resize.height = std::stoi(resize_arg.substr(x + 1));
+  if (resize.width < 0 || resize.height < 0 ||
+      (resize.width == 0 && resize.height == 0)) {
+    throw std::invalid_argument(
+        "Resize width and height must be positive, or one of them 0");
+  }
+  return resize;
+}
+
+psm_cli::ResizeFilter parse_resize_filter_arg(const std::string& filter_arg) {
+  if (filter_arg == "lanczos3") {
+    return psm_cli::ResizeFilter::LANCZOS3;
+  } else if (filter_arg == "mitchell") {
+    return psm_cli::ResizeFilter::MITCHELL;
+  }
+  throw std::invalid_argument(
+      "Invalid resize filter. Expected: lanczos3 or mitchell");
+}
+
+psm_cli::PngProfile parse_png_profile_arg(const std::string& profile_arg) {
+  if (profile_arg == "fastest") {
+    return psm_cli::PngProfile::Fastest;
+  } else if (profile_arg == "balanced") {
+    return psm_cli::PngProfile::Balanced;
+  } else if (profile_arg == "smallest") {
+    return psm_cli::PngProfile::Smallest;
+  }
+  throw std::invalid_argument(
+      "Invalid PNG profile. Expected: fastest, balanced or smallest");
+}
+
+PipelineThreads parse_pipeline_arg(const std::string& pipeline_arg) {
+  // Expected format: "D,C,E" thread counts for decode, convert and encode
+  size_t first_comma = pipeline_arg.find(',');
+  size_t second_comma = pipeline_arg.find(',', first_comma + 1);
+
+  if (first_comma == std::string::npos || second_comma == std::string::npos) {
+    throw std::invalid_argument("Invalid pipeline format. Expected: D,C,E");
+  }
+
+  const PipelineThreads threads{
+      std::stoi(pipeline_arg.substr(0, first_comma)),
+      std::stoi(pipeline_arg.substr(first_comma + 1,
+                                    second_comma - first_comma - 1)),
+      std::stoi(pipeline_arg.substr(second_comma + 1))};
+  if (threads.decode < 1 || threads.convert < 1 || threads.encode < 1) {
+    throw std::invalid_argument("Every pipeline stage needs a thread");
+  }
+  return threads;
+}
+
+std::vector<int> parse_thread_list_arg(const std::string& threads_arg) {
+  // Expected format: "N[,N...]" thread counts
+  std::vector<int> threads;
+  size_t start = 0;
+  for (;;) {
+    const size_t comma = threads_arg.find(',', start);
+    threads.push_back(std::stoi(threads_arg.substr(start, comma - start)));
+    if (threads.back() < 1) {
+      throw std::invalid_argument("Thread counts must be at least 1");
+    }
+    if (comma == std::string::npos) {
+      return threads;
+    }
+    start = comma + 1;
+  }
+}
+
+psm_cli::ImageFormat parse_format_arg(const std::string& format_arg) {
+  if (format_arg == "png") {
+    return psm_cli::ImageFormat::PNG;
+  } else if (format_arg == "jpeg" || format_arg == "jpg") {
+    return psm_cli::ImageFormat::JPEG;
+  } else if (format_arg == "ppm") {
+    return psm_cli::ImageFormat::PPM;
+  } else if (format_arg == "pam") {
+    return psm_cli::ImageFormat::PAM;
+  } else if (format_arg == "pfm") {
+    return psm_cli::ImageFormat::PFM;
+  } else if (format_arg == "raw") {
+    return psm_cli::ImageFormat::RAW;
+  }
+  throw std::invalid_argument(
+      "Invalid image format. Expected: png, jpeg, ppm, pam, pfm or raw");
+}
+
 CLIOptions parse_args(int argc, char* argv[]) {
   CLIOptions options;
+  // Applied after the loop, so the filter may come before --resize
+  std::optional<psm_cli::ResizeFilter> resize_filter;
 
   for (int i = 1; i < argc; ++i) {
     std::string_view arg = argv[i];
@@ -61,25 +242,218 @@ CLIOptions parse_args(int argc, char* argv[]) {
       else
         throw std::runtime_error("Missing source color space");
     } else if (arg == "-t" || arg == "--to") {
-      if (++i < argc)
-        options.to_space = argv[i];
-      else
+      if (++i >= argc) {
         throw std::runtime_error("Missing target color space");
+      }
+      const std::string_view target = argv[i];
+      if (const size_t colon = target.find(':');
+          colon != std::string_view::npos) {
+        options.targets.push_back(
+            OutputTarget{.to_space = std::string(target.substr(0, colon)),
+                         .output_file = std::string(target.substr(colon + 1))});
+      } else {
+        options.to_space = target;
+      }
     } else if (arg == "-a" || arg == "--adjust") {
       if (++i < argc) {
         options.adjust_values = parse_adjust_arg(argv[i]);
       } else {
         throw std::runtime_error("Missing adjust values");
       }
+    } else if (arg == "--max-dim") {
+      if (++i < argc) {
+        options.max_dim = std::stoi(argv[i]);
+        if (options.max_dim <= 0) {
+          throw std::invalid_argument("Max dimension must be positive");
+        }
+      } else {
+        throw std::runtime_error("Missing max dimension");
+      }
+    } else if (arg == "--scale") {
+      if (++i < argc) {
+        options.scale_denom = parse_scale_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing scale");
+      }
+    } else if (arg == "--ycbcr") {
+      options.ycbcr = true;
+    } else if (arg == "--png-profile") {
+      if (++i < argc) {
+        options.png.profile = parse_png_profile_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing PNG profile");
+      }
+    } else if (arg == "--png-threads") {
+      if (++i < argc) {
+        options.png.threads = std::stoi(argv[i]);
+        if (options.png.threads < 0) {
+          throw std::invalid_argument("PNG threads must not be negative");
+        }
+      } else {
+        throw std::runtime_error("Missing PNG thread count");
+      }
+    } else if (arg == "-s" || arg == "--stream") {
+      options.stream = true;
+    } else if (arg == "--tiled") {
+      options.tiled = true;
+    } else if (arg == "--scratch-dir") {
+      if (++i < argc) {
+        options.scratch_dir = argv[i];
+      } else {
+        throw std::runtime_error("Missing scratch directory");
+      }
+    } else if (arg == "--scratch-compress") {
+      options.scratch_compress = true;
+    } else if (arg == "--input-dir") {
+      if (++i < argc) {
+        options.input_dir = argv[i];
+      } else {
+        throw std::runtime_error("Missing input directory");
+      }
+    } else if (arg == "--input-list") {
+      if (++i < argc) {
+        options.input_list = argv[i];
+      } else {
+        throw std::runtime_error("Missing input list");
+      }
+    } else if (arg == "-j" || arg == "--jobs") {
+      if (++i < argc) {
+        options.jobs = std::stoi(argv[i]);
+        if (options.jobs < 0) {
+          throw std::invalid_argument("Job count must not be negative");
+        }
+      } else {
+        throw std::runtime_error("Missing job count");
+      }
+    } else if (arg == "--memory-budget") {
+      if (++i < argc) {
+        const int budget_mb = std::stoi(argv[i]);
+        if (budget_mb <= 0) {
+          throw std::invalid_argument("Memory budget must be positive");
+        }
+        options.memory_budget_mb = static_cast<size_t>(budget_mb);
+      } else {
+        throw std::runtime_error("Missing memory budget");
+      }
+    } else if (arg == "--in-format") {
+      if (++i < argc) {
+        options.in_format = parse_format_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing input format");
+      }
+    } else if (arg == "--out-format") {
+      if (++i < argc) {
+        options.out_format = parse_format_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing output format");
+      }
+    } else if (arg == "--pipeline") {
+      if (++i < argc) {
+        options.pipeline = parse_pipeline_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing pipeline thread counts");
+      }
+    } else if (arg == "--crop") {
+      if (++i < argc) {
+        options.crop = parse_crop_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing crop region");
+      }
+    } else if (arg == "--resize") {
+      if (++i < argc) {
+        options.resize = parse_resize_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing resize dimensions");
+      }
+    } else if (arg == "--resize-filter") {
+      if (++i < argc) {
+        resize_filter = parse_resize_filter_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing resize filter");
+      }
+    } else if (arg == "--bench") {
+      if (++i < argc) {
+        options.bench_iterations = std::stoi(argv[i]);
+        if (options.bench_iterations < 1) {
+          throw std::invalid_argument(
+              "Benchmark iterations must be at least 1");
+        }
+      } else {
+        throw std::runtime_error("Missing benchmark iterations");
+      }
+    } else if (arg == "--bench-threads") {
+      if (++i < argc) {
+        options.bench_threads = parse_thread_list_arg(argv[i]);
+      } else {
+        throw std::runtime_error("Missing benchmark thread counts");
+      }
+    } else if (arg == "--stats") {
+      if (++i >= argc) {
+        throw std::runtime_error("Missing stats format");
+      }
+      if (std::string_view(argv[i]) != "json") {
+        throw std::invalid_argument("Invalid stats format. Expected: json");
+      }
+      options.stats_json = true;
+    } else if (arg == "--cache-dir") {
+      if (++i < argc) {
+        options.cache_dir = argv[i];
+      } else {
+        throw std::runtime_error("Missing cache directory");
+      }
+    } else if (arg == "--serve") {
+      if (++i < argc) {
+        options.serve_socket = argv[i];
+      } else {
+        throw std::runtime_error("Missing socket path");
+      }
+    } else if (arg == "--connect") {
+      if (++i < argc) {
+        options.connect_socket = argv[i];
+      } else {
+        throw std::runtime_error("Missing socket path");
+      }
     } else {
       throw std::runtime_error(std::string("Unknown option: ") +
                                std::string(arg));
     }
   }
 
-  if (options.input_file.empty() || options.output_file.empty()) {
+  // A server takes its inputs and outputs from requests, and a benchmark
+  // writes nothing
+  if (options.serve_socket.empty() &&
+      ((options.input_file.empty() && options.input_dir.empty() &&
+        options.input_list.empty()) ||
+       (options.output_file.empty() && options.targets.empty() &&
+        options.bench_iterations == 0))) {
     throw std::runtime_error("Input and output files are required");
   }
+  if (resize_filter && options.resize) {
+    options.resize->filter = *resize_filter;
+  }
+  if (!options.targets.empty() && !options.output_file.empty()) {
+    throw std::runtime_error(
+        "Use either -o or --to SPACE:FILE targets, not both");
+  }
+  // Streamed rows are converted as they are decoded, so they cannot be
+  // resized; stdin and stdout always stream
+  if (options.resize && options.targets.empty() &&
+      options.bench_iterations == 0 &&
+      (options.stream || options.tiled ||
+       psm_cli::is_stdio_path(options.input_file) ||
+       psm_cli::is_stdio_path(options.output_file))) {
+    throw std::runtime_error(
+        "--resize cannot be combined with --stream, --tiled or - for stdin "
+        "or stdout");
+  }
+  // Only single images and batches write stats records
+  if (options.stats_json &&
+      (options.bench_iterations > 0 || !options.targets.empty() ||
+       !options.serve_socket.empty() || !options.connect_socket.empty())) {
+    throw std::runtime_error(
+        "--stats cannot be combined with --bench, --to targets, --serve or "
+        "--connect");
+  }
 
   return options;
 }
\ No newline at end of file
@@ -2,19 +2,82 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
+#include "image_io/image_io.hpp"
+#include "image_processor/resize.hpp"
 #include "psm/percent.hpp"
 
+/// Threads of each stage of a pipelined batch, see --pipeline
+struct PipelineThreads {
+  int decode = 1;   ///< Read and decode
+  int convert = 1;  ///< Color conversion and adjustment
+  int encode = 1;   ///< Encode and write
+};
+
+/// One output of a multi-target conversion, see --to SPACE:FILE
+struct OutputTarget {
+  std::string to_space;
+  std::string output_file;
+};
+
 struct CLIOptions {
   std::string input_file;
   std::string output_file;
   std::string from_space = "sRGB";
   std::string to_space = "sRGB";
   std::optional<psm::Percent> adjust_values;
+  bool stream = false;  ///< Decode, convert and encode row by row
+  bool tiled = false;   ///< Convert bands of rows on jobs threads
+  /// Where interlaced PNGs are spilled when streaming or tiling
+  std::string scratch_dir;
+  /// Deflate spilled data
+  bool scratch_compress = false;
+  int max_dim = 0;      ///< Reduced-resolution JPEG decode target, 0 = off
+  int scale_denom = 1;  ///< JPEG decode scale 1/scale_denom
+  bool ycbcr = false;   ///< Convert JPEGs from their YCbCr planes
+  /// Decode and convert only this region of the input
+  std::optional<psm_cli::CropRegion> crop;
+  /// Resize in linear light before converting
+  std::optional<psm_cli::ResizeOptions> resize;
+  psm_cli::PngEncodeOptions png;  ///< PNG output profile and threads
+  /// Input format, UNKNOWN = by extension (sniffed for stdin)
+  psm_cli::ImageFormat in_format = psm_cli::ImageFormat::UNKNOWN;
+  /// Output format, UNKNOWN = by extension (the input's for stdout)
+  psm_cli::ImageFormat out_format = psm_cli::ImageFormat::UNKNOWN;
+  std::string input_dir;        ///< Batch: the images in this directory
+  std::string input_list;       ///< Batch: file listing one input per line
+  /// Batch workers or --tiled converter threads, 0 = one per core
+  int jobs = 0;
+  size_t memory_budget_mb = 0;  ///< Batch in-flight memory limit, 0 = none
+  std::optional<PipelineThreads> pipeline;  ///< Batch: staged, not per-image
+  std::string cache_dir;  ///< Batch: reuse outputs of unchanged conversions
+  int bench_iterations = 0;           ///< In-memory benchmark runs, 0 = off
+  std::vector<int> bench_threads{1};  ///< Benchmark thread counts
+  bool stats_json = false;  ///< JSON records instead of progress messages
+  std::vector<OutputTarget> targets;  ///< Outputs of one decoded input
+  std::string serve_socket;    ///< Run as a conversion server on this socket
+  std::string connect_socket;  ///< Convert through the server on this socket
 };
 
 CLIOptions parse_args(int argc, char* argv[]);
 
 void print_usage(const char* program_name);
 
-psm::Percent parse_adjust_arg(const std::string& adjust_arg);
\ No newline at end of file
+psm::Percent parse_adjust_arg(const std::string& adjust_arg);
+
+int parse_scale_arg(const std::string& scale_arg);
+
+psm_cli::CropRegion parse_crop_arg(const std::string& crop_arg);
+
+psm_cli::ResizeOptions parse_resize_arg(const std::string& resize_arg);
+
+psm_cli::ResizeFilter parse_resize_filter_arg(const std::string& filter_arg);
+
+psm_cli::PngProfile parse_png_profile_arg(const std::string& profile_arg);
+
+PipelineThreads parse_pipeline_arg(const std::string& pipeline_arg);
+
+std::vector<int> parse_thread_list_arg(const std::string& threads_arg);
+
+psm_cli::ImageFormat parse_format_arg(const std::string& format_arg);
\ No newline at end of file
@@ -0,0 +1,685 @@
+#include "daemon.hpp"
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.hpp"
+#include "image_processor/image_processor.hpp"
+#endif
+
+namespace psm_cli {
+
+#ifdef _WIN32
+
+int serve(const CLIOptions& /*options*/, const ImageStages& /*stages*/) {
+  throw std::runtime_error("--serve needs Unix domain sockets");
+}
+
+int run_client(const CLIOptions& /*options*/, int /*argc*/,
+               char* /*argv*/[]) {
+  throw std::runtime_error("--connect needs Unix domain sockets");
+}
+
+#else
+
+namespace {
+// Wire format, host byte order (both ends run on the same machine):
+//   request   RequestHeader, then args_size bytes of NUL-terminated
+//             psm_cli arguments; the input and output descriptors are
+//             attached to the first byte as SCM_RIGHTS
+//   response  ResponseHeader, then message_size bytes of error text
+constexpr std::array<char, 4> kMagic{'P', 'S', 'M', '1'};
+constexpr uint32_t kMaxArgsSize = 64 * 1024;
+constexpr int kPollMillis = 200;
+// A connection that sends nothing for this long is closed, so that idle
+// clients cannot hold every worker
+constexpr int kIdleMillis = 30 * 1000;
+
+struct RequestHeader {
+  std::array<char, 4> magic;
+  uint32_t args_size;
+};
+
+struct ResponseHeader {
+  std::array<char, 4> magic;
+  uint32_t status;  ///< 0 = converted
+  uint64_t output_size;
+  uint32_t message_size;
+  uint32_t reserved;
+};
+
+// Options a request may carry, which all describe the conversion. The
+// server supplies input and output, and everything else (modes, jobs,
+// scratch and cache directories, stats) is server state
+struct RequestOption {
+  std::string_view name;
+  bool takes_value;
+};
+constexpr std::array<RequestOption, 16> kRequestOptions{{
+    {"-f", true},
+    {"--from", true},
+    {"-t", true},
+    {"--to", true},
+    {"-a", true},
+    {"--adjust", true},
+    {"--in-format", true},
+    {"--out-format", true},
+    {"--crop", true},
+    {"--resize", true},
+    {"--resize-filter", true},
+    {"--scale", true},
+    {"--max-dim", true},
+    {"--ycbcr", false},
+    {"--png-profile", true},
+    {"--png-threads", true},
+}};
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void request_stop(int /*signal*/) { g_stop = 1; }
+
+class UniqueFd {
+ public:
+  UniqueFd() = default;
+  explicit UniqueFd(int fd) : fd_(fd) {}
+  ~UniqueFd() { reset(); }
+
+  UniqueFd(UniqueFd&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+  UniqueFd& operator=(UniqueFd&& other) noexcept {
+    if (this != &other) {
+      reset();
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+
+  UniqueFd(const UniqueFd&) = delete;
+  UniqueFd& operator=(const UniqueFd&) = delete;
+
+  int get() const { return fd_; }
+  explicit operator bool() const { return fd_ >= 0; }
+
+  void reset() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+std::runtime_error system_failure(std::string_view what) {
+  return std::runtime_error(
+      std::format("{}: {}", what, std::generic_category().message(errno)));
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+  const auto* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t written = ::write(fd, bytes, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Reads exactly @p size bytes; false on end of stream or error
+bool read_all(int fd, void* data, size_t size) {
+  auto* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    const ssize_t received = ::read(fd, bytes, size);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= static_cast<size_t>(received);
+  }
+  return true;
+}
+
+// Waits until @p fd is readable; false once the server is stopping or,
+// when @p limit_millis is positive, once that long has passed
+bool wait_readable(int fd, int limit_millis = 0) {
+  pollfd entry{fd, POLLIN, 0};
+  for (int waited = 0; !g_stop && (limit_millis <= 0 || waited < limit_millis);
+       waited += kPollMillis) {
+    const int ready = ::poll(&entry, 1, kPollMillis);
+    if (ready > 0) {
+      return true;
+    }
+    if (ready < 0 && errno != EINTR) {
+      return false;
+    }
+  }
+  return false;
+}
+
+sockaddr_un socket_address(const std::string& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument(std::format("Socket path too long: {}", path));
+  }
+  std::copy(path.begin(), path.end(), address.sun_path);
+  return address;
+}
+
+std::string descriptor_path(int fd) { return std::format("/dev/fd/{}", fd); }
+
+uint64_t descriptor_size(int fd) {
+  struct stat status {};
+  return ::fstat(fd, &status) == 0 ? static_cast<uint64_t>(status.st_size)
+                                   : 0;
+}
+
+// Server
+
+struct Request {
+  std::vector<std::string> args;
+  UniqueFd input;
+  UniqueFd output;
+};
+
+// Receives the next request; nullopt once the client hangs up or has been
+// idle for kIdleMillis
+std::optional<Request> receive_request(int connection) {
+  if (!wait_readable(connection, kIdleMillis)) {
+    return std::nullopt;
+  }
+
+  RequestHeader header{};
+  iovec vector{&header, sizeof(header)};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(2 * sizeof(int))> control{};
+  msghdr message{};
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+
+  const ssize_t received = ::recvmsg(connection, &message, 0);
+  if (received <= 0) {
+    return std::nullopt;
+  }
+
+  // Take ownership of the descriptors first, so they are closed whatever
+  // is wrong with the request
+  std::vector<UniqueFd> descriptors;
+  for (cmsghdr* entry = CMSG_FIRSTHDR(&message); entry;
+       entry = CMSG_NXTHDR(&message, entry)) {
+    if (entry->cmsg_level != SOL_SOCKET || entry->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    const size_t count = (entry->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < count; ++i) {
+      int fd;
+      std::memcpy(&fd, CMSG_DATA(entry) + i * sizeof(int), sizeof(int));
+      descriptors.emplace_back(fd);
+    }
+  }
+
+  const auto header_bytes = static_cast<size_t>(received);
+  if (header_bytes < sizeof(header) &&
+      !read_all(connection, reinterpret_cast<char*>(&header) + header_bytes,
+                sizeof(header) - header_bytes)) {
+    throw std::runtime_error("Truncated request");
+  }
+  if (header.magic != kMagic || header.args_size > kMaxArgsSize) {
+    throw std::runtime_error("Not a psm_cli request");
+  }
+  if (descriptors.size() != 2 || (message.msg_flags & MSG_CTRUNC)) {
+    throw std::runtime_error(
+        "A request needs exactly an input and an output descriptor");
+  }
+
+  std::string payload(header.args_size, '\0');
+  if (!read_all(connection, payload.data(), payload.size())) {
+    throw std::runtime_error("Truncated request");
+  }
+
+  Request request;
+  for (size_t start = 0; start < payload.size();) {
+    const size_t end = std::min(payload.find('\0', start), payload.size());
+    request.args.push_back(payload.substr(start, end - start));
+    start = end + 1;
+  }
+  request.input = std::move(descriptors[0]);
+  request.output = std::move(descriptors[1]);
+  return request;
+}
+
+bool send_response(int connection, uint32_t status, uint64_t output_size,
+                   std::string_view message) {
+  const ResponseHeader header{kMagic, status, output_size,
+                              static_cast<uint32_t>(message.size()), 0};
+  return write_all(connection, &header, sizeof(header)) &&
+         write_all(connection, message.data(), message.size());
+}
+
+ImageFormat sniff_descriptor(int fd) {
+  std::array<uint8_t, kSniffBytes> header{};
+  const ssize_t size = ::pread(fd, header.data(), header.size(), 0);
+  const ImageFormat format =
+      sniff_format(std::span(header.data(), size > 0 ? size : 0));
+  if (format == ImageFormat::UNKNOWN) {
+    throw std::runtime_error("Unrecognized input format");
+  }
+  return format;
+}
+
+bool same_png_options(const PngEncodeOptions& a, const PngEncodeOptions& b) {
+  return a.profile == b.profile && a.threads == b.threads;
+}
+
+// Converts the request's input to its output; throws on failure
+void convert_request(const Request& request, const CLIOptions& server_options,
+                     const ImageStages& stages, ImageDecoder& decoder,
+                     ImageEncoder& encoder) {
+  for (size_t i = 0; i < request.args.size(); ++i) {
+    const std::string& arg = request.args[i];
+    const auto option =
+        std::find_if(kRequestOptions.begin(), kRequestOptions.end(),
+                     [&arg](const RequestOption& allowed) {
+                       return allowed.name == arg;
+                     });
+    if (option == kRequestOptions.end()) {
+      throw std::invalid_argument(
+          std::format("{} cannot be used in a request", arg));
+    }
+    // A missing value is left to parse_args to report
+    if (!option->takes_value || ++i == request.args.size()) {
+      continue;
+    }
+    // SPACE:FILE targets would write files of the server's choosing
+    if ((arg == "-t" || arg == "--to") &&
+        request.args[i].find(':') != std::string::npos) {
+      throw std::invalid_argument(std::format(
+          "{} {} cannot be used in a request", arg, request.args[i]));
+    }
+  }
+
+  // The request's options go last, so that an option missing its value
+  // does not take -i or -o as one
+  std::vector<std::string> args{"psm_cli", "-i",
+                                descriptor_path(request.input.get()), "-o",
+                                descriptor_path(request.output.get())};
+  args.insert(args.end(), request.args.begin(), request.args.end());
+  std::vector<char*> argv;
+  for (std::string& arg : args) {
+    argv.push_back(arg.data());
+  }
+
+  PipelineImage image;
+  image.options = parse_args(static_cast<int>(argv.size()), argv.data());
+  // /dev/fd/N has no extension to take the formats from
+  if (image.options.in_format == ImageFormat::UNKNOWN) {
+    image.options.in_format = sniff_descriptor(request.input.get());
+  }
+  if (image.options.out_format == ImageFormat::UNKNOWN) {
+    image.options.out_format = image.options.in_format;
+  }
+
+  if (same_png_options(image.options.png, server_options.png)) {
+    run_stages(stages, image, decoder, encoder);
+  } else {
+    ImageEncoder request_encoder(image.options.png);
+    run_stages(stages, image, decoder, request_encoder);
+  }
+}
+
+void serve_connection(UniqueFd connection, const CLIOptions& options,
+                      const ImageStages& stages, ImageDecoder& decoder,
+                      ImageEncoder& encoder) {
+  for (;;) {
+    std::optional<Request> request;
+    try {
+      request = receive_request(connection.get());
+    } catch (const std::exception& e) {
+      // The stream is out of step, so the connection cannot continue
+      send_response(connection.get(), 1, 0, e.what());
+      return;
+    }
+    if (!request) {
+      return;
+    }
+
+    uint32_t status = 0;
+    std::string message;
+    try {
+      convert_request(*request, options, stages, decoder, encoder);
+    } catch (const std::exception& e) {
+      status = 1;
+      message = e.what();
+      std::cerr << std::format("Request failed: {}\n", message);
+    }
+    if (!send_response(connection.get(), status,
+                       descriptor_size(request->output.get()), message)) {
+      return;
+    }
+  }
+}
+
+// Runs every conversion once so that tables are built and code and data
+// pages are faulted in before the first request
+void warm_up(const CLIOptions& options) {
+  constexpr std::array<const char*, 5> kSpaces{"sRGB", "AdobeRGB", "DisplayP3",
+                                               "oRGB", "ProPhotoRGB"};
+  constexpr size_t kSamples = 3 * 256;
+  std::vector<uint8_t> input8(kSamples, 128);
+  std::vector<uint8_t> output8(kSamples);
+  std::vector<uint16_t> input16(kSamples, 32768);
+  std::vector<uint16_t> output16(kSamples);
+  std::vector<uint8_t> scratch8;
+  std::vector<uint16_t> scratch16;
+
+  CLIOptions pair = options;
+  pair.adjust_values.reset();
+  for (const char* from : kSpaces) {
+    for (const char* to : kSpaces) {
+      pair.from_space = from;
+      pair.to_space = to;
+      process_pixels<uint8_t>(input8, output8, scratch8, pair);
+      process_pixels<uint16_t>(input16, output16, scratch16, pair);
+    }
+  }
+}
+
+// Client
+
+// Anonymous in-memory file for data that has no file of its own
+UniqueFd anonymous_file() {
+#ifdef __linux__
+  UniqueFd fd(::memfd_create("psm_cli", MFD_CLOEXEC));
+#else
+  std::string name =
+      (std::filesystem::temp_directory_path() / "psm_cli.XXXXXX").string();
+  UniqueFd fd(::mkstemp(name.data()));
+  if (fd) {
+    ::unlink(name.c_str());
+  }
+#endif
+  if (!fd) {
+    throw system_failure("Cannot create an in-memory file");
+  }
+  return fd;
+}
+
+UniqueFd open_input(const std::string& path) {
+  if (!is_stdio_path(path)) {
+    UniqueFd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd) {
+      throw system_failure(std::format("Cannot open {}", path));
+    }
+    return fd;
+  }
+
+  // A pipe cannot be passed on for reading twice, so it is copied once
+  UniqueFd fd = anonymous_file();
+  std::array<char, 64 * 1024> buffer;
+  ssize_t received;
+  while ((received = ::read(STDIN_FILENO, buffer.data(), buffer.size())) > 0) {
+    if (!write_all(fd.get(), buffer.data(), static_cast<size_t>(received))) {
+      throw system_failure("Cannot buffer stdin");
+    }
+  }
+  return fd;
+}
+
+UniqueFd open_output(const std::string& path) {
+  if (is_stdio_path(path)) {
+    return anonymous_file();
+  }
+  UniqueFd fd(
+      ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+  if (!fd) {
+    throw system_failure(std::format("Cannot create {}", path));
+  }
+  return fd;
+}
+
+std::string_view format_name(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::PNG:
+      return "png";
+    case ImageFormat::JPEG:
+      return "jpeg";
+    case ImageFormat::PPM:
+      return "ppm";
+    case ImageFormat::PAM:
+      return "pam";
+    case ImageFormat::PFM:
+      return "pfm";
+    case ImageFormat::RAW:
+      return "raw";
+    default:
+      return {};
+  }
+}
+
+void send_request(int connection, const std::vector<std::string>& args,
+                  int input, int output) {
+  std::string payload;
+  for (const std::string& arg : args) {
+    payload += arg;
+    payload.push_back('\0');
+  }
+  const RequestHeader header{kMagic, static_cast<uint32_t>(payload.size())};
+  payload.insert(0, reinterpret_cast<const char*>(&header), sizeof(header));
+
+  iovec vector{payload.data(), payload.size()};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(2 * sizeof(int))> control{};
+  msghdr message{};
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  cmsghdr* entry = CMSG_FIRSTHDR(&message);
+  entry->cmsg_level = SOL_SOCKET;
+  entry->cmsg_type = SCM_RIGHTS;
+  entry->cmsg_len = CMSG_LEN(2 * sizeof(int));
+  const std::array<int, 2> descriptors{input, output};
+  std::memcpy(CMSG_DATA(entry), descriptors.data(), sizeof(descriptors));
+
+  ssize_t sent;
+  do {
+    sent = ::sendmsg(connection, &message, 0);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0) {
+    throw system_failure("Cannot send request");
+  }
+  const auto sent_bytes = static_cast<size_t>(sent);
+  if (!write_all(connection, payload.data() + sent_bytes,
+                 payload.size() - sent_bytes)) {
+    throw system_failure("Cannot send request");
+  }
+}
+
+void copy_to_stdout(int fd, uint64_t size) {
+  std::array<char, 64 * 1024> buffer;
+  for (uint64_t offset = 0; offset < size;) {
+    const ssize_t received =
+        ::pread(fd, buffer.data(),
+                static_cast<size_t>(std::min<uint64_t>(buffer.size(),
+                                                       size - offset)),
+                static_cast<off_t>(offset));
+    if (received <= 0 ||
+        !write_all(STDOUT_FILENO, buffer.data(),
+                   static_cast<size_t>(received))) {
+      throw system_failure("Cannot write stdout");
+    }
+    offset += static_cast<uint64_t>(received);
+  }
+}
+}  // anonymous namespace
+
+int serve(const CLIOptions& options, const ImageStages& stages) {
+  namespace fs = std::filesystem;
+  const sockaddr_un address = socket_address(options.serve_socket);
+  UniqueFd listener(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+  if (!listener) {
+    throw system_failure("Cannot create socket");
+  }
+
+  // A socket left behind by a server that did not shut down would make
+  // bind fail
+  std::error_code error;
+  if (fs::is_socket(options.serve_socket, error)) {
+    fs::remove(options.serve_socket, error);
+  }
+  // Only the server's user may connect, since requests are converted with
+  // the server's permissions. No other thread runs yet to see the umask
+  const mode_t previous_umask = ::umask(0177);
+  const int bound =
+      ::bind(listener.get(), reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address));
+  ::umask(previous_umask);
+  if (bound != 0 || ::listen(listener.get(), SOMAXCONN) != 0) {
+    throw system_failure(
+        std::format("Cannot listen on {}", options.serve_socket));
+  }
+
+  std::signal(SIGINT, request_stop);
+  std::signal(SIGTERM, request_stop);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  warm_up(options);
+
+  const size_t workers = static_cast<size_t>(
+      options.jobs > 0 ? options.jobs
+                       : std::max(std::thread::hardware_concurrency(), 1u));
+  // Accepted connections wait here while every worker is busy; beyond that
+  // the listen backlog holds them
+  BoundedQueue<int> connections(workers);
+  {
+    std::vector<std::jthread> pool;
+    for (size_t i = 0; i < workers; ++i) {
+      pool.emplace_back([&] {
+        ImageDecoder decoder;
+        ImageEncoder encoder(options.png);
+        int connection;
+        while (connections.pop(connection)) {
+          serve_connection(UniqueFd(connection), options, stages, decoder,
+                           encoder);
+        }
+      });
+    }
+
+    std::cout << std::format("Serving on {} with {} workers\n",
+                             options.serve_socket, workers);
+    while (wait_readable(listener.get())) {
+      const int connection =
+          ::accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection >= 0) {
+        // A client that stops partway through a request times out too
+        const timeval limit{kIdleMillis / 1000, 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &limit,
+                     sizeof(limit));
+        connections.push(connection);
+      }
+    }
+    connections.close();
+  }
+
+  fs::remove(options.serve_socket, error);
+  std::cout << "Server stopped\n";
+  return 0;
+}
+
+int run_client(const CLIOptions& options, int argc, char* argv[]) {
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // Forward every argument but the input, output and socket
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "-i" || arg == "--input" || arg == "-o" ||
+        arg == "--output" || arg == "--connect") {
+      ++i;
+      continue;
+    }
+    args.emplace_back(arg);
+  }
+  // The server only sees descriptors, so the output's extension is sent as
+  // its format
+  const std::string_view extension_format =
+      format_name(detect_format(options.output_file));
+  if (options.out_format == ImageFormat::UNKNOWN &&
+      !extension_format.empty()) {
+    args.insert(args.end(), {"--out-format", std::string(extension_format)});
+  }
+
+  const UniqueFd input = open_input(options.input_file);
+  const UniqueFd output = open_output(options.output_file);
+
+  const sockaddr_un address = socket_address(options.connect_socket);
+  UniqueFd connection(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+  if (!connection ||
+      ::connect(connection.get(), reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    throw system_failure(
+        std::format("Cannot connect to {}", options.connect_socket));
+  }
+
+  send_request(connection.get(), args, input.get(), output.get());
+
+  ResponseHeader response{};
+  if (!read_all(connection.get(), &response, sizeof(response)) ||
+      response.magic != kMagic) {
+    throw std::runtime_error("Server closed the connection");
+  }
+  std::string message(response.message_size, '\0');
+  if (!read_all(connection.get(), message.data(), message.size())) {
+    throw std::runtime_error("Server closed the connection");
+  }
+
+  if (response.status != 0) {
+    std::cerr << std::format("Failed to convert image: {}\n", message);
+    return 1;
+  }
+  if (is_stdio_path(options.output_file)) {
+    copy_to_stdout(output.get(), response.output_size);
+  }
+  std::cout << std::format("Server wrote {} bytes to {}\n",
+                           response.output_size, options.output_file);
+  return 0;
+}
+
+#endif  // _WIN32
+
+}  // namespace psm_cli
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "batch.hpp"
+#include "cli_parser.hpp"
+
+namespace psm_cli {
+
+/**
+ * @brief Serves conversion requests on the Unix domain socket
+ * options.serve_socket until SIGINT or SIGTERM
+ *
+ * Each request carries psm_cli arguments and two file descriptors, the input
+ * image and the output file, which the server opens as /dev/fd/N. Image bytes
+ * therefore never pass through the socket: a client hands over regular files
+ * or memfds, and mapped formats are converted straight between the two
+ * mappings. options.jobs workers (0 = one per core) serve one connection
+ * each, keeping their ImageDecoder and ImageEncoder for every request, and
+ * every color space pair is converted once at startup so the first request
+ * does not pay for page faults and table setup.
+ *
+ * The input format is --in-format or sniffed from the descriptor, the output
+ * format --out-format or else the input's.
+ *
+ * @return 0 once stopped
+ * @throws std::runtime_error if the socket cannot be created, or on platforms
+ * without Unix domain sockets
+ */
+int serve(const CLIOptions& options, const ImageStages& stages);
+
+/**
+ * @brief Sends this invocation's conversion to the server listening on
+ * options.connect_socket and waits for the result
+ *
+ * Every argument except the input, output and socket is forwarded. Files are
+ * passed as open descriptors; stdin and stdout go through memfds. The output
+ * format is taken from the output's extension unless --out-format is given.
+ *
+ * @return 0 if the server converted the image, 1 otherwise
+ */
+int run_client(const CLIOptions& options, int argc, char* argv[]);
+
+}  // namespace psm_cli
@@ -0,0 +1,182 @@
+#include "output_cache.hpp"
+
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "image_io/mapped_file.hpp"
+#include "image_processor/image_processor.hpp"
+#include "psm/version.hpp"
+
+namespace psm_cli {
+
+namespace {
+namespace fs = std::filesystem;
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+// Compilers turn this into a single load on little-endian targets
+template <typename T>
+T read_le(const uint8_t* bytes) {
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<T>(bytes[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t xxh_round(uint64_t accumulator, uint64_t input) {
+  accumulator += input * kPrime2;
+  return std::rotl(accumulator, 31) * kPrime1;
+}
+
+uint64_t merge_round(uint64_t hash, uint64_t lane) {
+  hash ^= xxh_round(0, lane);
+  return hash * kPrime1 + kPrime4;
+}
+
+// Name of an entry's temporary file, unique among threads and, through the
+// random tag, among processes sharing the directory
+std::string temporary_name(const std::string& key) {
+  static const uint64_t process_tag = std::random_device{}();
+  static std::atomic<uint64_t> counter{0};
+  return std::format("{}.{:x}.{}.tmp", key, process_tag, counter++);
+}
+}  // anonymous namespace
+
+uint64_t hash_bytes(std::span<const uint8_t> data, uint64_t seed) {
+  const uint8_t* p = data.data();
+  const uint8_t* const end = p + data.size();
+  uint64_t hash;
+
+  if (data.size() >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    for (; end - p >= 32; p += 32) {
+      v1 = xxh_round(v1, read_le<uint64_t>(p));
+      v2 = xxh_round(v2, read_le<uint64_t>(p + 8));
+      v3 = xxh_round(v3, read_le<uint64_t>(p + 16));
+      v4 = xxh_round(v4, read_le<uint64_t>(p + 24));
+    }
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+           std::rotl(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += data.size();
+
+  for (; end - p >= 8; p += 8) {
+    hash ^= xxh_round(0, read_le<uint64_t>(p));
+    hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (end - p >= 4) {
+    hash ^= static_cast<uint64_t>(read_le<uint32_t>(p)) * kPrime1;
+    hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= *p * kPrime5;
+    hash = std::rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+OutputCache::OutputCache(std::string directory)
+    : directory_(std::move(directory)) {
+  std::error_code error;
+  fs::create_directories(directory_, error);
+  if (!fs::is_directory(directory_, error)) {
+    throw std::runtime_error(
+        std::format("Cannot create cache directory: {}", directory_));
+  }
+}
+
+std::string OutputCache::key(const CLIOptions& options) const {
+  uint64_t content_hash;
+  try {
+    const MappedFile input = MappedFile::open_read(options.input_file);
+    content_hash = hash_bytes(input.data());
+  } catch (const std::exception&) {
+    return {};
+  }
+
+  // Everything that changes the output's bytes; PNG threads change how
+  // bands are deflated, and stream and tiled mode always encode on one
+  // thread, with identical output
+  const psm::Percent adjust =
+      options.adjust_values.value_or(psm::Percent{0, 0, 0});
+  const CropRegion crop = options.crop.value_or(CropRegion{});
+  const ResizeOptions resize = options.resize.value_or(ResizeOptions{});
+  const std::string conversion = std::format(
+      "psm {}|{}|{}|{},{},{},{}|{}|{}|{}|{},{},{},{}|{}x{},{}|{}|{}|{}|{}|{}",
+      psm::version::full, options.from_space, options.to_space,
+      options.adjust_values.has_value(), adjust.channel(0), adjust.channel(1),
+      adjust.channel(2), options.max_dim, options.scale_denom, options.ycbcr,
+      crop.x, crop.y, crop.width, crop.height, resize.width, resize.height,
+      static_cast<int>(resize.filter), options.stream || options.tiled,
+      static_cast<int>(options.png.profile), options.png.threads,
+      static_cast<int>(input_format(options)),
+      static_cast<int>(output_format(options)));
+  const auto* bytes = reinterpret_cast<const uint8_t*>(conversion.data());
+  return std::format("{:016x}",
+                     hash_bytes({bytes, conversion.size()}, content_hash));
+}
+
+bool OutputCache::restore(const std::string& key,
+                          const std::string& output_file) const {
+  std::error_code error;
+  fs::remove(output_file, error);
+
+  const fs::path entry = fs::path(directory_) / key;
+  if (!fs::is_regular_file(entry, error)) {
+    return false;
+  }
+  fs::create_hard_link(entry, output_file, error);
+  if (error) {
+    fs::copy_file(entry, output_file, error);
+  }
+  return !error;
+}
+
+void OutputCache::store(const std::string& key,
+                        const std::string& output_file) const {
+  const fs::path entry = fs::path(directory_) / key;
+  const fs::path temporary = fs::path(directory_) / temporary_name(key);
+  std::error_code error;
+  fs::create_hard_link(output_file, temporary, error);
+  if (error) {
+    fs::copy_file(output_file, temporary, error);
+  }
+  if (!error) {
+    fs::rename(temporary, entry, error);
+  }
+  if (error) {
+    std::cerr << std::format("Cannot cache {}: {}\n", output_file,
+                             error.message());
+    fs::remove(temporary, error);
+  }
+}
+
+}  // namespace psm_cli
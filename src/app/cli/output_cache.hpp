@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "cli_parser.hpp"
+
+namespace psm_cli {
+
+/// XXH64 of @p data
+uint64_t hash_bytes(std::span<const uint8_t> data, uint64_t seed = 0);
+
+/**
+ * @brief Outputs of earlier conversions, keyed on the input's contents and
+ * everything else that decides the output's bytes
+ *
+ * An entry is a file in the cache directory named after the key. Outputs are
+ * hard-linked into and out of the cache, or copied where links are not
+ * possible (another file system), so a hit costs one hash of the input and a
+ * directory operation instead of a decode, conversion and encode. Entries
+ * are published by renaming, so concurrent batches sharing a directory never
+ * see a partial one. Safe to use from several threads.
+ */
+class OutputCache {
+ public:
+  /// Uses, and if needed creates, @p directory
+  explicit OutputCache(std::string directory);
+
+  /**
+   * @brief Key of converting options.input_file with @p options: XXH64 of
+   * the input's bytes, seeded into a hash of the conversion options, the
+   * output format and the psm version
+   *
+   * @return The key, or an empty string if the input cannot be read, in which
+   * case the conversion reports the error
+   */
+  std::string key(const CLIOptions& options) const;
+
+  /**
+   * @brief Places the output stored under @p key at @p output_file
+   *
+   * An existing @p output_file is removed first even on a miss, so a new
+   * conversion never writes through a link into an entry.
+   *
+   * @return false on a miss
+   */
+  bool restore(const std::string& key, const std::string& output_file) const;
+
+  /// Stores @p output_file under @p key; a failure is reported, not thrown
+  void store(const std::string& key, const std::string& output_file) const;
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace psm_cli
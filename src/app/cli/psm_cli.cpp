@@ -1,41 +1,243 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <format>
 #include <iostream>
+#include <optional>
+#include <ostream>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 #include <variant>
+#include <vector>
 
+#include "batch.hpp"
+#include "bench.hpp"
 #include "cli_parser.hpp"
+#include "daemon.hpp"
 #include "image_io.hpp"
 #include "image_processor/image_processor.hpp"
+#include "targets.hpp"
+
+namespace {
+// Mapped-to-mapped conversions skip load_image/save_image; the output is
+// created at its final size, so it must not be the input file, and it is the
+// input's size, so nothing is cropped or resized
+bool use_mapped_conversion(const CLIOptions& options) {
+  if (options.crop || options.resize ||
+      !psm_cli::is_mapped_format(psm_cli::input_format(options)) ||
+      !psm_cli::is_mapped_format(psm_cli::output_format(options))) {
+    return false;
+  }
+  std::error_code error;
+  return !std::filesystem::equivalent(options.input_file, options.output_file,
+                                      error);
+}
+
+// Decodes options.input_file, or converts it whole when tiling, streaming or
+// mapping
+void decode_image(psm_cli::PipelineImage& image,
+                  psm_cli::ImageDecoder& decoder) {
+  const CLIOptions& options = image.options;
+  if (options.tiled) {
+    if (options.ycbcr) {
+      std::cout << "--ycbcr has no effect with --tiled\n";
+    }
+    image.one_pass = psm_cli::tile_image(options);
+    std::cout << std::format("Successfully processed and saved image\n");
+    return;
+  }
+
+  // Pipes cannot be mapped or sought, so stdin and stdout always stream
+  if (options.stream || psm_cli::is_stdio_path(options.input_file) ||
+      psm_cli::is_stdio_path(options.output_file)) {
+    if (options.ycbcr) {
+      std::cout << "--ycbcr has no effect with --stream\n";
+    }
+    image.one_pass = psm_cli::stream_image(options);
+    std::cout << std::format("Successfully processed and saved image\n");
+    return;
+  }
+
+  if (use_mapped_conversion(options)) {
+    if (options.ycbcr) {
+      std::cout << "--ycbcr has no effect on mapped formats\n";
+    }
+    image.one_pass = psm_cli::convert_mapped(options);
+    std::cout << std::format("Successfully processed and saved image\n");
+    return;
+  }
 
-int main(int argc, char* argv[]) {
-  const auto options = parse_args(argc, argv);
   std::cout << std::format("Loading image: {}\n", options.input_file);
-  auto image_variant = psm_cli::load_image(options.input_file);
-  const bool success = std::visit(
-      [&options](auto& image_data) -> bool {
-        using DataType = std::decay_t<decltype(*image_data.data())>;
+
+  if (options.ycbcr && (options.crop || options.resize)) {
+    std::cout << "--ycbcr has no effect with --crop or --resize\n";
+  } else if (options.ycbcr &&
+             psm_cli::input_format(options) == psm_cli::ImageFormat::JPEG) {
+    image.ycbcr = decoder.decode_ycbcr(options.input_file,
+                                       psm_cli::load_options(options));
+    if (image.ycbcr) {
+      return;
+    }
+    std::cout << "JPEG is not YCbCr coded, converting from RGB instead\n";
+  }
+
+  image.image =
+      decoder.decode(options.input_file, psm_cli::load_options(options));
+  std::visit(
+      [&](const auto& image_data) {
         if (!image_data) {
-          std::cerr << std::format("Failed to load image: {}\n",
-                                   options.input_file);
-          return false;
+          throw std::runtime_error(
+              std::format("Failed to load image: {}", options.input_file));
+        }
+      },
+      image.image);
+}
+
+// Replaces the decoded image by its converted and adjusted pixels
+void convert_image(psm_cli::PipelineImage& image) {
+  if (image.one_pass) {
+    return;
+  }
+
+  if (image.ycbcr) {
+    auto processed_data = psm_cli::process_ycbcr(*image.ycbcr, image.options);
+    image.image = psm_cli::ImageData<uint8_t>(
+        std::move(processed_data), image.ycbcr->width, image.ycbcr->height, 3);
+    image.ycbcr.reset();
+    return;
+  }
+
+  std::visit(
+      [&](auto& image_data) {
+        using DataType = std::decay_t<decltype(*image_data.data())>;
+        // A resize can change the space the conversion continues from
+        const CLIOptions* options = &image.options;
+        CLIOptions resized_options;
+        if (image.options.resize) {
+          resized_options = image.options;
+          resized_options.from_space =
+              psm_cli::resize_for_conversion<DataType>(image_data,
+                                                       image.options);
+          options = &resized_options;
         }
         auto processed_data =
-            psm_cli::process_image<DataType>(image_data, options);
-        psm_cli::ImageData<DataType> output_image(std::move(processed_data),
-                                                  image_data.width(),
-                                                  image_data.height(), 3);
-        const bool save_success =
-            psm_cli::save_image<DataType>(output_image, options.output_file);
-        if (!save_success) {
-          std::cerr << std::format("Failed to save image: {}\n",
-                                   options.output_file);
-          return false;
+            psm_cli::process_image<DataType>(image_data, *options);
+        image_data = psm_cli::ImageData<DataType>(
+            std::move(processed_data), image_data.width(),
+            image_data.height(), image_data.channels());
+      },
+      image.image);
+}
+
+// Encodes the converted image to options.output_file
+void encode_image(psm_cli::PipelineImage& image,
+                  psm_cli::ImageEncoder& encoder) {
+  if (image.one_pass) {
+    return;
+  }
+
+  const std::string& output_file = image.options.output_file;
+  std::visit(
+      [&](const auto& image_data) {
+        if (!encoder.encode(image_data, output_file,
+                            image.options.out_format)) {
+          throw std::runtime_error(
+              std::format("Failed to save image: {}", output_file));
         }
-        std::cout << std::format("Successfully processed and saved image\n");
-        return true;
       },
-      image_variant);
+      image.image);
+  std::cout << std::format("Successfully processed and saved image\n");
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const auto options = parse_args(argc, argv);
+  if (psm_cli::is_stdio_path(options.output_file)) {
+    // stdout carries the image, so progress goes to stderr
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
+  const psm_cli::ImageStages stages{decode_image, convert_image,
+                                    encode_image};
+
+  if (!options.serve_socket.empty()) {
+    try {
+      return psm_cli::serve(options, stages);
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to start server: {}\n", e.what());
+      return 1;
+    }
+  }
+  if (!options.connect_socket.empty()) {
+    try {
+      return psm_cli::run_client(options, argc, argv);
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to convert image: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  if (options.bench_iterations > 0) {
+    try {
+      return psm_cli::run_bench(options);
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to run benchmark: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  if (!options.targets.empty()) {
+    try {
+      return psm_cli::run_targets(options);
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to convert image: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  // Records replace the progress messages, which are dropped so that every
+  // line of the stream is a whole record
+  std::optional<std::ostream> stats_stream;
+  std::optional<psm_cli::StatsWriter> stats_writer;
+  if (options.stats_json) {
+    stats_stream.emplace(std::cout.rdbuf());
+    stats_writer.emplace(*stats_stream);
+    std::cout.rdbuf(nullptr);
+  }
+
+  if (psm_cli::is_batch(options)) {
+    try {
+      return psm_cli::run_batch(options, stages,
+                                stats_writer ? &*stats_writer : nullptr);
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to start batch: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  if (!options.cache_dir.empty()) {
+    std::cout << "--cache-dir has no effect outside a batch\n";
+  }
+  const auto start = std::chrono::steady_clock::now();
+  psm_cli::ImageDecoder decoder;
+  psm_cli::ImageEncoder encoder(options.png);
+  psm_cli::PipelineImage image;
+  image.options = options;
+  std::string error;
+  try {
+    psm_cli::run_stages(
+        stats_writer ? psm_cli::timed_stages(stages) : stages, image, decoder,
+        encoder);
+  } catch (const std::exception& e) {
+    std::cerr << std::format("Failed to convert image: {}\n", e.what());
+    error = e.what();
+  }
 
-  return success ? 0 : 1;
+  if (stats_writer) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    stats_writer->image(image, error);
+    stats_writer->run(elapsed.count());
+  }
+  return error.empty() ? 0 : 1;
 }
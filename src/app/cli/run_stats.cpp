@@ -0,0 +1,294 @@
+#include "run_stats.hpp"
+
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+#include "batch.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+// clang-format off
+#include <windows.h>  // Must precede psapi.h
+#include <psapi.h>
+// clang-format on
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+namespace psm_cli {
+
+namespace {
+constexpr std::array<const char*, 3> kStageNames{"decode", "convert",
+                                                 "encode"};
+
+// Tiled, streamed and mapped conversions interleave the three stages, so
+// their time is reported as one
+constexpr const char* kFusedStageName = "fused";
+
+#ifdef _WIN32
+double filetime_seconds(const FILETIME& time) {
+  ULARGE_INTEGER ticks;
+  ticks.LowPart = time.dwLowDateTime;
+  ticks.HighPart = time.dwHighDateTime;
+  return static_cast<double>(ticks.QuadPart) * 1e-7;
+}
+#else
+double timeval_seconds(const timeval& time) {
+  return static_cast<double>(time.tv_sec) +
+         static_cast<double>(time.tv_usec) * 1e-6;
+}
+#endif
+
+struct Dimensions {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  int bit_depth = 0;
+};
+
+// Dimensions of the decoded image or of the input of a one-pass conversion,
+// or read from the input's header when it was restored from the cache
+// without decoding
+Dimensions dimensions_of(const PipelineImage& image) {
+  if (image.ycbcr) {
+    return {image.ycbcr->width, image.ycbcr->height, 3, 8};
+  }
+  if (image.one_pass) {
+    const ImageInfo& info = image.one_pass->info;
+    return {info.width, info.height, info.channels, info.bit_depth};
+  }
+  Dimensions dimensions;
+  std::visit(
+      [&](const auto& image_data) {
+        using DataType = std::decay_t<decltype(*image_data.data())>;
+        if (image_data) {
+          dimensions = {image_data.width(), image_data.height(),
+                        image_data.channels(),
+                        static_cast<int>(sizeof(DataType) * 8)};
+        }
+      },
+      image.image);
+  if (dimensions.width > 0 || is_stdio_path(image.options.input_file)) {
+    return dimensions;
+  }
+  try {
+    const ImageInfo info = read_image_info(image.options.input_file);
+    return {info.width, info.height, info.channels, info.bit_depth};
+  } catch (const std::exception&) {
+    return dimensions;
+  }
+}
+
+std::optional<uintmax_t> file_size_of(const std::string& path) {
+  if (is_stdio_path(path)) {
+    return std::nullopt;
+  }
+  std::error_code error;
+  const uintmax_t size = std::filesystem::file_size(path, error);
+  return error ? std::nullopt : std::optional(size);
+}
+
+std::string json_string(std::string_view text) {
+  std::string quoted = "\"";
+  for (const char c : text) {
+    switch (c) {
+      case '"':
+        quoted += "\\\"";
+        break;
+      case '\\':
+        quoted += "\\\\";
+        break;
+      case '\n':
+        quoted += "\\n";
+        break;
+      case '\r':
+        quoted += "\\r";
+        break;
+      case '\t':
+        quoted += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          quoted += std::format("\\u{:04x}", static_cast<unsigned char>(c));
+        } else {
+          quoted += c;
+        }
+    }
+  }
+  quoted += '"';
+  return quoted;
+}
+
+template <typename T>
+std::string json_optional(const std::optional<T>& value) {
+  return value ? std::format("{}", *value) : "null";
+}
+
+std::string json_stage(std::string_view name, const StageTime& time) {
+  return std::format("\"{}\":{{\"wall_s\":{:.6f},\"cpu_s\":{:.6f}}}", name,
+                     time.wall_seconds, time.cpu_seconds);
+}
+
+// The separate stages, followed by the fused one if @p fused is given
+std::string json_stages(const std::array<StageTime, 3>& stages,
+                        const StageTime* fused = nullptr) {
+  std::string json = "{";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    json += (i ? "," : "") + json_stage(kStageNames[i], stages[i]);
+  }
+  if (fused) {
+    json += "," + json_stage(kFusedStageName, *fused);
+  }
+  return json + "}";
+}
+
+double megapixels_per_second(uint64_t pixels, double seconds) {
+  return seconds > 0.0 ? static_cast<double>(pixels) / 1e6 / seconds : 0.0;
+}
+}  // anonymous namespace
+
+double thread_cpu_seconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0.0;
+  }
+  return filetime_seconds(kernel) + filetime_seconds(user);
+#else
+  timespec time{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+    return 0.0;
+  }
+  return static_cast<double>(time.tv_sec) +
+         static_cast<double>(time.tv_nsec) * 1e-9;
+#endif
+}
+
+double process_cpu_seconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel,
+                       &user)) {
+    return 0.0;
+  }
+  return filetime_seconds(kernel) + filetime_seconds(user);
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  return timeval_seconds(usage.ru_utime) + timeval_seconds(usage.ru_stime);
+#endif
+}
+
+size_t peak_rss_bytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss);  // Bytes on macOS
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;  // Kilobytes elsewhere
+#endif
+#endif
+}
+
+void StatsWriter::image(const PipelineImage& image, std::string_view error) {
+  const CLIOptions& options = image.options;
+  const Dimensions dimensions = dimensions_of(image);
+  std::optional<uintmax_t> bytes_read = file_size_of(options.input_file);
+  if (!bytes_read && image.one_pass && image.one_pass->bytes_read > 0) {
+    bytes_read = image.one_pass->bytes_read;
+  }
+  const std::optional<uintmax_t> bytes_written =
+      error.empty() ? file_size_of(options.output_file) : std::nullopt;
+  const uint64_t pixels = static_cast<uint64_t>(dimensions.width) *
+                          static_cast<uint64_t>(dimensions.height);
+
+  StageTime total;
+  for (const StageTime& stage : image.stats.stages) {
+    total.wall_seconds += stage.wall_seconds;
+    total.cpu_seconds += stage.cpu_seconds;
+  }
+
+  const char* status = !error.empty()          ? "failed"
+                       : image.stats.cached ? "cached"
+                                            : "converted";
+  const auto dimension = [&](int value) {
+    return value > 0 ? std::to_string(value) : std::string("null");
+  };
+  std::string record = std::format(
+      "{{\"type\":\"image\",\"input\":{},\"output\":{},\"status\":\"{}\"",
+      json_string(options.input_file), json_string(options.output_file),
+      status);
+  if (!error.empty()) {
+    record += std::format(",\"error\":{}", json_string(error));
+  }
+  record += std::format(
+      ",\"width\":{},\"height\":{},\"channels\":{},\"bit_depth\":{},"
+      "\"from\":{},\"to\":{},\"bytes_read\":{},\"bytes_written\":{},"
+      "\"stages\":{},\"wall_s\":{:.6f},\"cpu_s\":{:.6f},\"mpix_per_s\":{:.3f}"
+      "}}\n",
+      dimension(dimensions.width), dimension(dimensions.height),
+      dimension(dimensions.channels), dimension(dimensions.bit_depth),
+      json_string(options.from_space), json_string(options.to_space),
+      json_optional(bytes_read), json_optional(bytes_written),
+      image.one_pass
+          ? "{" + json_stage(kFusedStageName, image.stats.stages[0]) + "}"
+          : json_stages(image.stats.stages),
+      total.wall_seconds, total.cpu_seconds,
+      megapixels_per_second(pixels, total.wall_seconds));
+
+  std::lock_guard lock(mutex_);
+  out_ << record << std::flush;
+  images_++;
+  failed_ += error.empty() ? 0 : 1;
+  cached_ += image.stats.cached ? 1 : 0;
+  if (error.empty()) {
+    pixels_ += pixels;
+    bytes_written_ += bytes_written.value_or(0);
+  }
+  bytes_read_ += bytes_read.value_or(0);
+  if (image.one_pass) {
+    fused_.wall_seconds += image.stats.stages[0].wall_seconds;
+    fused_.cpu_seconds += image.stats.stages[0].cpu_seconds;
+    return;
+  }
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    stages_[i].wall_seconds += image.stats.stages[i].wall_seconds;
+    stages_[i].cpu_seconds += image.stats.stages[i].cpu_seconds;
+  }
+}
+
+void StatsWriter::run(double wall_seconds) {
+  std::lock_guard lock(mutex_);
+  out_ << std::format(
+              "{{\"type\":\"run\",\"images\":{},\"converted\":{},"
+              "\"failed\":{},\"cached\":{},\"megapixels\":{:.3f},"
+              "\"bytes_read\":{},\"bytes_written\":{},\"stages\":{},"
+              "\"wall_s\":{:.6f},\"cpu_s\":{:.6f},\"mpix_per_s\":{:.3f},"
+              "\"peak_rss_bytes\":{}}}\n",
+              images_, images_ - failed_, failed_, cached_,
+              static_cast<double>(pixels_) / 1e6, bytes_read_,
+              bytes_written_, json_stages(stages_, &fused_), wall_seconds,
+              process_cpu_seconds(),
+              megapixels_per_second(pixels_, wall_seconds), peak_rss_bytes())
+       << std::flush;
+}
+
+}  // namespace psm_cli
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+
+namespace psm_cli {
+
+struct PipelineImage;
+
+/// Wall and CPU seconds one image spent in one stage
+struct StageTime {
+  double wall_seconds = 0.0;
+  double cpu_seconds = 0.0;
+};
+
+/// What --stats reports about one image besides its options and files
+struct ImageStats {
+  /// Decode, convert and encode; all in decode for a one-pass image
+  std::array<StageTime, 3> stages;
+  bool cached = false;  ///< Restored from --cache-dir
+};
+
+/// CPU time of the calling thread
+double thread_cpu_seconds();
+
+/// CPU time of the whole process, all threads included
+double process_cpu_seconds();
+
+/// Largest resident set of the process so far, 0 where unknown
+size_t peak_rss_bytes();
+
+/**
+ * @brief Adds the wall and calling-thread CPU time of its scope to a
+ * StageTime, also when the scope is left by an exception
+ *
+ * Threads a stage starts itself, such as --png-threads compressors, are not
+ * included in the CPU time.
+ */
+class StageTimer {
+ public:
+  explicit StageTimer(StageTime& time)
+      : time_(time),
+        wall_start_(std::chrono::steady_clock::now()),
+        cpu_start_(thread_cpu_seconds()) {}
+  ~StageTimer() {
+    const std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - wall_start_;
+    time_.wall_seconds += wall.count();
+    time_.cpu_seconds += thread_cpu_seconds() - cpu_start_;
+  }
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+ private:
+  StageTime& time_;
+  std::chrono::steady_clock::time_point wall_start_;
+  double cpu_start_;
+};
+
+/**
+ * @brief Writes --stats json records, one JSON object per line
+ *
+ * Every image gets a record of type "image" with its dimensions, bit depth,
+ * color spaces, file sizes, per-stage wall and CPU seconds and throughput.
+ * Tiled, streamed and mapped images run the stages interleaved in one pass,
+ * so they get a single "fused" stage instead. The run ends with a record of
+ * type "run" holding the totals, the process CPU time and the peak resident
+ * set. Lines are written whole under a lock, so records from parallel workers
+ * never interleave. Safe to use from several threads.
+ */
+class StatsWriter {
+ public:
+  explicit StatsWriter(std::ostream& out) : out_(out) {}
+
+  /// Writes the record of @p image; @p error is empty if it was converted
+  void image(const PipelineImage& image, std::string_view error = {});
+
+  /// Writes the run record with the totals of every image written so far
+  void run(double wall_seconds);
+
+ private:
+  std::ostream& out_;
+  std::mutex mutex_;
+  size_t images_ = 0;
+  size_t failed_ = 0;
+  size_t cached_ = 0;
+  uint64_t pixels_ = 0;
+  uintmax_t bytes_read_ = 0;
+  uintmax_t bytes_written_ = 0;
+  std::array<StageTime, 3> stages_;
+  StageTime fused_;  // Tiled, streamed and mapped images
+};
+
+}  // namespace psm_cli
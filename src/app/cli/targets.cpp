@@ -0,0 +1,165 @@
+#include "targets.hpp"
+
+#include <chrono>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "batch.hpp"
+#include "image_io/image_io.hpp"
+#include "image_processor/image_processor.hpp"
+
+namespace psm_cli {
+
+namespace {
+LoadOptions target_load_options(const CLIOptions& options) {
+  bool any_png = false;
+  bool any_mapped = false;
+  for (const OutputTarget& target : options.targets) {
+    const ImageFormat format = options.out_format != ImageFormat::UNKNOWN
+                                   ? options.out_format
+                                   : detect_format(target.output_file);
+    any_png = any_png || format == ImageFormat::PNG;
+    any_mapped = any_mapped || is_mapped_format(format);
+  }
+  LoadOptions load = load_options(options);
+  // Mapped formats cannot store alpha, and all targets share one decode
+  load.keep_alpha = any_png && !any_mapped;
+  return load;
+}
+
+// Converts the shared sRGB pixels to one target and writes it
+template <typename DataType>
+void write_target(const ImageData<DataType>& image,
+                  std::span<const DataType> hub, const CLIOptions& options,
+                  const OutputTarget& target) {
+  CLIOptions target_options = options;
+  target_options.to_space = target.to_space;
+  target_options.output_file = target.output_file;
+
+  std::vector<DataType> output(hub.size());
+  std::vector<DataType> scratch;
+  process_hub_pixels<DataType>(hub, output, scratch, target_options,
+                               image.channels());
+
+  ImageEncoder encoder(options.png);
+  const ImageData<DataType> output_image(std::move(output), image.width(),
+                                         image.height(), image.channels());
+  if (!encoder.encode(output_image, target.output_file, options.out_format)) {
+    throw std::runtime_error(
+        std::format("Failed to save image: {}", target.output_file));
+  }
+}
+
+template <typename DataType>
+int convert_targets(const ImageData<DataType>& image,
+                    std::string_view from_space, const CLIOptions& options) {
+  const std::span<const DataType> input{image.data(), image.size()};
+
+  // The source half of every conversion is the same, so it runs once;
+  // from sRGB it is a copy and the decoded pixels are used as they are
+  std::vector<DataType> hub_storage;
+  std::span<const DataType> hub = input;
+  if (from_space != "sRGB") {
+    hub_storage.resize(input.size());
+    convert_to_hub<DataType>(input, hub_storage, from_space,
+                             image.channels());
+    hub = hub_storage;
+  }
+
+  std::vector<std::string> errors(options.targets.size());
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(options.targets.size());
+    for (size_t i = 0; i < options.targets.size(); ++i) {
+      threads.emplace_back([&, i] {
+        try {
+          write_target<DataType>(image, hub, options, options.targets[i]);
+        } catch (const std::exception& e) {
+          errors[i] = e.what();
+        }
+      });
+    }
+  }
+
+  int status = 0;
+  for (size_t i = 0; i < options.targets.size(); ++i) {
+    const OutputTarget& target = options.targets[i];
+    if (errors[i].empty()) {
+      std::cout << std::format("Saved {} target: {}\n", target.to_space,
+                               target.output_file);
+    } else {
+      std::cerr << std::format("Failed {} target {}: {}\n", target.to_space,
+                               target.output_file, errors[i]);
+      status = 1;
+    }
+  }
+  return status;
+}
+}  // anonymous namespace
+
+int run_targets(const CLIOptions& options) {
+  if (is_batch(options)) {
+    throw std::runtime_error("--to SPACE:FILE targets need a single input");
+  }
+  if (is_stdio_path(options.input_file)) {
+    throw std::runtime_error("--to SPACE:FILE targets cannot read stdin");
+  }
+  for (const OutputTarget& target : options.targets) {
+    if (is_stdio_path(target.output_file)) {
+      throw std::runtime_error("--to SPACE:FILE targets cannot write stdout");
+    }
+  }
+
+  if (options.stream) {
+    std::cout << "--stream has no effect with --to SPACE:FILE targets\n";
+  }
+  if (options.tiled) {
+    std::cout << "--tiled has no effect with --to SPACE:FILE targets\n";
+  }
+  if (options.ycbcr) {
+    std::cout << "--ycbcr has no effect with --to SPACE:FILE targets\n";
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::cout << std::format("Loading image: {}\n", options.input_file);
+  ImageDecoder decoder;
+  ImageVariant image =
+      decoder.decode(options.input_file, target_load_options(options));
+
+  const int status = std::visit(
+      [&](auto& image_data) {
+        using DataType = std::decay_t<decltype(*image_data.data())>;
+        if (!image_data) {
+          throw std::runtime_error(
+              std::format("Failed to load image: {}", options.input_file));
+        }
+        // Every target is resized once, as part of the shared source half
+        const std::string from_space =
+            options.resize
+                ? resize_for_conversion<DataType>(image_data, options)
+                : options.from_space;
+        std::cout << std::format(
+            "Converting {}x{} {}-bit image from {} to {} targets\n",
+            image_data.width(), image_data.height(), sizeof(DataType) * 8,
+            options.from_space, options.targets.size());
+        return convert_targets<DataType>(image_data, from_space, options);
+      },
+      image);
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << std::format("Finished {} targets in {:.3f} s\n",
+                           options.targets.size(), elapsed.count());
+  return status;
+}
+
+}  // namespace psm_cli
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "cli_parser.hpp"
+
+namespace psm_cli {
+
+/**
+ * @brief Converts options.input_file to every --to SPACE:FILE target in
+ * options.targets
+ *
+ * The input is decoded once and converted once to sRGB, the stage every
+ * conversion passes through. Each target then runs on its own thread, reading
+ * the shared pixels and converting, adjusting and encoding into its own
+ * buffer, so the output of each target is identical to a separate
+ * `-t SPACE -o FILE` run. Alpha is kept if any target is a PNG and none is a
+ * mapped format.
+ *
+ * @return 0 if every target was written, 1 otherwise
+ * @throws std::runtime_error if the input cannot be decoded, or for a batch
+ * or standard input or output, which need a single target
+ */
+int run_targets(const CLIOptions& options);
+
+}  // namespace psm_cli
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
 #include <span>
+#include <stop_token>
 #include <string>
 #include <variant>
 #include <vector>
@@ -28,6 +34,8 @@ struct AppState {
     std::string load_path;
     std::string save_path;
     bool is_loaded = false;
+    // display_data is the finished conversion for the current settings; false
+    // while a conversion runs, when the previous display is still shown
     bool is_processed = false;
 
     // Support both 8-bit and 16-bit image data
@@ -41,6 +49,12 @@ struct AppState {
     int height = 0;
     int channels = 3;       // Default to RGB
     bool is_16bit = false;  // Track if we're working with 16-bit data
+    // Size of converted_data and display_data, which keep the previous
+    // image's size until a conversion of a resized original lands
+    int display_width = 0;
+    int display_height = 0;
+    // Reduced-resolution JPEG decode shown while full_decode runs
+    bool is_preview = false;
 
     bool hasValidImage() const {
       return is_loaded && width > 0 && height > 0 &&
@@ -48,6 +62,10 @@ struct AppState {
                         original_data);
     }
 
+    bool hasDisplayImage() const {
+      return display_width > 0 && display_height > 0;
+    }
+
     size_t getImageSize() const {
       return static_cast<size_t>(width) * height * channels;
     }
@@ -78,11 +96,84 @@ struct AppState {
       display_data = std::vector<unsigned char>{};
       width = 0;
       height = 0;
+      display_width = 0;
+      display_height = 0;
       channels = 3;
       is_16bit = false;
+      is_preview = false;
     }
   } image;
 
+  // Full-resolution decode running on a background thread behind a preview
+  struct FullDecode {
+    struct Result {
+      ImageData::ImageVariant data;
+      int width = 0;
+      int height = 0;
+      int channels = 3;
+    };
+
+    // Decodes the full image, returning early once the token is stopped
+    using Decoder = std::function<Result(std::stop_token)>;
+
+    std::future<Result> pending;
+    std::stop_source stop;
+    // Abandoned decodes, kept until they see the stop request: destroying a
+    // std::async future waits for its task, which would stall the UI thread
+    std::vector<std::future<Result>> retired;
+
+    FullDecode() = default;
+    FullDecode(const FullDecode&) = delete;
+    FullDecode& operator=(const FullDecode&) = delete;
+    ~FullDecode() { stop.request_stop(); }
+
+    bool isRunning() const { return pending.valid(); }
+
+    // Abandons the running decode and starts @p decode in the background
+    void start(Decoder decode) {
+      abandon();
+      stop = std::stop_source{};
+      pending =
+          std::async(std::launch::async, std::move(decode), stop.get_token());
+    }
+
+    // Asks the running decode to stop and retires it without waiting
+    void abandon() {
+      reap();
+      if (pending.valid()) {
+        stop.request_stop();
+        retired.push_back(std::move(pending));
+      }
+    }
+
+    // Drops the retired decodes that have finished
+    void reap() {
+      std::erase_if(retired, [](const std::future<Result>& decode) {
+        return decode.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+      });
+    }
+  } full_decode;
+
+  // Color space conversion running on a background thread
+  struct Conversion {
+    struct Result {
+      bool completed = false;  // false if the conversion was cancelled
+      ImageData::ImageVariant converted_data;
+      ImageData::ImageVariant display_data;
+      int width = 0;
+      int height = 0;
+    };
+
+    std::future<Result> pending;
+    std::stop_source stop;
+    // Shared with the worker, which updates it after every chunk
+    std::shared_ptr<std::atomic<float>> progress =
+        std::make_shared<std::atomic<float>>(0.0f);
+
+    bool isRunning() const { return pending.valid(); }
+  } conversion;
+
   // UI control state
   struct Controls {
     int vertical_slider = 0;
@@ -150,6 +241,9 @@ struct AppState {
 
   // Reset to initial state
   void reset() {
+    conversion.stop.request_stop();
+    conversion = Conversion{};
+    full_decode.abandon();
     window = WindowSize{};
     image.clear();
     controls.resetSliders();
@@ -34,7 +34,7 @@ Application::Application() {
   int winW = static_cast<int>(screenW * target_width + 0.5f);
   int winH = static_cast<int>(screenH * target_height + 0.5f);
 
-  state_ = AppState{winW, winH};
+  state_.window = {winW, winH};
 
   controller::SliderConfig::updateLabels(state_);
 
@@ -61,6 +61,9 @@ Application::Application() {
 }
 
 Application::~Application() {
+  // Let a running conversion stop at its next chunk instead of finishing
+  state_.conversion.stop.request_stop();
+
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
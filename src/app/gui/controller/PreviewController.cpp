@@ -33,8 +33,8 @@ GLuint PreviewController::getOrCreateTexture() {
   }
 
   bool image_changed = last_image_update_ != current_image_data;
-  bool size_changed =
-      last_width_ != state_.image.width || last_height_ != state_.image.height;
+  bool size_changed = last_width_ != state_.image.display_width ||
+                      last_height_ != state_.image.display_height;
   bool processed_changed = last_processed_ != state_.image.is_processed;
   bool colorspace_changed = last_colorspace_ != state_.selected_colorspace;
   bool bit_depth_changed = last_is_16bit_ != state_.image.is_16bit;
@@ -55,21 +55,21 @@ GLuint PreviewController::getOrCreateTexture() {
       // Use 16-bit texture format for 16-bit images
       const auto& display_data =
           std::get<std::vector<uint16_t>>(state_.image.display_data);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16, state_.image.width,
-                   state_.image.height, 0, GL_RGB, GL_UNSIGNED_SHORT,
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16, state_.image.display_width,
+                   state_.image.display_height, 0, GL_RGB, GL_UNSIGNED_SHORT,
                    display_data.data());
     } else {
       // Use 8-bit texture format for 8-bit images
       const auto& display_data =
           std::get<std::vector<unsigned char>>(state_.image.display_data);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, state_.image.width,
-                   state_.image.height, 0, GL_RGB, GL_UNSIGNED_BYTE,
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, state_.image.display_width,
+                   state_.image.display_height, 0, GL_RGB, GL_UNSIGNED_BYTE,
                    display_data.data());
     }
 
     last_image_update_ = current_image_data;
-    last_width_ = state_.image.width;
-    last_height_ = state_.image.height;
+    last_width_ = state_.image.display_width;
+    last_height_ = state_.image.display_height;
     last_processed_ = state_.image.is_processed;
     last_colorspace_ = state_.selected_colorspace;
     last_is_16bit_ = state_.image.is_16bit;
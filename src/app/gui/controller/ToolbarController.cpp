@@ -2,8 +2,13 @@
 
 #include <nfd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <future>
 #include <iostream>
 #include <span>
+#include <stop_token>
 #include <string>
 #include <vector>
 
@@ -12,6 +17,7 @@
 #include "image_io/image_io.hpp"
 #include "image_processor/image_processor.hpp"
 #include "psm/adjust_channels.hpp"
+#include "psm/async.hpp"
 #include "psm/detail/orgb.hpp"
 #include "psm/detail/pro_photo_rgb.hpp"
 #include "psm/detail/srgb.hpp"
@@ -22,6 +28,48 @@ namespace psm_gui::controller {
 
 ToolbarController::ToolbarController(AppState& state) : state_(state) {}
 
+namespace {
+// Longer side of the reduced-resolution JPEG shown while the full image loads
+constexpr int kPreviewMaxDim = 1024;
+
+// Copies decoded samples into the GUI's own buffer
+template <typename DataType>
+std::vector<DataType> copyImageData(
+    const psm_cli::ImageData<DataType>& image_data) {
+  return std::vector<DataType>(image_data.data(),
+                               image_data.data() + image_data.size());
+}
+
+// Decodes the full image a row at a time, so that opening another file can
+// stop it between rows instead of waiting for the whole decode
+template <typename DataType>
+AppState::FullDecode::Result decodeRows(psm_cli::ImageRowReader& reader,
+                                        std::stop_token stop) {
+  const auto& info = reader.info();
+  const std::size_t row_samples =
+      static_cast<std::size_t>(info.width) * info.channels;
+  std::vector<DataType> data(row_samples * info.height);
+  for (std::size_t offset = 0; offset < data.size(); offset += row_samples) {
+    if (stop.stop_requested()) {
+      return {};
+    }
+    reader.read_row(std::span<DataType>(data).subspan(offset, row_samples));
+  }
+  return {.data = std::move(data),
+          .width = info.width,
+          .height = info.height,
+          .channels = info.channels};
+}
+
+AppState::FullDecode::Result decodeFullImage(const std::string& path,
+                                             std::stop_token stop) {
+  psm_cli::ImageRowReader reader(path);
+  return reader.info().bit_depth == 16
+             ? decodeRows<uint16_t>(reader, std::move(stop))
+             : decodeRows<uint8_t>(reader, std::move(stop));
+}
+}  // namespace
+
 void ToolbarController::loadImage() {
   nfdu8char_t* path = nullptr;
   nfdu8filteritem_t filters[2] = {{"PNG files", "png"},
@@ -35,56 +83,51 @@ void ToolbarController::loadImage() {
     state_.image.load_path = std::string(path);
     NFD_FreePathU8(path);
 
+    // A pending conversion still reads the current original data, and a
+    // pending full decode belongs to the previous file
+    cancelConversion();
+    state_.full_decode.abandon();
+    state_.image.is_processed = false;
+    state_.image.is_preview = false;
+    // The previous file stays off screen while the new one converts
+    state_.image.display_width = 0;
+    state_.image.display_height = 0;
+
     try {
-      auto image_variant = psm_cli::load_image(state_.image.load_path);
+      // Large JPEGs are shown from a DCT-scaled decode first, and replaced
+      // once the full-resolution decode finishes in the background
+      const auto info = psm_cli::read_image_info(state_.image.load_path);
+      const bool use_preview =
+          info.format == psm_cli::ImageFormat::JPEG &&
+          std::max(info.width, info.height) > kPreviewMaxDim;
+
+      psm_cli::LoadOptions load_options;
+      if (use_preview) {
+        load_options.max_dim = kPreviewMaxDim;
+      }
+      auto image_variant =
+          psm_cli::load_image(state_.image.load_path, load_options);
 
       // Visit the variant to handle both 8-bit and 16-bit images
       std::visit(
           [this](auto& image_data) {
             if (image_data) {
-              state_.image.width = image_data.width();
-              state_.image.height = image_data.height();
-              state_.image.channels = image_data.channels();
-
-              const size_t image_size = image_data.size();
-
-              // Determine if this is 16-bit data
-              using DataType = std::decay_t<decltype(*image_data.data())>;
-              constexpr bool is_16bit = std::is_same_v<DataType, uint16_t>;
-              state_.image.is_16bit = is_16bit;
-
-              if constexpr (is_16bit) {
-                // Store 16-bit data directly
-                std::vector<uint16_t> original_data(image_size);
-                std::copy(image_data.data(), image_data.data() + image_size,
-                          original_data.begin());
-                state_.image.original_data = std::move(original_data);
-
-                // Initialize converted and display data as 16-bit
-                state_.image.converted_data = std::vector<uint16_t>(image_size);
-                state_.image.display_data = std::vector<uint16_t>(image_size);
-              } else {
-                // Store 8-bit data directly
-                std::vector<unsigned char> original_data(image_size);
-                std::copy(image_data.data(), image_data.data() + image_size,
-                          original_data.begin());
-                state_.image.original_data = std::move(original_data);
-
-                // Initialize converted and display data as 8-bit
-                state_.image.converted_data =
-                    std::vector<unsigned char>(image_size);
-                state_.image.display_data =
-                    std::vector<unsigned char>(image_size);
-              }
-
-              state_.image.is_loaded = true;
-              convertImage();
+              setImage(copyImageData(image_data), image_data.width(),
+                       image_data.height(), image_data.channels());
             } else {
               state_.image.is_loaded = false;
             }
           },
           image_variant);
 
+      state_.image.is_preview = use_preview && state_.image.is_loaded;
+      if (state_.image.is_preview) {
+        state_.full_decode.start(
+            [load_path = state_.image.load_path](std::stop_token stop) {
+              return decodeFullImage(load_path, std::move(stop));
+            });
+      }
+
     } catch (const std::exception& e) {
       std::cerr << "Failed to load image: " << state_.image.load_path << " - "
                 << e.what() << std::endl;
@@ -93,7 +136,69 @@ void ToolbarController::loadImage() {
   }
 }
 
+template <typename DataType>
+void ToolbarController::setImage(std::vector<DataType> original_data,
+                                 int width, int height, int channels) {
+  state_.image.width = width;
+  state_.image.height = height;
+  state_.image.channels = channels;
+
+  state_.image.is_16bit = std::is_same_v<DataType, uint16_t>;
+  state_.image.original_data = std::move(original_data);
+
+  // Converted and display data share the original's bit depth. Data of the
+  // same depth is kept on screen until the conversion replaces it, so the
+  // switch from a preview to the full image never shows a blank frame
+  if (!std::holds_alternative<std::vector<DataType>>(
+          state_.image.display_data)) {
+    state_.image.converted_data = std::vector<DataType>{};
+    state_.image.display_data = std::vector<DataType>{};
+    state_.image.display_width = 0;
+    state_.image.display_height = 0;
+  }
+
+  state_.image.is_loaded = true;
+  convertImage();
+}
+
+void ToolbarController::pollFullDecode() {
+  state_.full_decode.reap();
+  auto& pending = state_.full_decode.pending;
+  if (!pending.valid() ||
+      pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+
+  try {
+    auto result = pending.get();
+
+    // The conversion of the preview reads the data being replaced
+    cancelConversion();
+    std::visit(
+        [this, &result](auto& data) {
+          setImage(std::move(data), result.width, result.height,
+                   result.channels);
+        },
+        result.data);
+    state_.image.is_preview = false;
+  } catch (const std::exception& e) {
+    // Keep showing the preview
+    std::cerr << "Failed to load full-resolution image: "
+              << state_.image.load_path << " - " << e.what() << std::endl;
+  }
+}
+
 void ToolbarController::saveImage() {
+  if (state_.image.is_preview) {
+    std::cerr << "Full-resolution image is still loading" << std::endl;
+    return;
+  }
+  // Until the conversion lands, display_data holds the previous settings
+  if (state_.conversion.isRunning()) {
+    std::cerr << "Conversion is still running" << std::endl;
+    return;
+  }
+
   nfdu8char_t* path = nullptr;
   nfdu8filteritem_t filters[2] = {{"PNG files", "png"},
                                   {"JPEG files", "jpeg, jpg"}};
@@ -116,16 +221,16 @@ void ToolbarController::saveImage() {
         std::vector<uint16_t> display_data =
             std::get<std::vector<uint16_t>>(state_.image.display_data);
         psm_cli::ImageData<uint16_t> image_data(
-            std::move(display_data), state_.image.width, state_.image.height,
-            state_.image.channels);
+            std::move(display_data), state_.image.display_width,
+            state_.image.display_height, state_.image.channels);
         success = psm_cli::save_image(image_data, state_.image.save_path);
       } else {
         // Save 8-bit image
         std::vector<unsigned char> display_data =
             std::get<std::vector<unsigned char>>(state_.image.display_data);
         psm_cli::ImageData<uint8_t> image_data(
-            std::move(display_data), state_.image.width, state_.image.height,
-            state_.image.channels);
+            std::move(display_data), state_.image.display_width,
+            state_.image.display_height, state_.image.channels);
         success = psm_cli::save_image(image_data, state_.image.save_path);
       }
 
@@ -157,92 +262,122 @@ void ToolbarController::updateColorSpace(int colorspace) {
 void ToolbarController::convertImage() {
   if (!state_.image.is_loaded) return;
 
-  const size_t image_size = state_.image.getImageSize();
+  // Abandon an older conversion; its result is no longer wanted
+  cancelConversion();
+  state_.image.is_processed = false;
 
   if (state_.image.is_16bit) {
-    // Handle 16-bit image conversion
-    std::vector<uint16_t>& original_data =
-        std::get<std::vector<uint16_t>>(state_.image.original_data);
-    std::vector<uint16_t>& converted_data =
-        std::get<std::vector<uint16_t>>(state_.image.converted_data);
-    std::vector<uint16_t>& display_data =
-        std::get<std::vector<uint16_t>>(state_.image.display_data);
-
-    if (original_data.empty()) return;
-
-    converted_data.resize(image_size);
-    display_data.resize(image_size);
-
-    std::span<const uint16_t> input_span{original_data};
-    std::span<uint16_t> converted_span{converted_data};
-
-    try {
-      // Use shared image processor for consistent color space conversion
-      psm_cli::convert_colorspace<uint16_t>(input_span, converted_span, 0,
-                                            state_.selected_colorspace);
-
-      std::copy(converted_data.begin(), converted_data.end(),
-                display_data.begin());
-
-      if (state_.selected_colorspace ==
-          3) {  // oRGB - convert back to sRGB for display
-        std::vector<uint16_t> temp_image(display_data.size());
-        std::span<uint16_t> temp_span{temp_image};
-
-        psm_cli::convert_colorspace<uint16_t>(std::span<uint16_t>{display_data},
-                                              temp_span, 3, 0);  // oRGB to sRGB
-
-        std::copy(temp_image.begin(), temp_image.end(), display_data.begin());
-      }
-
-      state_.image.is_processed = true;
-    } catch (const std::exception& e) {
-      std::cerr << "Error converting 16-bit image: " << e.what() << std::endl;
-      state_.image.is_processed = false;
-    }
+    startConversion<uint16_t>();
   } else {
-    // Handle 8-bit image conversion (existing logic)
-    std::vector<unsigned char>& original_data =
-        std::get<std::vector<unsigned char>>(state_.image.original_data);
-    std::vector<unsigned char>& converted_data =
-        std::get<std::vector<unsigned char>>(state_.image.converted_data);
-    std::vector<unsigned char>& display_data =
-        std::get<std::vector<unsigned char>>(state_.image.display_data);
-
-    if (original_data.empty()) return;
-
-    converted_data.resize(image_size);
-    display_data.resize(image_size);
-
-    std::span<const unsigned char> input_span{original_data};
-    std::span<unsigned char> converted_span{converted_data};
-
-    try {
-      // Use shared image processor for consistent color space conversion
-      psm_cli::convert_colorspace<unsigned char>(input_span, converted_span, 0,
-                                                 state_.selected_colorspace);
+    startConversion<unsigned char>();
+  }
+}
 
-      std::copy(converted_data.begin(), converted_data.end(),
-                display_data.begin());
+template <typename DataType>
+void ToolbarController::startConversion() {
+  const std::vector<DataType>& original_data =
+      std::get<std::vector<DataType>>(state_.image.original_data);
+
+  if (original_data.empty()) return;
+
+  auto& conversion = state_.conversion;
+  conversion.stop = std::stop_source{};
+  conversion.progress->store(0.0f);
+
+  // The original data is not modified while a conversion is pending:
+  // loadImage() cancels it first
+  const std::span<const DataType> input_span{original_data};
+  const int colorspace = state_.selected_colorspace;
+  const int width = state_.image.width;
+  const int height = state_.image.height;
+
+  // oRGB is converted back to sRGB for display, which takes a second pass
+  const int passes = colorspace == 3 ? 2 : 1;
+  auto pass_options = [passes, progress = conversion.progress,
+                       token = conversion.stop.get_token()](int pass) {
+    return psm::AsyncOptions{
+        .on_progress =
+            [=](size_t done, size_t total) {
+              progress->store((static_cast<float>(pass) +
+                               static_cast<float>(done) /
+                                   static_cast<float>(total)) /
+                              static_cast<float>(passes));
+            },
+        .stop_token = token};
+  };
+
+  conversion.pending = std::async(std::launch::async, [=] {
+    AppState::Conversion::Result result;
+
+    // Use shared image processor for consistent color space conversion
+    std::vector<DataType> converted_data(input_span.size());
+    if (!psm_cli::convert_colorspace_chunked<DataType>(
+            input_span, std::span<DataType>{converted_data}, 0, colorspace,
+            pass_options(0))) {
+      return result;
+    }
 
-      if (state_.selected_colorspace ==
-          3) {  // oRGB - convert back to sRGB for display
-        std::vector<unsigned char> temp_image(display_data.size());
-        std::span<unsigned char> temp_span{temp_image};
+    std::vector<DataType> display_data(converted_data);
+    if (colorspace == 3 &&  // oRGB - convert back to sRGB for display
+        !psm_cli::convert_colorspace_chunked<DataType>(
+            std::span<const DataType>{converted_data},
+            std::span<DataType>{display_data}, 3, 0, pass_options(1))) {
+      return result;
+    }
 
-        psm_cli::convert_colorspace<unsigned char>(
-            std::span<unsigned char>{display_data}, temp_span, 3,
-            0);  // oRGB to sRGB
+    result.completed = true;
+    result.converted_data = std::move(converted_data);
+    result.display_data = std::move(display_data);
+    result.width = width;
+    result.height = height;
+    return result;
+  });
+}
 
-        std::copy(temp_image.begin(), temp_image.end(), display_data.begin());
-      }
+void ToolbarController::pollConversion() {
+  auto& pending = state_.conversion.pending;
+  if (!pending.valid() ||
+      pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
 
+  try {
+    auto result = pending.get();
+    if (result.completed) {
+      state_.image.converted_data = std::move(result.converted_data);
+      state_.image.display_data = std::move(result.display_data);
+      state_.image.display_width = result.width;
+      state_.image.display_height = result.height;
       state_.image.is_processed = true;
-    } catch (const std::exception& e) {
-      std::cerr << "Error converting 8-bit image: " << e.what() << std::endl;
-      state_.image.is_processed = false;
+      // Slider moves made while the conversion ran were not applied
+      if (state_.controls.vertical_slider != 0 ||
+          state_.controls.horizontal_slider != 0) {
+        std::visit(
+            [this](const auto& converted) {
+              auto& display = std::get<std::decay_t<decltype(converted)>>(
+                  state_.image.display_data);
+              std::copy(converted.begin(), converted.end(), display.begin());
+              SliderConfig::applyAdjustmentAndConvert(state_,
+                                                      std::span{display});
+            },
+            state_.image.converted_data);
+      }
+      PreviewController::forcePreviousUpdate();
     }
+  } catch (const std::exception& e) {
+    std::cerr << "Error converting " << (state_.image.is_16bit ? 16 : 8)
+              << "-bit image: " << e.what() << std::endl;
+    state_.image.is_processed = false;
   }
 }
 
+void ToolbarController::cancelConversion() {
+  auto& conversion = state_.conversion;
+  if (!conversion.pending.valid()) return;
+
+  conversion.stop.request_stop();
+  conversion.pending.wait();
+  conversion.pending = {};
+}
+
 }  // namespace psm_gui::controller
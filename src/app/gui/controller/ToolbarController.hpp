@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "app/AppState.hpp"
 
 namespace psm_gui::controller {
@@ -11,8 +13,17 @@ class ToolbarController {
   void saveImage();
   void updateColorSpace(int colorspace);
   void convertImage();
+  void pollConversion();
+  void cancelConversion();
+  void pollFullDecode();
 
  private:
+  template <typename DataType>
+  void startConversion();
+  template <typename DataType>
+  void setImage(std::vector<DataType> original_data, int width, int height,
+                int channels);
+
   AppState &state_;
 };
 
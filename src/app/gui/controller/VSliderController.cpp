@@ -7,7 +7,9 @@ namespace psm_gui::controller {
 VSliderController::VSliderController(AppState& state) : state_(state) {}
 
 void VSliderController::updateImage() {
-  if (state_.image.is_loaded) {
+  // While a conversion runs the data is stale; pollConversion applies the
+  // sliders once it lands
+  if (state_.image.is_loaded && state_.image.is_processed) {
     if (state_.image.is_16bit) {
       // Handle 16-bit image updates
       std::vector<uint16_t>& converted_data =
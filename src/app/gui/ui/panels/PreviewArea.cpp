@@ -16,7 +16,8 @@ void PreviewArea::draw(AppState& s, const PanelRect& r) {
 
   controller::PreviewController previewCtl(s);
 
-  if (s.image.is_loaded && s.image.is_processed) {
+  // The previous display stays up while a conversion runs
+  if (s.image.is_loaded && s.image.hasDisplayImage()) {
     GLuint texture_id = previewCtl.getOrCreateTexture();
 
     ImVec2 content_size = ImGui::GetContentRegionAvail();
@@ -25,8 +26,8 @@ void PreviewArea::draw(AppState& s, const PanelRect& r) {
     available_size.y = content_size.y - 10.0f;
 
     ImVec2 image_size;
-    float image_aspect_ratio =
-        static_cast<float>(s.image.width) / static_cast<float>(s.image.height);
+    float image_aspect_ratio = static_cast<float>(s.image.display_width) /
+                               static_cast<float>(s.image.display_height);
     float available_aspect_ratio = available_size.x / available_size.y;
 
     if (image_aspect_ratio > available_aspect_ratio) {
@@ -56,12 +57,13 @@ void PreviewArea::draw(AppState& s, const PanelRect& r) {
       float rel_x = (mouse_pos.x - image_pos.x) / image_size.x;
       float rel_y = (mouse_pos.y - image_pos.y) / image_size.y;
 
-      int pixel_x = static_cast<int>(rel_x * s.image.width);
-      int pixel_y = static_cast<int>(rel_y * s.image.height);
+      int pixel_x = static_cast<int>(rel_x * s.image.display_width);
+      int pixel_y = static_cast<int>(rel_y * s.image.display_height);
 
-      if (pixel_x >= 0 && pixel_x < s.image.width && pixel_y >= 0 &&
-          pixel_y < s.image.height) {
-        size_t idx = (pixel_y * s.image.width + pixel_x) * s.image.channels;
+      if (pixel_x >= 0 && pixel_x < s.image.display_width && pixel_y >= 0 &&
+          pixel_y < s.image.display_height) {
+        size_t idx =
+            (pixel_y * s.image.display_width + pixel_x) * s.image.channels;
 
         if (s.image.is_16bit) {
           const auto& display_data =
@@ -137,10 +139,10 @@ void PreviewArea::DrawMagnifyingGlass(AppState& s, GLuint texture_id,
   ImVec2 p_min = ImVec2(mag_center.x - radius, mag_center.y - radius);
   ImVec2 p_max = ImVec2(mag_center.x + radius, mag_center.y + radius);
 
-  float uv_half_width = (zoom_pixels + 0.5f) / s.image.width;
-  float uv_half_height = (zoom_pixels + 0.5f) / s.image.height;
-  ImVec2 uv_center = ImVec2((pixel_x + 0.5f) / s.image.width,
-                            (pixel_y + 0.5f) / s.image.height);
+  float uv_half_width = (zoom_pixels + 0.5f) / s.image.display_width;
+  float uv_half_height = (zoom_pixels + 0.5f) / s.image.display_height;
+  ImVec2 uv_center = ImVec2((pixel_x + 0.5f) / s.image.display_width,
+                            (pixel_y + 0.5f) / s.image.display_height);
   ImVec2 uv_min =
       ImVec2(uv_center.x - uv_half_width, uv_center.y - uv_half_height);
   ImVec2 uv_max =
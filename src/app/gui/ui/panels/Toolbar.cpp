@@ -8,6 +8,8 @@ namespace psm_gui::ui::panels {
 
 void Toolbar::draw(AppState& s, const PanelRect& r) {
   controller::ToolbarController toolbarCtl_(s);
+  toolbarCtl_.pollFullDecode();
+  toolbarCtl_.pollConversion();
 
   ImGuiWindowFlags flags = ImGuiWindowFlags_NoTitleBar |
                            ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove;
@@ -59,6 +61,18 @@ void Toolbar::draw(AppState& s, const PanelRect& r) {
     ImGui::PopItemWidth();
 
     ImGui::TableNextColumn();
+    if (s.conversion.isRunning()) {
+      ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 20.0f);
+      ImGui::ProgressBar(s.conversion.progress->load(),
+                         ImVec2(-(btnW + spacing + 20.0f), 0));
+      ImGui::SameLine();
+      if (ImGui::Button("Cancel", ImVec2(btnW, 0))) {
+        toolbarCtl_.cancelConversion();
+      }
+    } else if (s.image.is_preview) {
+      ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 20.0f);
+      ImGui::TextUnformatted("Preview - loading full resolution...");
+    }
 
     ImGui::TableNextColumn();
     float rightPadding = -20.0f;
@@ -69,9 +83,12 @@ void Toolbar::draw(AppState& s, const PanelRect& r) {
       toolbarCtl_.loadImage();
     }
     ImGui::SameLine();
+    // Saving waits for the conversion of the current settings
+    ImGui::BeginDisabled(s.conversion.isRunning());
     if (ImGui::Button("Save", ImVec2(btnW, 0))) {
       toolbarCtl_.saveImage();
     }
+    ImGui::EndDisabled();
 
     ImGui::EndTable();
   }
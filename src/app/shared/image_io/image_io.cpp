@@ -1,34 +1,56 @@
 #include "image_io.hpp"
 
 #include <png.h>
+#include <psm/detail/module_id.hpp>
+#include <psm/detail/trace.hpp>
 #include <turbojpeg.h>
 
-#include <cstdio>
+// clang-format off
+#include <cstdio>  // Must precede jpeglib.h
+#include <jpeglib.h>
+#include <jerror.h>
+// clang-format on
+
+#include <algorithm>
+#include <array>
+#include <csetjmp>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string_view>
 #include <type_traits>
 
+#include "png_encoder.hpp"
+#include "scratch_file.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 namespace psm_cli {
 
 namespace {
 constexpr int kDefaultJpegQuality = 95;
 constexpr int kTargetChannels = 3;  // RGB
 
+// Opens a file, or borrows stdin or stdout for the path "-"
 class FileHandle {
  public:
   explicit FileHandle(const std::string& filepath, const char* mode)
-      : file_(std::fopen(filepath.c_str(), mode)) {
+      : file_(open(filepath, mode)), owned_(!is_stdio_path(filepath)) {
     if (!file_) {
       throw std::runtime_error(std::format("Cannot open file: {}", filepath));
     }
   }
 
   ~FileHandle() {
-    if (file_) {
+    if (file_ && owned_) {
       std::fclose(file_);
+    } else if (file_) {
+      std::fflush(file_);
     }
   }
 
@@ -38,7 +60,20 @@ class FileHandle {
   FILE* get() const { return file_; }
 
  private:
+  static FILE* open(const std::string& filepath, const char* mode) {
+    if (!is_stdio_path(filepath)) {
+      return std::fopen(filepath.c_str(), mode);
+    }
+    FILE* stream = mode[0] == 'r' ? stdin : stdout;
+#ifdef _WIN32
+    // Keep the C runtime from translating line endings in image data
+    _setmode(_fileno(stream), _O_BINARY);
+#endif
+    return stream;
+  }
+
   FILE* file_;
+  bool owned_;
 };
 
 class TurboJpegHandle {
@@ -65,6 +100,131 @@ class TurboJpegHandle {
   tjhandle handle_;
 };
 
+// libpng and libjpeg report errors by longjmp. Every function that calls into
+// them sets its own jump target and turns the jump into an exception, so no
+// object with a destructor is ever skipped.
+
+class PngReadStruct {
+ public:
+  PngReadStruct()
+      : png_(png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                    nullptr)) {
+    if (!png_) {
+      throw std::runtime_error("Failed to create PNG read struct");
+    }
+    info_ = png_create_info_struct(png_);
+    if (!info_) {
+      png_destroy_read_struct(&png_, nullptr, nullptr);
+      throw std::runtime_error("Failed to create PNG info struct");
+    }
+  }
+
+  ~PngReadStruct() { png_destroy_read_struct(&png_, &info_, nullptr); }
+
+  PngReadStruct(const PngReadStruct&) = delete;
+  PngReadStruct& operator=(const PngReadStruct&) = delete;
+
+  png_structp png() const { return png_; }
+  png_infop info() const { return info_; }
+
+ private:
+  png_structp png_;
+  png_infop info_ = nullptr;
+};
+
+class PngWriteStruct {
+ public:
+  PngWriteStruct()
+      : png_(png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                     nullptr)) {
+    if (!png_) {
+      throw std::runtime_error("Failed to create PNG write struct");
+    }
+    info_ = png_create_info_struct(png_);
+    if (!info_) {
+      png_destroy_write_struct(&png_, nullptr);
+      throw std::runtime_error("Failed to create PNG info struct");
+    }
+  }
+
+  ~PngWriteStruct() { png_destroy_write_struct(&png_, &info_); }
+
+  PngWriteStruct(const PngWriteStruct&) = delete;
+  PngWriteStruct& operator=(const PngWriteStruct&) = delete;
+
+  png_structp png() const { return png_; }
+  png_infop info() const { return info_; }
+
+ private:
+  png_structp png_;
+  png_infop info_ = nullptr;
+};
+
+// Applies a profile's filter and zlib settings; Balanced keeps libpng's
+// defaults so its output is unchanged
+void set_png_compression(png_structp png_ptr, PngProfile profile) {
+  if (profile == PngProfile::Balanced) {
+    return;
+  }
+  const PngCompression compression = png_compression(profile);
+  png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, compression.filters);
+  png_set_compression_level(png_ptr, compression.level);
+  png_set_compression_strategy(png_ptr, compression.strategy);
+  png_set_compression_mem_level(png_ptr, compression.mem_level);
+}
+
+// PPM, PFM and RAW have no alpha, and PAM is only read and written as RGB
+void check_mapped_channels(int channels, const std::string& filepath) {
+  if (channels != kTargetChannels) {
+    throw std::invalid_argument(std::format(
+        "Mapped formats store RGB only, use PNG to keep alpha: {}", filepath));
+  }
+}
+
+// PNG color type of interleaved RGB or RGBA samples
+int png_color_type(int channels) {
+  return channels == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB;
+}
+
+// Scaling denominator for a reduced-resolution JPEG decode, see LoadOptions
+int choose_scale_denom(int width, int height, const LoadOptions& options) {
+  if (options.scale_denom != 1 && options.scale_denom != 2 &&
+      options.scale_denom != 4 && options.scale_denom != 8) {
+    throw std::invalid_argument(std::format(
+        "Unsupported scale 1/{}, expected 1, 2, 4 or 8", options.scale_denom));
+  }
+
+  for (const int denom : {1, 2, 4, 8}) {
+    if (denom < options.scale_denom) continue;
+    const int longer_side = (std::max(width, height) + denom - 1) / denom;
+    if (options.max_dim <= 0 || longer_side <= options.max_dim) {
+      return denom;
+    }
+  }
+  return 8;
+}
+
+// Clips LoadOptions::crop to a width x height image
+CropRegion clip_crop(const CropRegion& crop, int width, int height,
+                     const std::string& filepath) {
+  const auto clip = [](int64_t value, int size) {
+    return static_cast<int>(std::clamp<int64_t>(value, 0, size));
+  };
+  const int left = clip(crop.x, width);
+  const int top = clip(crop.y, height);
+  const int right = clip(int64_t{crop.x} + crop.width, width);
+  const int bottom = clip(int64_t{crop.y} + crop.height, height);
+  if (right <= left || bottom <= top) {
+    throw std::runtime_error(std::format(
+        "Crop region {},{},{},{} lies outside the {}x{} image {}", crop.x,
+        crop.y, crop.width, crop.height, width, height, filepath));
+  }
+  std::cout << std::format("Decoding {}x{} region at {},{} of {}x{} image\n",
+                           right - left, bottom - top, left, top, width,
+                           height);
+  return CropRegion{left, top, right - left, bottom - top};
+}
+
 }  // anonymous namespace
 
 ImageFormat detect_format(const std::string& filepath) {
@@ -75,44 +235,99 @@ ImageFormat detect_format(const std::string& filepath) {
   } else if (ext == ".jpg" || ext == ".jpeg" || ext == ".JPG" ||
              ext == ".JPEG") {
     return ImageFormat::JPEG;
+  } else if (ext == ".ppm" || ext == ".PPM") {
+    return ImageFormat::PPM;
+  } else if (ext == ".pam" || ext == ".PAM") {
+    return ImageFormat::PAM;
+  } else if (ext == ".pfm" || ext == ".PFM") {
+    return ImageFormat::PFM;
+  } else if (ext == ".raw" || ext == ".RAW") {
+    return ImageFormat::RAW;
   }
 
   return ImageFormat::UNKNOWN;
 }
 
-ImageData<uint8_t> load_png_8bit(const std::string& filepath) {
-  FileHandle file(filepath, "rb");
+ImageFormat sniff_format(std::span<const uint8_t> header) {
+  const auto starts_with = [&](std::string_view magic) {
+    return header.size() >= magic.size() &&
+           std::equal(magic.begin(), magic.end(), header.begin(),
+                      [](char m, uint8_t h) {
+                        return static_cast<uint8_t>(m) == h;
+                      });
+  };
 
-  // Check PNG signature
-  png_byte header[8];
-  if (std::fread(header, 1, 8, file.get()) != 8 || png_sig_cmp(header, 0, 8)) {
-    throw std::runtime_error(std::format("Invalid PNG file: {}", filepath));
+  if (starts_with("\x89PNG\r\n\x1a\n")) {
+    return ImageFormat::PNG;
+  } else if (starts_with("\xff\xd8\xff")) {
+    return ImageFormat::JPEG;
+  } else if (starts_with("P6")) {
+    return ImageFormat::PPM;
+  } else if (starts_with("P7")) {
+    return ImageFormat::PAM;
+  } else if (starts_with("PF") || starts_with("Pf")) {
+    return ImageFormat::PFM;
+  } else if (starts_with(std::string_view("PSMRAW\0\1", 8))) {
+    return ImageFormat::RAW;
   }
 
-  png_structp png_ptr =
-      png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-  if (!png_ptr) {
-    throw std::runtime_error("Failed to create PNG read struct");
+  return ImageFormat::UNKNOWN;
+}
+
+bool is_stdio_path(const std::string& filepath) { return filepath == "-"; }
+
+namespace {
+// PNG input that counts the bytes libpng reads from it
+struct CountedPngInput {
+  FILE* file = nullptr;
+  uint64_t bytes = 0;
+};
+
+void read_counted_png(png_structp png_ptr, png_bytep data, size_t length) {
+  auto* input = static_cast<CountedPngInput*>(png_get_io_ptr(png_ptr));
+  if (std::fread(data, 1, length, input->file) != length) {
+    png_error(png_ptr, "Read Error");
   }
+  input->bytes += length;
+}
 
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if (!info_ptr) {
-    png_destroy_read_struct(&png_ptr, nullptr, nullptr);
-    throw std::runtime_error("Failed to create PNG info struct");
+// Checks the signature of an open PNG, reads its header and sets up the
+// normalization shared by every PNG decode path: palette and gray expanded
+// to RGB, alpha (including tRNS) either kept as a fourth channel or
+// stripped, and 16-bit samples either kept in host byte order or reduced to
+// 8 bits. A @p signature already read from a stream is checked instead of
+// reading one. With @p counted, every byte read, signature included, is
+// counted there.
+ImageInfo start_png_read(const PngReadStruct& png, FILE* file,
+                         const std::string& filepath, bool keep_16bit,
+                         bool keep_alpha,
+                         std::span<const uint8_t> signature = {},
+                         CountedPngInput* counted = nullptr) {
+  png_byte header[8];
+  if (signature.size() == 8) {
+    std::copy(signature.begin(), signature.end(), header);
+  } else if (std::fread(header, 1, 8, file) != 8) {
+    throw std::runtime_error(std::format("Invalid PNG file: {}", filepath));
+  }
+  if (png_sig_cmp(header, 0, 8)) {
+    throw std::runtime_error(std::format("Invalid PNG file: {}", filepath));
   }
 
+  png_structp png_ptr = png.png();
+  png_infop info_ptr = png.info();
   if (setjmp(png_jmpbuf(png_ptr))) {
-    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
     throw std::runtime_error("Error reading PNG file");
   }
 
-  png_init_io(png_ptr, file.get());
+  if (counted) {
+    *counted = {file, 8};
+    png_set_read_fn(png_ptr, counted, read_counted_png);
+  } else {
+    png_init_io(png_ptr, file);
+  }
   png_set_sig_bytes(png_ptr, 8);
-
   png_read_info(png_ptr, info_ptr);
 
-  const int width = png_get_image_width(png_ptr, info_ptr);
-  const int height = png_get_image_height(png_ptr, info_ptr);
   const int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
   const int color_type = png_get_color_type(png_ptr, info_ptr);
 
@@ -122,123 +337,128 @@ ImageData<uint8_t> load_png_8bit(const std::string& filepath) {
   if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
     png_set_expand_gray_1_2_4_to_8(png_ptr);
   }
-  if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+  const bool has_trns = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) != 0;
+  if (has_trns) {
     png_set_tRNS_to_alpha(png_ptr);
   }
   if (color_type == PNG_COLOR_TYPE_GRAY ||
       color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
     png_set_gray_to_rgb(png_ptr);
   }
-  if (color_type == PNG_COLOR_TYPE_RGB_ALPHA ||
-      color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+  const bool has_alpha = has_trns || (color_type & PNG_COLOR_MASK_ALPHA) != 0;
+  if (has_alpha && !keep_alpha) {
     png_set_strip_alpha(png_ptr);
   }
   if (bit_depth == 16) {
-    png_set_strip_16(png_ptr);
+    if (keep_16bit) {
+      // Handle byte order (PNG is big-endian, we want native)
+      png_set_swap(png_ptr);
+    } else {
+      png_set_strip_16(png_ptr);
+    }
   }
 
   png_read_update_info(png_ptr, info_ptr);
 
-  std::vector<uint8_t> image_data(height * width * kTargetChannels);
-  std::vector<png_bytep> row_pointers(height);
+  ImageInfo info;
+  info.width = static_cast<int>(png_get_image_width(png_ptr, info_ptr));
+  info.height = static_cast<int>(png_get_image_height(png_ptr, info_ptr));
+  info.bit_depth = bit_depth == 16 && keep_16bit ? 16 : 8;
+  info.channels = has_alpha && keep_alpha ? 4 : kTargetChannels;
+  info.format = ImageFormat::PNG;
+  return info;
+}
 
-  for (int y = 0; y < height; ++y) {
-    row_pointers[y] = image_data.data() + y * width * kTargetChannels;
+void read_png_rows(const PngReadStruct& png, png_bytepp rows) {
+  png_structp png_ptr = png.png();
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    throw std::runtime_error("Error reading PNG file");
   }
 
-  png_read_image(png_ptr, row_pointers.data());
+  png_read_image(png_ptr, rows);
   png_read_end(png_ptr, nullptr);
-
-  png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
-
-  return ImageData<uint8_t>(std::move(image_data), width, height,
-                            kTargetChannels);
 }
 
-ImageData<uint16_t> load_png_16bit(const std::string& filepath) {
-  FileHandle file(filepath, "rb");
-
-  png_byte header[8];
-  if (std::fread(header, 1, 8, file.get()) != 8 || png_sig_cmp(header, 0, 8)) {
-    throw std::runtime_error(std::format("Invalid PNG file: {}", filepath));
-  }
-
-  png_structp png_ptr =
-      png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-  if (!png_ptr) {
-    throw std::runtime_error("Failed to create PNG read struct");
+void read_png_row(const PngReadStruct& png, png_bytep row) {
+  png_structp png_ptr = png.png();
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    throw std::runtime_error("Error reading PNG file");
   }
 
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if (!info_ptr) {
-    png_destroy_read_struct(&png_ptr, nullptr, nullptr);
-    throw std::runtime_error("Failed to create PNG info struct");
-  }
+  png_read_row(png_ptr, row, nullptr);
+}
 
+void finish_png_read(const PngReadStruct& png) {
+  png_structp png_ptr = png.png();
   if (setjmp(png_jmpbuf(png_ptr))) {
-    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
     throw std::runtime_error("Error reading PNG file");
   }
 
-  png_init_io(png_ptr, file.get());
-  png_set_sig_bytes(png_ptr, 8);
+  png_read_end(png_ptr, nullptr);
+}
 
-  png_read_info(png_ptr, info_ptr);
+// Decodes the image of a PNG set up by start_png_read, reusing the capacity
+// of @p row_pointers
+template <typename DataType>
+ImageData<DataType> read_png_image(const PngReadStruct& png,
+                                   const ImageInfo& info,
+                                   std::vector<png_bytep>& row_pointers) {
+  const size_t row_size = info.row_samples();
+  std::vector<DataType> image_data(info.sample_count());
+
+  row_pointers.resize(info.height);
+  for (int y = 0; y < info.height; ++y) {
+    row_pointers[y] = reinterpret_cast<png_bytep>(image_data.data() +
+                                                  y * row_size);
+  }
+  read_png_rows(png, row_pointers.data());
 
-  const int width = png_get_image_width(png_ptr, info_ptr);
-  const int height = png_get_image_height(png_ptr, info_ptr);
-  const int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
-  const int color_type = png_get_color_type(png_ptr, info_ptr);
+  return ImageData<DataType>(std::move(image_data), info.width, info.height,
+                             info.channels);
+}
 
-  if (color_type == PNG_COLOR_TYPE_PALETTE) {
-    png_set_palette_to_rgb(png_ptr);
-  }
-  if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
-    png_set_expand_gray_1_2_4_to_8(png_ptr);
-  }
-  if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
-    png_set_tRNS_to_alpha(png_ptr);
-  }
-  if (color_type == PNG_COLOR_TYPE_GRAY ||
-      color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
-    png_set_gray_to_rgb(png_ptr);
-  }
-  if (color_type == PNG_COLOR_TYPE_RGB_ALPHA ||
-      color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
-    png_set_strip_alpha(png_ptr);
-  }
-  // Only process truly 16-bit images - don't expand 8-bit
-  if (bit_depth != 16) {
-    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
-    throw std::runtime_error("Not a 16-bit PNG image");
-  }
+// Opens and decodes a PNG in a single pass, at 16 bits if it is stored at
+// 16 bits and @p keep_16bit is set, at 8 bits otherwise
+ImageVariant decode_png(const std::string& filepath, bool keep_16bit,
+                        bool keep_alpha,
+                        std::vector<png_bytep>& row_pointers) {
+  FileHandle file(filepath, "rb");
+  PngReadStruct png;
+  const ImageInfo info =
+      start_png_read(png, file.get(), filepath, keep_16bit, keep_alpha);
 
-  // Handle byte order (PNG is big-endian, we want native)
-  if (png_get_bit_depth(png_ptr, info_ptr) == 16) {
-    png_set_swap(png_ptr);
+  if (info.bit_depth == 16) {
+    return read_png_image<uint16_t>(png, info, row_pointers);
   }
+  return read_png_image<uint8_t>(png, info, row_pointers);
+}
+}  // anonymous namespace
 
-  png_read_update_info(png_ptr, info_ptr);
+ImageData<uint8_t> load_png_8bit(const std::string& filepath) {
+  std::vector<png_bytep> row_pointers;
+  return std::get<ImageData<uint8_t>>(
+      decode_png(filepath, false, false, row_pointers));
+}
 
-  std::vector<uint16_t> image_data(height * width * kTargetChannels);
-  std::vector<png_bytep> row_pointers(height);
+ImageData<uint16_t> load_png_16bit(const std::string& filepath) {
+  FileHandle file(filepath, "rb");
+  PngReadStruct png;
+  const ImageInfo info =
+      start_png_read(png, file.get(), filepath, true, false);
 
-  for (int y = 0; y < height; ++y) {
-    row_pointers[y] = reinterpret_cast<png_bytep>(image_data.data() +
-                                                  y * width * kTargetChannels);
+  // Only process truly 16-bit images - don't expand 8-bit
+  if (info.bit_depth != 16) {
+    throw std::runtime_error("Not a 16-bit PNG image");
   }
 
-  png_read_image(png_ptr, row_pointers.data());
-  png_read_end(png_ptr, nullptr);
-
-  png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
-
-  return ImageData<uint16_t>(std::move(image_data), width, height,
-                             kTargetChannels);
+  std::vector<png_bytep> row_pointers;
+  return read_png_image<uint16_t>(png, info, row_pointers);
 }
 
-ImageData<uint8_t> load_jpeg(const std::string& filepath) {
-  // Read file into memory
+namespace {
+// Reads a whole JPEG into @p file_data, reusing its capacity
+void read_jpeg_file(const std::string& filepath,
+                    std::vector<uint8_t>& file_data) {
   std::ifstream file(filepath, std::ios::binary | std::ios::ate);
   if (!file) {
     throw std::runtime_error(
@@ -248,27 +468,48 @@ ImageData<uint8_t> load_jpeg(const std::string& filepath) {
   const auto file_size = file.tellg();
   file.seekg(0, std::ios::beg);
 
-  std::vector<uint8_t> file_data(file_size);
+  file_data.resize(static_cast<size_t>(file_size));
   if (!file.read(reinterpret_cast<char*>(file_data.data()), file_size)) {
     throw std::runtime_error(
         std::format("Cannot read JPEG file: {}", filepath));
   }
+}
 
-  // Initialize TurboJPEG
-  TurboJpegHandle tj_handle(true);
+// Applies the LoadOptions scale to width and height in place
+void scale_jpeg_size(int& width, int& height, const LoadOptions& options) {
+  const int denom = choose_scale_denom(width, height, options);
+  if (denom > 1) {
+    const tjscalingfactor factor{1, denom};
+    std::cout << std::format("Decoding {}x{} JPEG at 1/{} scale\n", width,
+                             height, denom);
+    width = TJSCALED(width, factor);
+    height = TJSCALED(height, factor);
+  }
+}
+
+ImageData<uint8_t> decode_jpeg(tjhandle tj_handle,
+                               std::vector<uint8_t>& file_data,
+                               const std::string& filepath,
+                               const LoadOptions& options) {
+  // Read file into memory
+  read_jpeg_file(filepath, file_data);
 
   int width, height, subsamp, colorspace;
-  if (tjDecompressHeader3(tj_handle.get(), file_data.data(), file_data.size(),
+  if (tjDecompressHeader3(tj_handle, file_data.data(), file_data.size(),
                           &width, &height, &subsamp, &colorspace) != 0) {
     throw std::runtime_error(
         std::format("Cannot decode JPEG header: {}", tjGetErrorStr()));
   }
 
+  // TurboJPEG picks the DCT scaling factor matching the requested size
+  scale_jpeg_size(width, height, options);
+
   // Allocate output buffer
-  std::vector<uint8_t> image_data(width * height * kTargetChannels);
+  std::vector<uint8_t> image_data(static_cast<size_t>(width) * height *
+                                  kTargetChannels);
 
   // Decompress
-  if (tjDecompress2(tj_handle.get(), file_data.data(), file_data.size(),
+  if (tjDecompress2(tj_handle, file_data.data(), file_data.size(),
                     image_data.data(), width, 0, height, TJPF_RGB, 0) != 0) {
     throw std::runtime_error(
         std::format("Cannot decompress JPEG: {}", tjGetErrorStr()));
@@ -278,6 +519,78 @@ ImageData<uint8_t> load_jpeg(const std::string& filepath) {
                             kTargetChannels);
 }
 
+std::optional<YCbCrImage> decode_jpeg_ycbcr(tjhandle tj_handle,
+                                            std::vector<uint8_t>& file_data,
+                                            const std::string& filepath,
+                                            const LoadOptions& options) {
+  read_jpeg_file(filepath, file_data);
+
+  int width, height, subsamp, colorspace;
+  if (tjDecompressHeader3(tj_handle, file_data.data(), file_data.size(),
+                          &width, &height, &subsamp, &colorspace) != 0) {
+    throw std::runtime_error(
+        std::format("Cannot decode JPEG header: {}", tjGetErrorStr()));
+  }
+  if ((colorspace != TJCS_YCbCr && colorspace != TJCS_GRAY) ||
+      options.crop) {
+    return std::nullopt;
+  }
+
+  scale_jpeg_size(width, height, options);
+
+  YCbCrImage image;
+  image.width = width;
+  image.height = height;
+  image.y_stride = tjPlaneWidth(0, width, subsamp);
+  image.y.resize(static_cast<size_t>(image.y_stride) *
+                 tjPlaneHeight(0, height, subsamp));
+
+  unsigned char* planes[3] = {image.y.data(), nullptr, nullptr};
+  if (subsamp != TJSAMP_GRAY) {
+    image.chroma_stride = tjPlaneWidth(1, width, subsamp);
+    const int chroma_height = tjPlaneHeight(1, height, subsamp);
+    image.subsample_x = image.y_stride / image.chroma_stride;
+    image.subsample_y = tjPlaneHeight(0, height, subsamp) / chroma_height;
+
+    const size_t chroma_size =
+        static_cast<size_t>(image.chroma_stride) * chroma_height;
+    image.cb.resize(chroma_size);
+    image.cr.resize(chroma_size);
+    planes[1] = image.cb.data();
+    planes[2] = image.cr.data();
+  }
+
+  // Null strides mean tightly packed planes of tjPlaneWidth samples
+  if (tjDecompressToYUVPlanes(tj_handle, file_data.data(), file_data.size(),
+                              planes, width, nullptr, height, 0) != 0) {
+    throw std::runtime_error(
+        std::format("Cannot decompress JPEG: {}", tjGetErrorStr()));
+  }
+
+  return image;
+}
+}  // anonymous namespace
+
+ImageData<uint8_t> load_jpeg(const std::string& filepath,
+                             const LoadOptions& options) {
+  if (options.crop) {
+    // TurboJPEG decodes whole images; the region goes through libjpeg
+    LoadOptions jpeg_options = options;
+    jpeg_options.format = ImageFormat::JPEG;
+    return std::get<ImageData<uint8_t>>(load_image(filepath, jpeg_options));
+  }
+  TurboJpegHandle tj_handle(true);
+  std::vector<uint8_t> file_data;
+  return decode_jpeg(tj_handle.get(), file_data, filepath, options);
+}
+
+std::optional<YCbCrImage> load_jpeg_ycbcr(const std::string& filepath,
+                                          const LoadOptions& options) {
+  TurboJpegHandle tj_handle(true);
+  std::vector<uint8_t> file_data;
+  return decode_jpeg_ycbcr(tj_handle.get(), file_data, filepath, options);
+}
+
 // Helper function to detect PNG bit depth
 int detect_png_bit_depth(const std::string& filepath) {
   FileHandle file(filepath, "rb");
@@ -313,131 +626,266 @@ int detect_png_bit_depth(const std::string& filepath) {
   return bit_depth;
 }
 
-ImageVariant load_image(const std::string& filepath) {
-  const auto format = detect_format(filepath);
+namespace {
+// Pixel type id and pixel count reported by the load/save trace probes
+template <typename DataType>
+int trace_type_id(const ImageData<DataType>& /*image*/) {
+  return static_cast<int>(psm::detail::pixelTypeIdOf<DataType>());
+}
 
-  std::cout << std::format("Loading {} image: {}\n",
-                           format == ImageFormat::PNG ? "PNG" : "JPEG",
-                           filepath);
+template <typename DataType>
+size_t trace_pixels(const ImageData<DataType>& image) {
+  return image.pixel_count();
+}
 
-  switch (format) {
-    case ImageFormat::PNG: {
-      // Detect actual bit depth and load accordingly
-      const int bit_depth = detect_png_bit_depth(filepath);
-      std::cout << std::format("Detected PNG bit depth: {}\n", bit_depth);
+template <typename DataType>
+ImageData<DataType> load_mapped_as(const MappedImage& image) {
+  const ImageInfo& info = image.info();
+  std::vector<DataType> data(info.pixel_count() * kTargetChannels);
+  image.copy_rows<DataType>(0, data);
+  return ImageData<DataType>(std::move(data), info.width, info.height,
+                             kTargetChannels);
+}
 
-      if (bit_depth == 16) {
-        return load_png_16bit(filepath);
-      } else {
-        return load_png_8bit(filepath);
-      }
-    }
-    case ImageFormat::JPEG:
-      return load_jpeg(filepath);
-    default:
-      throw std::runtime_error(
-          std::format("Unsupported image format: {}", filepath));
+ImageVariant load_mapped(const std::string& filepath) {
+  const MappedImage image(filepath);
+  std::cout << std::format("Loading {}-bit mapped image: {}\n",
+                           image.info().bit_depth, filepath);
+  if (image.info().bit_depth == 16) {
+    return load_mapped_as<uint16_t>(image);
   }
+  return load_mapped_as<uint8_t>(image);
 }
 
-bool save_png_8bit(const ImageData<uint8_t>& image,
-                   const std::string& filepath) {
-  try {
-    std::cout << std::format("Saving 8-bit PNG: {}x{} channels={} size={}\n",
-                             image.width(), image.height(), image.channels(),
-                             image.size());
-
-    FileHandle file(filepath, "wb");
+// Decodes options.crop through an ImageRowReader, which skips what lies
+// outside the region
+ImageVariant decode_region(const std::string& filepath, ImageFormat format,
+                           const LoadOptions& options);
+}  // anonymous namespace
 
-    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
-                                                  nullptr, nullptr, nullptr);
-    if (!png_ptr) return false;
+class ImageDecoder::Impl {
+ public:
+  ImageVariant decode(const std::string& filepath, ImageFormat format,
+                      const LoadOptions& options) {
+    if (options.crop) {
+      return decode_region(filepath, format, options);
+    }
+    if (is_mapped_format(format)) {
+      if (options.reduces()) {
+        std::cout << "Reduced-resolution decode is JPEG only, loading mapped "
+                     "image at full size\n";
+      }
+      return load_mapped(filepath);
+    }
 
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr) {
-      png_destroy_write_struct(&png_ptr, nullptr);
-      return false;
+    std::cout << std::format("Loading {} image: {}\n",
+                             format == ImageFormat::PNG ? "PNG" : "JPEG",
+                             filepath);
+
+    switch (format) {
+      case ImageFormat::PNG: {
+        if (options.reduces()) {
+          std::cout << "Reduced-resolution decode is JPEG only, loading PNG "
+                       "at full size\n";
+        }
+        // The bit depth is taken from the header read in the same pass
+        auto image =
+            decode_png(filepath, true, options.keep_alpha, row_pointers_);
+        std::cout << std::format(
+            "Detected PNG bit depth: {}\n",
+            std::holds_alternative<ImageData<uint16_t>>(image) ? 16 : 8);
+        return image;
+      }
+      case ImageFormat::JPEG:
+        return decode_jpeg(decompressor(), file_data_, filepath, options);
+      default:
+        throw std::runtime_error(
+            std::format("Unsupported image format: {}", filepath));
     }
+  }
 
-    if (setjmp(png_jmpbuf(png_ptr))) {
-      png_destroy_write_struct(&png_ptr, &info_ptr);
-      return false;
+  std::optional<YCbCrImage> decode_ycbcr(const std::string& filepath,
+                                         const LoadOptions& options) {
+    return decode_jpeg_ycbcr(decompressor(), file_data_, filepath, options);
+  }
+
+ private:
+  tjhandle decompressor() {
+    if (!tj_handle_) {
+      tj_handle_.emplace(true);
     }
+    return tj_handle_->get();
+  }
 
-    png_init_io(png_ptr, file.get());
+  std::optional<TurboJpegHandle> tj_handle_;
+  std::vector<uint8_t> file_data_;
+  std::vector<png_bytep> row_pointers_;
+};
 
-    png_set_IHDR(png_ptr, info_ptr, image.width(), image.height(), 8,
-                 PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+ImageDecoder::ImageDecoder() : impl_(std::make_unique<Impl>()) {}
 
-    png_write_info(png_ptr, info_ptr);
+ImageDecoder::~ImageDecoder() = default;
 
-    // Write image data row by row to ensure correct stride
-    const int row_stride = image.width() * kTargetChannels;
-    const uint8_t* src_data = image.data();
+ImageDecoder::ImageDecoder(ImageDecoder&&) noexcept = default;
 
-    for (int y = 0; y < image.height(); ++y) {
-      png_write_row(png_ptr, const_cast<png_bytep>(src_data + y * row_stride));
-    }
-    png_write_end(png_ptr, nullptr);
+ImageDecoder& ImageDecoder::operator=(ImageDecoder&&) noexcept = default;
 
-    png_destroy_write_struct(&png_ptr, &info_ptr);
+ImageVariant ImageDecoder::decode(const std::string& filepath,
+                                  const LoadOptions& options) {
+  const auto format = options.format != ImageFormat::UNKNOWN
+                          ? options.format
+                          : detect_format(filepath);
+  PSM_TRACE(load_image_entry, filepath.c_str(), static_cast<int>(format));
 
-    std::cout << std::format("Saved 8-bit PNG: {}\n", filepath);
-    return true;
+  auto image = impl_->decode(filepath, format, options);
 
-  } catch (const std::exception& e) {
-    std::cerr << std::format("Failed to save PNG: {}\n", e.what());
-    return false;
-  }
+  PSM_TRACE(load_image_return, filepath.c_str(),
+            std::visit([](const auto& img) { return trace_type_id(img); },
+                       image),
+            std::visit([](const auto& img) { return trace_pixels(img); },
+                       image));
+  return image;
 }
 
-bool save_png_16bit(const ImageData<uint16_t>& image,
-                    const std::string& filepath) {
-  try {
-    std::cout << std::format("Saving 16-bit PNG: {}x{} channels={} size={}\n",
-                             image.width(), image.height(), image.channels(),
-                             image.size());
-
-    FileHandle file(filepath, "wb");
+std::optional<YCbCrImage> ImageDecoder::decode_ycbcr(
+    const std::string& filepath, const LoadOptions& options) {
+  return impl_->decode_ycbcr(filepath, options);
+}
 
-    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
-                                                  nullptr, nullptr, nullptr);
-    if (!png_ptr) return false;
+ImageVariant load_image(const std::string& filepath,
+                        const LoadOptions& options) {
+  ImageDecoder decoder;
+  return decoder.decode(filepath, options);
+}
 
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr) {
-      png_destroy_write_struct(&png_ptr, nullptr);
-      return false;
+namespace {
+// TurboJPEG output buffer, kept across images and grown to tjBufSize so
+// tjCompress2 can write into it without reallocating
+class JpegOutputBuffer {
+ public:
+  JpegOutputBuffer() = default;
+  ~JpegOutputBuffer() { tjFree(data_); }
+
+  JpegOutputBuffer(const JpegOutputBuffer&) = delete;
+  JpegOutputBuffer& operator=(const JpegOutputBuffer&) = delete;
+
+  unsigned char* reserve(unsigned long size) {
+    if (size > capacity_) {
+      tjFree(data_);
+      capacity_ = 0;
+      data_ = tjAlloc(static_cast<int>(size));
+      if (!data_) {
+        throw std::runtime_error("Failed to allocate JPEG buffer");
+      }
+      capacity_ = size;
     }
+    return data_;
+  }
 
-    if (setjmp(png_jmpbuf(png_ptr))) {
-      png_destroy_write_struct(&png_ptr, &info_ptr);
-      return false;
-    }
+ private:
+  unsigned char* data_ = nullptr;
+  unsigned long capacity_ = 0;
+};
 
-    png_init_io(png_ptr, file.get());
+void write_png_rows(const PngWriteStruct& png, FILE* file, int width,
+                    int height, int bit_depth, int channels,
+                    const uint8_t* data, PngProfile profile) {
+  png_structp png_ptr = png.png();
+  png_infop info_ptr = png.info();
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    throw std::runtime_error("Error writing PNG file");
+  }
 
-    png_set_IHDR(png_ptr, info_ptr, image.width(), image.height(), 16,
-                 PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_init_io(png_ptr, file);
+  set_png_compression(png_ptr, profile);
 
-    png_write_info(png_ptr, info_ptr);
+  png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth,
+               png_color_type(channels), PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+  png_write_info(png_ptr, info_ptr);
 
+  if (bit_depth == 16) {
     // For 16-bit PNG on little-endian systems, we need to swap bytes
     png_set_swap(png_ptr);
+  }
 
-    // Write image data row by row
-    const int row_stride = image.width() * kTargetChannels;
-    const uint16_t* src_data = image.data();
+  // Write image data row by row to ensure correct stride
+  const size_t row_bytes =
+      static_cast<size_t>(width) * channels * (bit_depth / 8);
+  for (int y = 0; y < height; ++y) {
+    png_write_row(png_ptr, data + y * row_bytes);
+  }
+  png_write_end(png_ptr, nullptr);
+}
 
-    for (int y = 0; y < image.height(); ++y) {
-      png_write_row(png_ptr, reinterpret_cast<png_const_bytep>(src_data +
-                                                               y * row_stride));
-    }
-    png_write_end(png_ptr, nullptr);
+template <typename DataType>
+void write_png(const ImageData<DataType>& image, const std::string& filepath,
+               const PngEncodeOptions& options) {
+  if (options.threads != 1) {
+    write_png_parallel(image, filepath, options);
+    return;
+  }
+
+  FileHandle file(filepath, "wb");
+  PngWriteStruct png;
+  write_png_rows(png, file.get(), image.width(), image.height(),
+                 static_cast<int>(sizeof(DataType) * 8), image.channels(),
+                 reinterpret_cast<const uint8_t*>(image.data()),
+                 options.profile);
+}
+
+void write_jpeg(tjhandle tj_handle, JpegOutputBuffer& buffer,
+                const ImageData<uint8_t>& image, const std::string& filepath,
+                int quality) {
+  unsigned long jpeg_size =
+      tjBufSize(image.width(), image.height(), TJSAMP_444);
+  unsigned char* jpeg_buf = buffer.reserve(jpeg_size);
+
+  // JPEG has no alpha; RGBX makes TurboJPEG skip the fourth sample
+  const int pixel_format = image.channels() == 4 ? TJPF_RGBX : TJPF_RGB;
+  if (tjCompress2(tj_handle, image.data(), image.width(), 0, image.height(),
+                  pixel_format, &jpeg_buf, &jpeg_size, TJSAMP_444, quality,
+                  TJFLAG_NOREALLOC) != 0) {
+    throw std::runtime_error(
+        std::format("JPEG compression failed: {}", tjGetErrorStr()));
+  }
+
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.write(reinterpret_cast<const char*>(jpeg_buf), jpeg_size)) {
+    throw std::runtime_error("Failed to write JPEG file");
+  }
+}
+}  // anonymous namespace
+
+bool save_png_8bit(const ImageData<uint8_t>& image,
+                   const std::string& filepath,
+                   const PngEncodeOptions& options) {
+  try {
+    std::cout << std::format("Saving 8-bit PNG: {}x{} channels={} size={}\n",
+                             image.width(), image.height(), image.channels(),
+                             image.size());
+
+    write_png(image, filepath, options);
 
-    png_destroy_write_struct(&png_ptr, &info_ptr);
+    std::cout << std::format("Saved 8-bit PNG: {}\n", filepath);
+    return true;
+
+  } catch (const std::exception& e) {
+    std::cerr << std::format("Failed to save PNG: {}\n", e.what());
+    return false;
+  }
+}
+
+bool save_png_16bit(const ImageData<uint16_t>& image,
+                    const std::string& filepath,
+                    const PngEncodeOptions& options) {
+  try {
+    std::cout << std::format("Saving 16-bit PNG: {}x{} channels={} size={}\n",
+                             image.width(), image.height(), image.channels(),
+                             image.size());
+
+    write_png(image, filepath, options);
 
     std::cout << std::format("Saved 16-bit PNG: {}\n", filepath);
     return true;
@@ -452,92 +900,1050 @@ bool save_jpeg(const ImageData<uint8_t>& image, const std::string& filepath,
                int quality) {
   try {
     TurboJpegHandle tj_handle(false);
+    JpegOutputBuffer buffer;
+    write_jpeg(tj_handle.get(), buffer, image, filepath, quality);
 
-    unsigned char* jpeg_buf = nullptr;
-    unsigned long jpeg_size = 0;
+    std::cout << std::format("Saved JPEG: {}\n", filepath);
+    return true;
 
-    if (tjCompress2(tj_handle.get(), image.data(), image.width(), 0,
-                    image.height(), TJPF_RGB, &jpeg_buf, &jpeg_size, TJSAMP_444,
-                    quality, 0) != 0) {
-      throw std::runtime_error(
-          std::format("JPEG compression failed: {}", tjGetErrorStr()));
+  } catch (const std::exception& e) {
+    std::cerr << std::format("Failed to save JPEG: {}\n", e.what());
+    return false;
+  }
+}
+
+class ImageEncoder::Impl {
+ public:
+  Impl(const PngEncodeOptions& png_options, int jpeg_quality)
+      : png_options_(png_options), jpeg_quality_(jpeg_quality) {}
+
+  template <typename DataType>
+  bool save(const ImageData<DataType>& image_data,
+            const std::string& output_path, ImageFormat format) {
+    auto path = std::filesystem::path(output_path);
+    // An explicit format keeps the path as given, extension or not
+    const bool by_extension = format == ImageFormat::UNKNOWN;
+    if (by_extension) {
+      format = detect_format(output_path);
     }
+    const bool jpeg = format == ImageFormat::JPEG ||
+                      (by_extension && path.extension().empty());
 
-    std::ofstream file(filepath, std::ios::binary);
-    if (!file.write(reinterpret_cast<const char*>(jpeg_buf), jpeg_size)) {
-      tjFree(jpeg_buf);
-      throw std::runtime_error("Failed to write JPEG file");
+    if (is_mapped_format(format)) {
+      return save_mapped(image_data, output_path, format);
     }
 
-    tjFree(jpeg_buf);
+    if constexpr (std::is_same_v<DataType, uint8_t>) {
+      if (jpeg) {
+        if (by_extension && path.extension().empty()) {
+          path.replace_extension(".jpg");
+        }
+        return save_jpeg(image_data, path.string());
+      } else {
+        if (by_extension && path.extension().empty()) {
+          path.replace_extension(".png");
+        }
+        return save_png_8bit(image_data, path.string(), png_options_);
+      }
+    } else {
+      // 16-bit images: handle format conversion
+      if (jpeg) {
+        if (by_extension && path.extension().empty()) {
+          path.replace_extension(".jpg");
+        }
+        // Convert 16-bit to 8-bit for JPEG output
+        std::cout << std::format(
+            "--️WARNING: JPEG format does not support 16-bit images.\n");
+        std::cout << std::format(
+            "Converting 16-bit to 8-bit for JPEG output: {}\n",
+            path.string());
+        std::cout << std::format(
+            "--Use PNG format to preserve full 16-bit precision.\n");
+
+        std::vector<uint8_t> converted_data(image_data.size());
+        const uint16_t* src = image_data.data();
+
+        // Convert 16-bit to 8-bit by dividing by 257 (65535/255 ≈ 257)
+        for (size_t i = 0; i < image_data.size(); ++i) {
+          converted_data[i] = static_cast<uint8_t>(src[i] / 257);
+        }
+
+        ImageData<uint8_t> converted_image(
+            std::move(converted_data), image_data.width(),
+            image_data.height(), image_data.channels());
+
+        return save_jpeg(converted_image, path.string());
+      } else {
+        // Save as 16-bit PNG
+        if (by_extension && path.extension().empty()) {
+          path.replace_extension(".png");
+        }
+        return save_png_16bit(image_data, path.string(), png_options_);
+      }
+    }
+  }
 
-    std::cout << std::format("Saved JPEG: {}\n", filepath);
-    return true;
+ private:
+  template <typename DataType>
+  static bool save_mapped(const ImageData<DataType>& image_data,
+                          const std::string& output_path,
+                          ImageFormat format) {
+    try {
+      check_mapped_channels(image_data.channels(), output_path);
+      MappedImageWriter writer(output_path, image_data.width(),
+                               image_data.height(),
+                               static_cast<int>(sizeof(DataType) * 8),
+                               format);
+      writer.write_rows<DataType>(
+          0, std::span<const DataType>{image_data.data(), image_data.size()});
+      writer.finish();
+
+      std::cout << std::format("Saved mapped image: {}\n", output_path);
+      return true;
+
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to save mapped image: {}\n", e.what());
+      return false;
+    }
+  }
 
-  } catch (const std::exception& e) {
-    std::cerr << std::format("Failed to save JPEG: {}\n", e.what());
-    return false;
+  bool save_jpeg(const ImageData<uint8_t>& image,
+                 const std::string& filepath) {
+    try {
+      if (!tj_handle_) {
+        tj_handle_.emplace(false);
+      }
+      write_jpeg(tj_handle_->get(), jpeg_buffer_, image, filepath,
+                 jpeg_quality_);
+
+      std::cout << std::format("Saved JPEG: {}\n", filepath);
+      return true;
+
+    } catch (const std::exception& e) {
+      std::cerr << std::format("Failed to save JPEG: {}\n", e.what());
+      return false;
+    }
   }
+
+  PngEncodeOptions png_options_;
+  int jpeg_quality_;
+  std::optional<TurboJpegHandle> tj_handle_;
+  JpegOutputBuffer jpeg_buffer_;
+};
+
+ImageEncoder::ImageEncoder(const PngEncodeOptions& png_options,
+                           int jpeg_quality)
+    : impl_(std::make_unique<Impl>(png_options, jpeg_quality)) {}
+
+ImageEncoder::~ImageEncoder() = default;
+
+ImageEncoder::ImageEncoder(ImageEncoder&&) noexcept = default;
+
+ImageEncoder& ImageEncoder::operator=(ImageEncoder&&) noexcept = default;
+
+template <typename DataType>
+bool ImageEncoder::encode(const ImageData<DataType>& image_data,
+                          const std::string& output_path,
+                          ImageFormat format) {
+  PSM_TRACE(save_image_entry, output_path.c_str(), trace_type_id(image_data),
+            trace_pixels(image_data));
+
+  const bool saved = impl_->save(image_data, output_path, format);
+
+  PSM_TRACE(save_image_return, output_path.c_str(), trace_type_id(image_data),
+            trace_pixels(image_data));
+  return saved;
 }
 
 template <typename DataType>
 bool save_image(const ImageData<DataType>& image_data,
-                const std::string& output_path) {
-  auto path = std::filesystem::path(output_path);
-  const auto format = detect_format(output_path);
-
-  if constexpr (std::is_same_v<DataType, uint8_t>) {
-    if (format == ImageFormat::JPEG || path.extension().empty()) {
-      if (path.extension().empty()) {
-        path.replace_extension(".jpg");
+                const std::string& output_path,
+                const PngEncodeOptions& png_options) {
+  ImageEncoder encoder(png_options);
+  return encoder.encode(image_data, output_path);
+}
+
+// Explicit template instantiations
+template bool ImageEncoder::encode<uint8_t>(const ImageData<uint8_t>&,
+                                            const std::string&, ImageFormat);
+template bool ImageEncoder::encode<uint16_t>(const ImageData<uint16_t>&,
+                                             const std::string&, ImageFormat);
+template bool save_image<uint8_t>(const ImageData<uint8_t>&,
+                                  const std::string&,
+                                  const PngEncodeOptions&);
+template bool save_image<uint16_t>(const ImageData<uint16_t>&,
+                                   const std::string&,
+                                   const PngEncodeOptions&);
+
+// Row streaming
+
+class ImageRowReader::Impl {
+ public:
+  virtual ~Impl() = default;
+
+  /// Decodes the next row, returns false past the last one
+  virtual bool read_row(unsigned char* row) = 0;
+
+  /// Encoded bytes read so far, 0 where not counted
+  virtual uint64_t bytes_read() const { return 0; }
+
+  ImageInfo info;
+};
+
+class ImageRowWriter::Impl {
+ public:
+  virtual ~Impl() = default;
+
+  virtual void write_row(const uint8_t* row) = 0;
+  virtual void write_row(const uint16_t* row) = 0;
+  virtual void finish() = 0;
+};
+
+namespace {
+// libjpeg error manager that jumps back instead of calling exit()
+struct JpegErrorManager {
+  jpeg_error_mgr pub;
+  std::jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+
+  static void error_exit(j_common_ptr cinfo) {
+    auto* self = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, self->message);
+    std::longjmp(self->jump, 1);
+  }
+
+  // Keep corrupt-data warnings off stderr
+  static void output_message(j_common_ptr /*cinfo*/) {}
+
+  jpeg_error_mgr* install() {
+    jpeg_error_mgr* err = jpeg_std_error(&pub);
+    pub.error_exit = error_exit;
+    pub.output_message = output_message;
+    message[0] = '\0';
+    return err;
+  }
+};
+
+class JpegDecompressStruct {
+ public:
+  JpegDecompressStruct() {
+    cinfo_.err = error_.install();
+    if (setjmp(error_.jump)) {
+      throw std::runtime_error(
+          std::format("Failed to initialize JPEG decoder: {}", error_.message));
+    }
+    jpeg_create_decompress(&cinfo_);
+  }
+
+  ~JpegDecompressStruct() { jpeg_destroy_decompress(&cinfo_); }
+
+  JpegDecompressStruct(const JpegDecompressStruct&) = delete;
+  JpegDecompressStruct& operator=(const JpegDecompressStruct&) = delete;
+
+  j_decompress_ptr get() { return &cinfo_; }
+  JpegErrorManager& error() { return error_; }
+
+ private:
+  jpeg_decompress_struct cinfo_{};
+  JpegErrorManager error_{};
+};
+
+class JpegCompressStruct {
+ public:
+  JpegCompressStruct() {
+    cinfo_.err = error_.install();
+    if (setjmp(error_.jump)) {
+      throw std::runtime_error(
+          std::format("Failed to initialize JPEG encoder: {}", error_.message));
+    }
+    jpeg_create_compress(&cinfo_);
+  }
+
+  ~JpegCompressStruct() { jpeg_destroy_compress(&cinfo_); }
+
+  JpegCompressStruct(const JpegCompressStruct&) = delete;
+  JpegCompressStruct& operator=(const JpegCompressStruct&) = delete;
+
+  j_compress_ptr get() { return &cinfo_; }
+  JpegErrorManager& error() { return error_; }
+
+ private:
+  jpeg_compress_struct cinfo_{};
+  JpegErrorManager error_{};
+};
+
+// Bytes of one pixel of the rows described by @p info
+size_t pixel_bytes(const ImageInfo& info) {
+  return static_cast<size_t>(info.channels) * (info.bit_depth / 8);
+}
+
+// Copies the columns of @p region out of a decoded row whose first pixel is
+// column @p first_column of the image
+void copy_region_columns(const unsigned char* decoded_row, unsigned char* row,
+                         const CropRegion& region, int first_column,
+                         size_t pixel_bytes) {
+  std::copy_n(decoded_row + (region.x - first_column) * pixel_bytes,
+              region.width * pixel_bytes, row);
+}
+
+// Bytes of each spilled block of pass rows
+constexpr size_t kSpillBlockSize = size_t{4} << 20;
+
+// An interlaced PNG spilled to a scratch file. libpng without interlace
+// handling returns each Adam7 pass as a reduced image of its own; the passes
+// are stored in blocks of rows, and image rows are assembled from them in
+// order. Each pass is read front to back, so memory holds one block of each.
+class InterlacedPngSpill {
+ public:
+  InterlacedPngSpill(const PngReadStruct& png, const ImageInfo& info,
+                     const LoadOptions& options)
+      : scratch_(options.scratch_dir, options.compress_scratch),
+        pixel_bytes_(pixel_bytes(info)) {
+    std::vector<unsigned char> row(static_cast<size_t>(info.width) *
+                                   pixel_bytes_);
+    std::vector<unsigned char> block;
+    for (int index = 0; index < 7; ++index) {
+      Pass pass;
+      pass.first_row = PNG_PASS_START_ROW(index);
+      pass.first_column = PNG_PASS_START_COL(index);
+      pass.row_shift = PNG_PASS_ROW_SHIFT(index);
+      pass.column_shift = PNG_PASS_COL_SHIFT(index);
+      pass.width = PNG_PASS_COLS(static_cast<png_uint_32>(info.width), index);
+      const int rows =
+          PNG_PASS_ROWS(static_cast<png_uint_32>(info.height), index);
+      // libpng skips empty passes
+      if (pass.width == 0 || rows == 0) {
+        continue;
       }
-      return save_jpeg(image_data, path.string(), kDefaultJpegQuality);
+      pass.row_bytes = static_cast<size_t>(pass.width) * pixel_bytes_;
+      pass.rows_per_block = static_cast<int>(
+          std::max<size_t>(1, kSpillBlockSize / pass.row_bytes));
+
+      for (int first = 0; first < rows; first += pass.rows_per_block) {
+        const int count = std::min(pass.rows_per_block, rows - first);
+        block.resize(count * pass.row_bytes);
+        for (int r = 0; r < count; ++r) {
+          // Decoded into a full-width row, the buffer size libpng expects
+          read_png_row(png, row.data());
+          std::copy_n(row.data(), pass.row_bytes,
+                      block.data() + r * pass.row_bytes);
+        }
+        pass.blocks.push_back(scratch_.append(block));
+      }
+      passes_.push_back(std::move(pass));
+    }
+    finish_png_read(png);
+  }
+
+  // Assembles image row @p y; rows must be read in order
+  void read_row(int y, unsigned char* row) {
+    for (Pass& pass : passes_) {
+      if (y < pass.first_row ||
+          ((y - pass.first_row) & ((1 << pass.row_shift) - 1)) != 0) {
+        continue;
+      }
+      const int pass_row = pass.next_row++;
+      const int block = pass_row / pass.rows_per_block;
+      if (block != pass.loaded_block) {
+        const ScratchFile::Extent& extent = pass.blocks[block];
+        pass.block.resize(extent.size);
+        scratch_.read(extent, pass.block);
+        pass.loaded_block = block;
+      }
+      const unsigned char* source =
+          pass.block.data() +
+          (pass_row % pass.rows_per_block) * pass.row_bytes;
+      for (int x = 0; x < pass.width; ++x) {
+        const size_t column =
+            pass.first_column + (static_cast<size_t>(x) << pass.column_shift);
+        std::copy_n(source + x * pixel_bytes_, pixel_bytes_,
+                    row + column * pixel_bytes_);
+      }
+    }
+  }
+
+ private:
+  struct Pass {
+    int first_row = 0;
+    int first_column = 0;
+    int row_shift = 0;  // Rows of the pass are 1 << row_shift apart
+    int column_shift = 0;
+    int width = 0;
+    size_t row_bytes = 0;
+    int rows_per_block = 1;
+    std::vector<ScratchFile::Extent> blocks;
+    std::vector<unsigned char> block;  // Inflated block loaded_block
+    int loaded_block = -1;
+    int next_row = 0;  // Next pass row an image row takes
+  };
+
+  ScratchFile scratch_;
+  size_t pixel_bytes_;
+  std::vector<Pass> passes_;
+};
+
+class PngRowReader final : public ImageRowReader::Impl {
+ public:
+  PngRowReader(const std::string& filepath, const LoadOptions& options,
+               std::span<const uint8_t> signature = {})
+      : file_(filepath, "rb") {
+    info = start_png_read(png_, file_.get(), filepath, true,
+                          options.keep_alpha, signature, &input_);
+    const bool interlaced = png_get_interlace_type(png_.png(), png_.info()) !=
+                            PNG_INTERLACE_NONE;
+    if (interlaced && !options.scratch_dir.empty()) {
+      spill_.emplace(png_, info, options);
+    } else if (interlaced && !options.crop) {
+      throw std::runtime_error(std::format(
+          "Interlaced PNG cannot be streamed row by row without a scratch "
+          "directory: {}",
+          filepath));
+    }
+    if (!options.crop) {
+      return;
+    }
+
+    region_ = clip_crop(*options.crop, info.width, info.height, filepath);
+    decoded_row_bytes_ = info.width * pixel_bytes(info);
+    pixel_bytes_ = pixel_bytes(info);
+    if (interlaced && !spill_) {
+      // Every pass revisits every row, so the image is decoded whole
+      decoded_.resize(decoded_row_bytes_ * info.height);
+      std::vector<png_bytep> rows(info.height);
+      for (int y = 0; y < info.height; ++y) {
+        rows[y] = decoded_.data() + y * decoded_row_bytes_;
+      }
+      read_png_rows(png_, rows.data());
+      whole_image_ = true;
     } else {
-      if (path.extension().empty()) {
-        path.replace_extension(".png");
+      decoded_.resize(decoded_row_bytes_);
+    }
+    info.width = region_->width;
+    info.height = region_->height;
+  }
+
+  bool read_row(unsigned char* row) override {
+    if (next_row_ >= info.height) {
+      return false;
+    }
+
+    png_structp png_ptr = png_.png();
+    if (setjmp(png_jmpbuf(png_ptr))) {
+      throw std::runtime_error("Error reading PNG file");
+    }
+
+    if (!region_) {
+      if (spill_) {
+        spill_->read_row(next_row_++, row);
+        return true;
+      }
+      png_read_row(png_ptr, row, nullptr);
+      if (++next_row_ == info.height) {
+        png_read_end(png_ptr, nullptr);
       }
-      return save_png_8bit(image_data, path.string());
+      return true;
     }
-  } else {
-    // 16-bit images: handle format conversion
-    if (format == ImageFormat::JPEG || path.extension().empty()) {
-      // Convert 16-bit to 8-bit for JPEG output
+
+    // Rows above the region are inflated into the same buffer and dropped;
+    // rows below it are never read
+    const int image_row = region_->y + next_row_++;
+    const unsigned char* decoded = decoded_.data();
+    if (whole_image_) {
+      decoded += image_row * decoded_row_bytes_;
+    } else {
+      for (; png_row_ <= image_row; ++png_row_) {
+        if (spill_) {
+          spill_->read_row(png_row_, decoded_.data());
+        } else {
+          png_read_row(png_ptr, decoded_.data(), nullptr);
+        }
+      }
+    }
+    copy_region_columns(decoded, row, *region_, 0, pixel_bytes_);
+    return true;
+  }
+
+  uint64_t bytes_read() const override { return input_.bytes; }
+
+ private:
+  FileHandle file_;
+  PngReadStruct png_;
+  CountedPngInput input_;
+  int next_row_ = 0;
+  std::optional<CropRegion> region_;
+  std::vector<unsigned char> decoded_;  // Image row(s) before cropping
+  size_t decoded_row_bytes_ = 0;
+  size_t pixel_bytes_ = 0;
+  bool whole_image_ = false;  // decoded_ holds every row
+  int png_row_ = 0;           // Next row png_read_row returns
+  std::optional<InterlacedPngSpill> spill_;  // Interlaced PNG in scratch_dir
+};
+
+// libjpeg source reading a stream that had its first bytes consumed to
+// sniff the format: replays those bytes, then continues with the stream
+class JpegStreamSource {
+ public:
+  JpegStreamSource(FILE* file, std::span<const uint8_t> prefix)
+      : file_(file) {
+    source_.init_source = [](j_decompress_ptr) {};
+    source_.fill_input_buffer = fill_input_buffer;
+    source_.skip_input_data = skip_input_data;
+    source_.resync_to_restart = jpeg_resync_to_restart;
+    source_.term_source = [](j_decompress_ptr) {};
+    std::copy(prefix.begin(), prefix.end(), buffer_.begin());
+    source_.next_input_byte = buffer_.data();
+    source_.bytes_in_buffer = prefix.size();
+    bytes_read_ = prefix.size();
+  }
+
+  JpegStreamSource(const JpegStreamSource&) = delete;
+  JpegStreamSource& operator=(const JpegStreamSource&) = delete;
+
+  void attach(j_decompress_ptr cinfo) { cinfo->src = &source_; }
+
+  /// Bytes taken from the stream so far, the replayed prefix included
+  uint64_t bytes_read() const { return bytes_read_; }
+
+ private:
+  static boolean fill_input_buffer(j_decompress_ptr cinfo) {
+    // source_ is the first member, so the manager is the JpegStreamSource
+    auto* self = reinterpret_cast<JpegStreamSource*>(cinfo->src);
+    size_t bytes =
+        std::fread(self->buffer_.data(), 1, self->buffer_.size(), self->file_);
+    self->bytes_read_ += bytes;
+    if (bytes == 0) {
+      // Truncated input: end the image, as jpeg_stdio_src does
+      WARNMS(cinfo, JWRN_JPEG_EOF);
+      self->buffer_[0] = 0xFF;
+      self->buffer_[1] = JPEG_EOI;
+      bytes = 2;
+    }
+    self->source_.next_input_byte = self->buffer_.data();
+    self->source_.bytes_in_buffer = bytes;
+    return TRUE;
+  }
+
+  static void skip_input_data(j_decompress_ptr cinfo, long count) {
+    jpeg_source_mgr* source = cinfo->src;
+    while (count > static_cast<long>(source->bytes_in_buffer)) {
+      count -= static_cast<long>(source->bytes_in_buffer);
+      fill_input_buffer(cinfo);
+    }
+    if (count > 0) {
+      source->next_input_byte += count;
+      source->bytes_in_buffer -= static_cast<size_t>(count);
+    }
+  }
+
+  jpeg_source_mgr source_{};
+  FILE* file_;
+  uint64_t bytes_read_ = 0;
+  std::array<JOCTET, 4096> buffer_{};
+};
+
+class JpegRowReader final : public ImageRowReader::Impl {
+ public:
+  JpegRowReader(const std::string& filepath, const LoadOptions& options,
+                std::span<const uint8_t> prefix = {})
+      : file_(filepath, "rb"), source_(file_.get(), prefix) {
+    j_decompress_ptr cinfo = jpeg_.get();
+    if (setjmp(jpeg_.error().jump)) {
+      throw std::runtime_error(std::format("Cannot decode JPEG {}: {}",
+                                           filepath, jpeg_.error().message));
+    }
+
+    source_.attach(cinfo);
+    jpeg_read_header(cinfo, TRUE);
+    cinfo->out_color_space = JCS_RGB;
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = static_cast<unsigned int>(
+        choose_scale_denom(static_cast<int>(cinfo->image_width),
+                           static_cast<int>(cinfo->image_height), options));
+    jpeg_start_decompress(cinfo);
+
+    info.width = static_cast<int>(cinfo->output_width);
+    info.height = static_cast<int>(cinfo->output_height);
+    info.bit_depth = 8;
+    info.format = ImageFormat::JPEG;
+
+    if (options.crop) {
+      region_ = clip_crop(*options.crop, info.width, info.height, filepath);
+      // libjpeg widens the columns to whole iMCUs and decodes only those;
+      // skipped rows are entropy decoded but not transformed
+      JDIMENSION first_column = static_cast<JDIMENSION>(region_->x);
+      JDIMENSION width = static_cast<JDIMENSION>(region_->width);
+      jpeg_crop_scanline(cinfo, &first_column, &width);
+      jpeg_skip_scanlines(cinfo, static_cast<JDIMENSION>(region_->y));
+      first_column_ = static_cast<int>(first_column);
+      decoded_.resize(static_cast<size_t>(width) * kTargetChannels);
+      info.width = region_->width;
+      info.height = region_->height;
+    }
+  }
+
+  bool read_row(unsigned char* row) override {
+    j_decompress_ptr cinfo = jpeg_.get();
+    if (next_row_ >= info.height) {
+      return false;
+    }
+
+    if (setjmp(jpeg_.error().jump)) {
+      throw std::runtime_error(
+          std::format("Cannot decompress JPEG: {}", jpeg_.error().message));
+    }
+
+    JSAMPROW rows[] = {region_ ? decoded_.data() : row};
+    jpeg_read_scanlines(cinfo, rows, 1);
+    if (region_) {
+      copy_region_columns(decoded_.data(), row, *region_, first_column_,
+                          kTargetChannels);
+    }
+    ++next_row_;
+    // Rows below a region are never decoded
+    if (cinfo->output_scanline == cinfo->output_height) {
+      jpeg_finish_decompress(cinfo);
+    }
+    return true;
+  }
+
+  uint64_t bytes_read() const override { return source_.bytes_read(); }
+
+ private:
+  FileHandle file_;
+  JpegStreamSource source_;
+  JpegDecompressStruct jpeg_;
+  int next_row_ = 0;
+  std::optional<CropRegion> region_;
+  std::vector<unsigned char> decoded_;  // Cropped scanline, iMCU aligned
+  int first_column_ = 0;                // Image column of decoded_[0]
+};
+
+class PngRowWriter final : public ImageRowWriter::Impl {
+ public:
+  PngRowWriter(const std::string& filepath, int width, int height,
+               int bit_depth, int channels, PngProfile profile)
+      : file_(filepath, "wb") {
+    png_structp png_ptr = png_.png();
+    png_infop info_ptr = png_.info();
+    if (setjmp(png_jmpbuf(png_ptr))) {
+      throw std::runtime_error("Error writing PNG file");
+    }
+
+    png_init_io(png_ptr, file_.get());
+    set_png_compression(png_ptr, profile);
+    png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth,
+                 png_color_type(channels), PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png_ptr, info_ptr);
+
+    if (bit_depth == 16) {
+      png_set_swap(png_ptr);
+    }
+  }
+
+  void write_row(const uint8_t* row) override {
+    png_structp png_ptr = png_.png();
+    if (setjmp(png_jmpbuf(png_ptr))) {
+      throw std::runtime_error("Error writing PNG file");
+    }
+    png_write_row(png_ptr, row);
+  }
+
+  void write_row(const uint16_t* row) override {
+    write_row(reinterpret_cast<const uint8_t*>(row));
+  }
+
+  void finish() override {
+    png_structp png_ptr = png_.png();
+    if (setjmp(png_jmpbuf(png_ptr))) {
+      throw std::runtime_error("Error writing PNG file");
+    }
+    png_write_end(png_ptr, nullptr);
+  }
+
+ private:
+  FileHandle file_;
+  PngWriteStruct png_;
+};
+
+class JpegRowWriter final : public ImageRowWriter::Impl {
+ public:
+  JpegRowWriter(const std::string& filepath, int width, int height,
+                int channels, int quality)
+      : file_(filepath, "wb"),
+        narrowed_row_(static_cast<size_t>(width) * channels) {
+    j_compress_ptr cinfo = jpeg_.get();
+    if (setjmp(jpeg_.error().jump)) {
+      throw std::runtime_error(
+          std::format("JPEG compression failed: {}", jpeg_.error().message));
+    }
+
+    jpeg_stdio_dest(cinfo, file_.get());
+    cinfo->image_width = static_cast<JDIMENSION>(width);
+    cinfo->image_height = static_cast<JDIMENSION>(height);
+    // JPEG has no alpha; RGBX makes libjpeg-turbo skip the fourth sample
+    cinfo->input_components = channels;
+    cinfo->in_color_space = channels == 4 ? JCS_EXT_RGBX : JCS_RGB;
+    jpeg_set_defaults(cinfo);
+    jpeg_set_quality(cinfo, quality, TRUE);
+
+    // 4:4:4, matching save_jpeg
+    for (int c = 0; c < cinfo->num_components; ++c) {
+      cinfo->comp_info[c].h_samp_factor = 1;
+      cinfo->comp_info[c].v_samp_factor = 1;
+    }
+
+    jpeg_start_compress(cinfo, TRUE);
+  }
+
+  void write_row(const uint8_t* row) override {
+    j_compress_ptr cinfo = jpeg_.get();
+    if (setjmp(jpeg_.error().jump)) {
+      throw std::runtime_error(
+          std::format("JPEG compression failed: {}", jpeg_.error().message));
+    }
+
+    JSAMPROW rows[] = {const_cast<JSAMPLE*>(row)};
+    jpeg_write_scanlines(cinfo, rows, 1);
+  }
+
+  void write_row(const uint16_t* row) override {
+    // Same 16-to-8-bit reduction as save_image
+    for (size_t i = 0; i < narrowed_row_.size(); ++i) {
+      narrowed_row_[i] = static_cast<uint8_t>(row[i] / 257);
+    }
+    write_row(narrowed_row_.data());
+  }
+
+  void finish() override {
+    j_compress_ptr cinfo = jpeg_.get();
+    if (setjmp(jpeg_.error().jump)) {
+      throw std::runtime_error(
+          std::format("JPEG compression failed: {}", jpeg_.error().message));
+    }
+    jpeg_finish_compress(cinfo);
+  }
+
+ private:
+  FileHandle file_;
+  JpegCompressStruct jpeg_;
+  std::vector<uint8_t> narrowed_row_;
+};
+
+// Copies rows out of a mapping; the OS reads the file ahead
+class MappedRowReader final : public ImageRowReader::Impl {
+ public:
+  MappedRowReader(const std::string& filepath, const LoadOptions& options)
+      : image_(filepath) {
+    info = image_.info();
+    if (options.crop) {
+      // Only the region's rows are read, so only their pages are faulted in
+      region_ = clip_crop(*options.crop, info.width, info.height, filepath);
+      decoded_.resize(static_cast<size_t>(info.width) * pixel_bytes(info));
+      info.width = region_->width;
+      info.height = region_->height;
+    }
+  }
+
+  bool read_row(unsigned char* row) override {
+    if (next_row_ >= info.height) {
+      return false;
+    }
+    const int image_row = region_ ? region_->y + next_row_ : next_row_;
+    unsigned char* target = region_ ? decoded_.data() : row;
+    const size_t samples = static_cast<size_t>(image_.info().width) *
+                           kTargetChannels;
+    if (info.bit_depth == 16) {
+      image_.copy_rows(image_row,
+                       std::span{reinterpret_cast<uint16_t*>(target), samples});
+    } else {
+      image_.copy_rows(image_row, std::span{target, samples});
+    }
+    if (region_) {
+      copy_region_columns(decoded_.data(), row, *region_, 0,
+                          pixel_bytes(info));
+    }
+    ++next_row_;
+    return true;
+  }
+
+ private:
+  MappedImage image_;
+  int next_row_ = 0;
+  std::optional<CropRegion> region_;
+  std::vector<unsigned char> decoded_;  // Whole image row before cropping
+};
+
+class MappedRowWriter final : public ImageRowWriter::Impl {
+ public:
+  MappedRowWriter(const std::string& filepath, int width, int height,
+                  int bit_depth, ImageFormat format)
+      : writer_(filepath, width, height, bit_depth, format),
+        row_size_(static_cast<size_t>(width) * kTargetChannels) {}
+
+  void write_row(const uint8_t* row) override {
+    writer_.write_rows(next_row_++, std::span{row, row_size_});
+  }
+
+  void write_row(const uint16_t* row) override {
+    writer_.write_rows(next_row_++, std::span{row, row_size_});
+  }
+
+  void finish() override { writer_.finish(); }
+
+ private:
+  MappedImageWriter writer_;
+  size_t row_size_;
+  int next_row_ = 0;
+};
+
+ImageInfo read_png_info(const std::string& filepath) {
+  FileHandle file(filepath, "rb");
+  png_byte header[8];
+  if (std::fread(header, 1, 8, file.get()) != 8 || png_sig_cmp(header, 0, 8)) {
+    throw std::runtime_error(std::format("Invalid PNG file: {}", filepath));
+  }
+
+  PngReadStruct png;
+  if (setjmp(png_jmpbuf(png.png()))) {
+    throw std::runtime_error("Error reading PNG header");
+  }
+  png_init_io(png.png(), file.get());
+  png_set_sig_bytes(png.png(), 8);
+  png_read_info(png.png(), png.info());
+
+  ImageInfo info;
+  info.width = static_cast<int>(png_get_image_width(png.png(), png.info()));
+  info.height = static_cast<int>(png_get_image_height(png.png(), png.info()));
+  info.bit_depth = png_get_bit_depth(png.png(), png.info()) == 16 ? 16 : 8;
+  info.format = ImageFormat::PNG;
+  return info;
+}
+
+ImageInfo read_jpeg_info(const std::string& filepath) {
+  FileHandle file(filepath, "rb");
+  JpegDecompressStruct jpeg;
+  if (setjmp(jpeg.error().jump)) {
+    throw std::runtime_error(std::format("Cannot decode JPEG header {}: {}",
+                                         filepath, jpeg.error().message));
+  }
+  jpeg_stdio_src(jpeg.get(), file.get());
+  jpeg_read_header(jpeg.get(), TRUE);
+
+  ImageInfo info;
+  info.width = static_cast<int>(jpeg.get()->image_width);
+  info.height = static_cast<int>(jpeg.get()->image_height);
+  info.bit_depth = 8;
+  info.format = ImageFormat::JPEG;
+  return info;
+}
+
+template <typename DataType>
+void check_row_size(std::span<DataType> row, int width, int channels) {
+  if (row.size() < static_cast<size_t>(width) * channels) {
+    throw std::invalid_argument(
+        std::format("Row buffer holds {} samples, {} required", row.size(),
+                    static_cast<size_t>(width) * channels));
+  }
+}
+}  // anonymous namespace
+
+ImageInfo read_image_info(const std::string& filepath) {
+  const ImageFormat format = detect_format(filepath);
+  if (is_mapped_format(format)) {
+    return MappedImage(filepath).info();
+  }
+
+  switch (format) {
+    case ImageFormat::PNG:
+      return read_png_info(filepath);
+    case ImageFormat::JPEG:
+      return read_jpeg_info(filepath);
+    default:
+      throw std::runtime_error(
+          std::format("Unsupported image format: {}", filepath));
+  }
+}
+
+ImageRowReader::ImageRowReader(const std::string& filepath,
+                               const LoadOptions& options) {
+  if (is_stdio_path(filepath)) {
+    // The sniffed bytes cannot be pushed back into a pipe, so the decoders
+    // are handed them
+    std::array<uint8_t, kSniffBytes> header{};
+    const size_t size = std::fread(header.data(), 1, header.size(), stdin);
+    const std::span<const uint8_t> prefix(header.data(), size);
+    const ImageFormat format = options.format != ImageFormat::UNKNOWN
+                                   ? options.format
+                                   : sniff_format(prefix);
+    switch (format) {
+      case ImageFormat::PNG:
+        impl_ = std::make_unique<PngRowReader>(filepath, options, prefix);
+        return;
+      case ImageFormat::JPEG:
+        impl_ = std::make_unique<JpegRowReader>(filepath, options, prefix);
+        return;
+      case ImageFormat::UNKNOWN:
+        throw std::runtime_error("Unrecognized image format on stdin");
+      default:
+        throw std::runtime_error(
+            "PPM, PAM, PFM and RAW are memory-mapped and cannot be read from "
+            "stdin");
+    }
+  }
+
+  const ImageFormat format = options.format != ImageFormat::UNKNOWN
+                                 ? options.format
+                                 : detect_format(filepath);
+  switch (format) {
+    case ImageFormat::PNG:
+      impl_ = std::make_unique<PngRowReader>(filepath, options);
+      break;
+    case ImageFormat::PPM:
+    case ImageFormat::PAM:
+    case ImageFormat::PFM:
+    case ImageFormat::RAW:
+      impl_ = std::make_unique<MappedRowReader>(filepath, options);
+      break;
+    case ImageFormat::JPEG:
+      impl_ = std::make_unique<JpegRowReader>(filepath, options);
+      break;
+    default:
+      throw std::runtime_error(
+          std::format("Unsupported image format: {}", filepath));
+  }
+}
+
+ImageRowReader::~ImageRowReader() = default;
+
+const ImageInfo& ImageRowReader::info() const { return impl_->info; }
+
+uint64_t ImageRowReader::bytes_read() const { return impl_->bytes_read(); }
+
+bool ImageRowReader::read_row(std::span<uint8_t> row) {
+  if (impl_->info.bit_depth != 8) {
+    throw std::invalid_argument("Image rows are 16-bit");
+  }
+  check_row_size(row, impl_->info.width, impl_->info.channels);
+  return impl_->read_row(row.data());
+}
+
+bool ImageRowReader::read_row(std::span<uint16_t> row) {
+  if (impl_->info.bit_depth != 16) {
+    throw std::invalid_argument("Image rows are 8-bit");
+  }
+  check_row_size(row, impl_->info.width, impl_->info.channels);
+  return impl_->read_row(reinterpret_cast<unsigned char*>(row.data()));
+}
+
+namespace {
+template <typename DataType>
+ImageData<DataType> read_region(ImageRowReader& reader) {
+  const ImageInfo& info = reader.info();
+  const size_t row_size = info.row_samples();
+  std::vector<DataType> data(info.sample_count());
+  for (int y = 0; y < info.height; ++y) {
+    reader.read_row(std::span(data).subspan(y * row_size, row_size));
+  }
+  return ImageData<DataType>(std::move(data), info.width, info.height,
+                             info.channels);
+}
+
+ImageVariant decode_region(const std::string& filepath, ImageFormat format,
+                           const LoadOptions& options) {
+  LoadOptions region_options = options;
+  region_options.format = format;
+  std::cout << std::format("Loading region of image: {}\n", filepath);
+  ImageRowReader reader(filepath, region_options);
+  if (reader.info().bit_depth == 16) {
+    return read_region<uint16_t>(reader);
+  }
+  return read_region<uint8_t>(reader);
+}
+}  // anonymous namespace
+
+ImageRowWriter::ImageRowWriter(const std::string& filepath, int width,
+                               int height, int bit_depth, int channels,
+                               const PngEncodeOptions& png_options,
+                               ImageFormat format)
+    : width_(width),
+      height_(height),
+      bit_depth_(bit_depth),
+      channels_(channels) {
+  if (bit_depth != 8 && bit_depth != 16) {
+    throw std::invalid_argument(
+        std::format("Unsupported bit depth: {}", bit_depth));
+  }
+  if (channels != 3 && channels != 4) {
+    throw std::invalid_argument(
+        std::format("Unsupported channel count: {}", channels));
+  }
+
+  if (is_stdio_path(filepath) &&
+      format != ImageFormat::PNG && format != ImageFormat::JPEG) {
+    throw std::invalid_argument("Only PNG and JPEG can be written to stdout");
+  }
+  auto path = std::filesystem::path(filepath);
+  const bool by_extension = format == ImageFormat::UNKNOWN;
+  if (by_extension) {
+    format = detect_format(filepath);
+  }
+  const bool jpeg = format == ImageFormat::JPEG ||
+                    (by_extension && path.extension().empty());
+  if (jpeg && by_extension && path.extension().empty()) {
+    path.replace_extension(".jpg");
+  }
+  path_ = path.string();
+
+  if (is_mapped_format(format)) {
+    check_mapped_channels(channels, path_);
+    impl_ = std::make_unique<MappedRowWriter>(path_, width, height, bit_depth,
+                                              format);
+  } else if (jpeg) {
+    if (bit_depth == 16) {
       std::cout << std::format(
           "--️WARNING: JPEG format does not support 16-bit images.\n");
       std::cout << std::format(
-          "Converting 16-bit to 8-bit for JPEG output: {}\n",
-          path.extension().empty() ? path.replace_extension(".jpg").string()
-                                   : path.string());
+          "Converting 16-bit to 8-bit for JPEG output: {}\n", path_);
       std::cout << std::format(
           "--Use PNG format to preserve full 16-bit precision.\n");
+    }
+    impl_ = std::make_unique<JpegRowWriter>(path_, width, height, channels,
+                                            kDefaultJpegQuality);
+  } else {
+    impl_ = std::make_unique<PngRowWriter>(path_, width, height, bit_depth,
+                                           channels, png_options.profile);
+  }
+}
 
-      std::vector<uint8_t> converted_data(image_data.size());
-      const uint16_t* src = image_data.data();
+ImageRowWriter::~ImageRowWriter() = default;
 
-      // Convert 16-bit to 8-bit by dividing by 257 (65535/255 ≈ 257)
-      for (size_t i = 0; i < image_data.size(); ++i) {
-        converted_data[i] = static_cast<uint8_t>(src[i] / 257);
-      }
+const std::string& ImageRowWriter::path() const { return path_; }
 
-      ImageData<uint8_t> converted_image(
-          std::move(converted_data), image_data.width(), image_data.height(),
-          image_data.channels());
+void ImageRowWriter::write_row(std::span<const uint8_t> row) {
+  if (bit_depth_ != 8) {
+    throw std::invalid_argument("Writer expects 16-bit rows");
+  }
+  check_row_size(row, width_, channels_);
+  impl_->write_row(row.data());
+  ++rows_written_;
+}
 
-      return save_jpeg(converted_image, path.string(), kDefaultJpegQuality);
-    } else {
-      // Save as 16-bit PNG
-      if (path.extension().empty()) {
-        path.replace_extension(".png");
-      }
-      return save_png_16bit(image_data, path.string());
-    }
+void ImageRowWriter::write_row(std::span<const uint16_t> row) {
+  if (bit_depth_ != 16) {
+    throw std::invalid_argument("Writer expects 8-bit rows");
   }
+  check_row_size(row, width_, channels_);
+  impl_->write_row(row.data());
+  ++rows_written_;
 }
 
-// Explicit template instantiations
-template bool save_image<uint8_t>(const ImageData<uint8_t>&,
-                                  const std::string&);
-template bool save_image<uint16_t>(const ImageData<uint16_t>&,
-                                   const std::string&);
+void ImageRowWriter::finish() {
+  if (rows_written_ != height_) {
+    throw std::runtime_error(std::format("Wrote {} of {} rows to {}",
+                                         rows_written_, height_, path_));
+  }
+  impl_->finish();
+}
 
 }  // namespace psm_cli
@@ -2,14 +2,18 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "mapped_file.hpp"
+
 namespace psm_cli {
 
-enum class ImageFormat { PNG, JPEG, UNKNOWN };
+enum class ImageFormat { PNG, JPEG, PPM, PAM, PFM, RAW, UNKNOWN };
 
 template <typename T>
 class ImageData {
@@ -32,6 +36,16 @@ class ImageData {
   int height() const { return height_; }
   int channels() const { return channels_; }
 
+  // Sizes derived from the int geometry, which limits each side to 2^31 - 1
+  // pixels; computed in size_t so that no product overflows int
+  size_t pixel_count() const {
+    return static_cast<size_t>(width_) * static_cast<size_t>(height_);
+  }
+  size_t row_samples() const {
+    return static_cast<size_t>(width_) * static_cast<size_t>(channels_);
+  }
+  size_t sample_count() const { return pixel_count() * channels_; }
+
   explicit operator bool() const { return !data_.empty(); }
   size_t size() const { return data_.size(); }
 
@@ -44,25 +58,453 @@ class ImageData {
 
 using ImageVariant = std::variant<ImageData<uint8_t>, ImageData<uint16_t>>;
 
+/// Rectangle of an image in pixels, see LoadOptions::crop
+struct CropRegion {
+  int x = 0;  ///< Left column
+  int y = 0;  ///< Top row
+  int width = 0;
+  int height = 0;
+};
+
+/**
+ * @brief Decode options for load_image and ImageRowReader
+ *
+ * JPEGs are decoded at a reduced size in the DCT domain: the decoder picks the
+ * largest of 1, 1/2, 1/4 and 1/8 that is no larger than 1/scale_denom and
+ * whose longer side fits max_dim, or 1/8 if none fits. This is several times
+ * faster than a full decode and allocates proportionally less. PNGs are
+ * always decoded at full resolution.
+ *
+ * With keep_alpha, PNGs that have an alpha channel or a tRNS chunk decode to
+ * 4-channel RGBA instead of having alpha stripped. Other images stay RGB.
+ *
+ * With crop, only that region is produced, given in pixels of the image as
+ * decoded (after JPEG scaling) and clipped to it. JPEGs are decoded with
+ * libjpeg-turbo's partial decode: rows above the region are skipped without
+ * their inverse DCT and color conversion, columns are cut at the nearest
+ * iMCU boundary, and decoding stops after the region's last row. PNG rows
+ * above the region are inflated but never stored, and mapped images only
+ * read the region's rows. Interlaced PNGs are decoded whole and then cut,
+ * unless they are spilled to scratch_dir.
+ *
+ * ImageRowReader cannot decode an interlaced PNG in row order, because every
+ * Adam7 pass spans the whole image. With a scratch_dir, each pass is decoded
+ * into a scratch file there (deflated with compress_scratch) and rows are
+ * assembled from the passes as they are read, so memory holds one block of
+ * each pass. Without one, interlaced PNGs are only read with crop.
+ *
+ * A format other than UNKNOWN overrides the extension, for paths without
+ * one such as /dev/fd/N. ImageRowReader sniffs standard input when it is
+ * UNKNOWN.
+ */
+struct LoadOptions {
+  int max_dim = 0;      ///< Target for the longer output side, 0 = no limit
+  int scale_denom = 1;  ///< Upper bound on the scale, 1/scale_denom: 1, 2, 4, 8
+  /// Decode PNG alpha as a fourth channel
+  bool keep_alpha = false;
+  /// Input format, UNKNOWN = by extension (sniffed for standard input)
+  ImageFormat format = ImageFormat::UNKNOWN;
+  /// Region to decode, std::nullopt = the whole image
+  std::optional<CropRegion> crop;
+  /// Directory where ImageRowReader spills interlaced PNGs, empty = nowhere
+  std::string scratch_dir;
+  /// Deflate spilled data, trading CPU time for scratch space
+  bool compress_scratch = false;
+
+  bool reduces() const { return max_dim > 0 || scale_denom > 1; }
+};
+
+/// Trade-off between PNG encode speed and file size
+enum class PngProfile {
+  Fastest,   ///< Sub filter, zlib level 1, run-length matching
+  Balanced,  ///< libpng defaults: adaptive filters, zlib level 6
+  Smallest   ///< Adaptive filters, zlib level 9, largest zlib state
+};
+
+/**
+ * @brief PNG encode options for save_image and ImageRowWriter
+ *
+ * With threads != 1, save_image filters and deflates independent bands of
+ * the image concurrently and joins the deflate streams into one zlib stream,
+ * as pigz does. Band boundaries do not depend on the thread count, so the
+ * output is identical for any threads > 1. ImageRowWriter always encodes on
+ * the calling thread.
+ */
+struct PngEncodeOptions {
+  PngProfile profile = PngProfile::Balanced;
+  int threads = 1;  ///< 1 = libpng on the calling thread, 0 = all cores
+};
+
 ImageFormat detect_format(const std::string& filepath);
 
+/// Bytes sniff_format looks at
+inline constexpr size_t kSniffBytes = 8;
+
+/**
+ * @brief Identifies an image from its magic bytes, for input without a file
+ * extension
+ *
+ * @param header The first kSniffBytes bytes of the image (fewer if it is
+ * shorter)
+ * @return UNKNOWN if no supported signature matches
+ */
+ImageFormat sniff_format(std::span<const uint8_t> header);
+
+/// The path "-", which ImageRowReader and ImageRowWriter take as standard
+/// input and standard output
+bool is_stdio_path(const std::string& filepath);
+
+/// True for the uncompressed formats handled through memory mappings
+bool is_mapped_format(ImageFormat format);
+
 int detect_png_bit_depth(const std::string& filepath);
 
-ImageVariant load_image(const std::string& filepath);
+ImageVariant load_image(const std::string& filepath,
+                        const LoadOptions& options = {});
 
 template <typename DataType>
 bool save_image(const ImageData<DataType>& image_data,
-                const std::string& output_path);
+                const std::string& output_path,
+                const PngEncodeOptions& png_options = {});
 
 ImageData<uint8_t> load_png_8bit(const std::string& filepath);
 ImageData<uint16_t> load_png_16bit(const std::string& filepath);
-ImageData<uint8_t> load_jpeg(const std::string& filepath);
+ImageData<uint8_t> load_jpeg(const std::string& filepath,
+                             const LoadOptions& options = {});
+
+/**
+ * @brief Planar YCbCr samples of a JPEG, decoded without color conversion
+ *
+ * Planes are padded to whole MCUs; chroma is subsampled by subsample_x and
+ * subsample_y. Matches psm::YCbCrPlanes.
+ */
+struct YCbCrImage {
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> cb;  ///< Empty for grayscale JPEGs
+  std::vector<uint8_t> cr;  ///< Empty for grayscale JPEGs
+  int width = 0;
+  int height = 0;
+  int y_stride = 0;
+  int chroma_stride = 0;
+  int subsample_x = 1;
+  int subsample_y = 1;
+};
+
+/**
+ * @brief Decodes a JPEG to YCbCr planes (tjDecompressToYUVPlanes), skipping
+ * the decoder's RGB conversion
+ *
+ * @return std::nullopt if the JPEG is not YCbCr or grayscale coded (CMYK,
+ * YCCK or RGB JPEGs), or if options.crop is set; such JPEGs must go through
+ * load_jpeg instead
+ */
+std::optional<YCbCrImage> load_jpeg_ycbcr(const std::string& filepath,
+                                          const LoadOptions& options = {});
 
 bool save_png_8bit(const ImageData<uint8_t>& image,
-                   const std::string& filepath);
+                   const std::string& filepath,
+                   const PngEncodeOptions& options = {});
 bool save_png_16bit(const ImageData<uint16_t>& image,
-                    const std::string& filepath);
+                    const std::string& filepath,
+                    const PngEncodeOptions& options = {});
 bool save_jpeg(const ImageData<uint8_t>& image, const std::string& filepath,
                int quality = 95);
 
+/**
+ * @brief Loads images one after another, keeping decoder state between them
+ *
+ * Each file is opened once and read in a single pass (the PNG bit depth is
+ * taken from the header of that pass). The TurboJPEG handle, the compressed
+ * file buffer and the PNG row pointers are reused across calls, so a batch
+ * only allocates the decoded images themselves. libpng read structs cannot
+ * be reset and are still created per PNG. Not thread-safe; use one decoder
+ * per thread.
+ */
+class ImageDecoder {
+ public:
+  ImageDecoder();
+  ~ImageDecoder();
+
+  ImageDecoder(const ImageDecoder&) = delete;
+  ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+  ImageDecoder(ImageDecoder&&) noexcept;
+  ImageDecoder& operator=(ImageDecoder&&) noexcept;
+
+  /// Same as load_image
+  ImageVariant decode(const std::string& filepath,
+                      const LoadOptions& options = {});
+
+  /// Same as load_jpeg_ycbcr
+  std::optional<YCbCrImage> decode_ycbcr(const std::string& filepath,
+                                         const LoadOptions& options = {});
+
+  class Impl;  // Decoder state, defined in image_io.cpp
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Saves images one after another, keeping encoder state between them
+ *
+ * The TurboJPEG handle and its output buffer are reused across calls. Not
+ * thread-safe; use one encoder per thread.
+ */
+class ImageEncoder {
+ public:
+  explicit ImageEncoder(const PngEncodeOptions& png_options = {},
+                        int jpeg_quality = 95);
+  ~ImageEncoder();
+
+  ImageEncoder(const ImageEncoder&) = delete;
+  ImageEncoder& operator=(const ImageEncoder&) = delete;
+
+  ImageEncoder(ImageEncoder&&) noexcept;
+  ImageEncoder& operator=(ImageEncoder&&) noexcept;
+
+  /// Same as save_image; a @p format other than UNKNOWN overrides the
+  /// extension of @p output_path, which is then used as given
+  template <typename DataType>
+  bool encode(const ImageData<DataType>& image_data,
+              const std::string& output_path,
+              ImageFormat format = ImageFormat::UNKNOWN);
+
+  class Impl;  // Encoder state, defined in image_io.cpp
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Properties of an encoded image, or of the rows an ImageRowReader
+ * produces
+ */
+struct ImageInfo {
+  int width = 0;
+  int height = 0;
+  int bit_depth = 8;  ///< Bits per sample of the decoded rows, 8 or 16
+  int channels = 3;   ///< Samples per pixel of the decoded rows, 3 or 4
+  ImageFormat format = ImageFormat::UNKNOWN;
+
+  // As for ImageData, in size_t so that no product overflows int
+  size_t pixel_count() const {
+    return static_cast<size_t>(width) * static_cast<size_t>(height);
+  }
+  size_t row_samples() const {
+    return static_cast<size_t>(width) * static_cast<size_t>(channels);
+  }
+  size_t sample_count() const { return pixel_count() * channels; }
+};
+
+/**
+ * @brief Reads the dimensions and bit depth of an image from its header
+ * without decoding any pixels
+ *
+ * channels is always 3, the layout of a default load_image.
+ */
+ImageInfo read_image_info(const std::string& filepath);
+
+/**
+ * @brief Decodes an image one row at a time
+ *
+ * Rows are interleaved RGB samples with the same normalization as load_image
+ * (palette and gray expanded, alpha stripped unless options.keep_alpha makes
+ * them RGBA, see info().channels). 16-bit PNGs and mapped formats keep their
+ * depth (PFM is read as 16-bit), JPEGs are decoded to 8 bits. Only the
+ * decoder state and one row are held in memory, so memory use does not grow
+ * with the image height.
+ *
+ * The path "-" reads a PNG or JPEG from standard input, in options.format or
+ * the format sniffed from its first bytes; the mapped formats need a file.
+ * With options.crop, info() and the rows are those of the region.
+ *
+ * @throws std::runtime_error if the file cannot be decoded, or is an
+ * interlaced PNG (which cannot be decoded row by row) and options has neither
+ * a scratch_dir nor a crop
+ */
+class ImageRowReader {
+ public:
+  explicit ImageRowReader(const std::string& filepath,
+                          const LoadOptions& options = {});
+  ~ImageRowReader();
+
+  ImageRowReader(const ImageRowReader&) = delete;
+  ImageRowReader& operator=(const ImageRowReader&) = delete;
+
+  const ImageInfo& info() const;
+
+  /**
+   * @brief Encoded bytes read from a PNG or JPEG input so far, which is the
+   * only size known of a pipe; 0 for the mapped formats
+   */
+  uint64_t bytes_read() const;
+
+  /**
+   * @brief Decodes the next row into @p row, which must hold
+   * width * info().channels samples of the image's bit depth
+   *
+   * @return false once every row has been read
+   */
+  bool read_row(std::span<uint8_t> row);
+  bool read_row(std::span<uint16_t> row);
+
+  class Impl;  // Per-format decoder, defined in image_io.cpp
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Encodes an image one row at a time
+ *
+ * The format follows save_image: PPM, PAM, PFM or RAW by extension, JPEG for
+ * .jpg/.jpeg paths and for paths without an extension (".jpg" is appended),
+ * PNG otherwise. 16-bit rows are written as a 16-bit PNG, or reduced to 8
+ * bits for JPEG. PNGs use the compression settings of @p png_options'
+ * profile. 4-channel rows are written as an RGBA PNG; JPEG drops their alpha
+ * and the mapped formats reject them.
+ *
+ * A @p format other than UNKNOWN overrides the extension. The path "-"
+ * writes a PNG or JPEG to standard output and needs an explicit @p format.
+ */
+class ImageRowWriter {
+ public:
+  ImageRowWriter(const std::string& filepath, int width, int height,
+                 int bit_depth, int channels = 3,
+                 const PngEncodeOptions& png_options = {},
+                 ImageFormat format = ImageFormat::UNKNOWN);
+  ~ImageRowWriter();
+
+  ImageRowWriter(const ImageRowWriter&) = delete;
+  ImageRowWriter& operator=(const ImageRowWriter&) = delete;
+
+  /// Path actually written, including an appended extension
+  const std::string& path() const;
+
+  /// Encodes the next row of width * channels samples
+  void write_row(std::span<const uint8_t> row);
+  void write_row(std::span<const uint16_t> row);
+
+  /// Completes the file; call once after all height rows were written
+  void finish();
+
+  class Impl;  // Per-format encoder, defined in image_io.cpp
+
+ private:
+  std::unique_ptr<Impl> impl_;
+  std::string path_;
+  int width_;
+  int height_;
+  int bit_depth_;
+  int channels_;
+  int rows_written_ = 0;
+};
+
+/**
+ * @brief Uncompressed image file mapped into memory for reading
+ *
+ * Supports binary PPM (P6) and PAM (P7, TUPLTYPE RGB) with a maxval of 255 or
+ * 65535, PFM (PF, 32-bit float RGB) and RAW, a 32-byte header followed by
+ * little-endian samples:
+ *
+ *   bytes 0-7    "PSMRAW" 0 1 (magic and version)
+ *   bytes 8-23   width, height, channels (3), bits per sample (8 or 16),
+ *                each uint32 little-endian
+ *   bytes 24-31  reserved, zero
+ *
+ * 8-bit samples, and aligned 16-bit samples in host byte order (RAW on
+ * little-endian hosts), are used in place (direct()). 16-bit PPM/PAM samples
+ * are big-endian and PFM samples are floats, so those are converted while
+ * copying; PFM is read as 16-bit.
+ */
+class MappedImage {
+ public:
+  /// Stored sample representation
+  enum class Encoding {
+    Native,     ///< 8-bit, or 16-bit in host byte order
+    Swapped16,  ///< 16-bit in the opposite byte order
+    Float32     ///< PFM floats
+  };
+
+  /// @throws std::runtime_error if the file is not a supported image
+  explicit MappedImage(const std::string& filepath);
+
+  const ImageInfo& info() const { return info_; }
+
+  /// True if samples() views the file's samples in place
+  bool direct() const { return direct_; }
+
+  /**
+   * @brief The mapped samples, width * height * 3 values in row order
+   *
+   * @tparam T uint8_t or uint16_t, matching info().bit_depth
+   * @throws std::logic_error if !direct() or T does not match
+   */
+  template <typename T>
+  std::span<const T> samples() const;
+
+  /**
+   * @brief Copies rows [first_row, first_row + out.size() / (width * 3)) into
+   * @p out as host-order samples
+   *
+   * @tparam T uint8_t or uint16_t, matching info().bit_depth
+   */
+  template <typename T>
+  void copy_rows(int first_row, std::span<T> out) const;
+
+ private:
+  MappedFile file_;
+  ImageInfo info_;
+  size_t data_offset_ = 0;
+  Encoding encoding_ = Encoding::Native;
+  bool direct_ = false;
+  bool float_little_endian_ = true;  // PFM only
+};
+
+/**
+ * @brief Writes an uncompressed image (PPM, PAM, PFM or RAW, chosen by
+ * extension) through a memory mapping of the output file
+ *
+ * The format is @p format, or taken from the extension if that is UNKNOWN.
+ * The file is created at its final size. Unless the format is PFM, samples()
+ * exposes the mapped sample storage, so a conversion can write its output
+ * straight into the file; 16-bit PPM/PAM samples are swapped to big-endian in
+ * place by finish().
+ */
+class MappedImageWriter {
+ public:
+  /// @throws std::runtime_error if the format is not a mapped format
+  MappedImageWriter(const std::string& filepath, int width, int height,
+                    int bit_depth, ImageFormat format = ImageFormat::UNKNOWN);
+
+  const std::string& path() const { return path_; }
+
+  /// True if samples() can be written directly
+  bool direct() const { return encoding_ != MappedImage::Encoding::Float32; }
+
+  /**
+   * @brief Mapped sample storage for width * height * 3 host-order samples
+   *
+   * @tparam T uint8_t or uint16_t, matching the writer's bit depth
+   * @throws std::logic_error if !direct() or T does not match
+   */
+  template <typename T>
+  std::span<T> samples();
+
+  /// Writes whole rows starting at @p first_row, converting as needed
+  template <typename T>
+  void write_rows(int first_row, std::span<const T> rows);
+
+  /// Finalizes the sample byte order and unmaps the file
+  void finish();
+
+ private:
+  MappedFile file_;
+  std::string path_;
+  ImageInfo info_;
+  size_t data_offset_ = 0;
+  MappedImage::Encoding encoding_ = MappedImage::Encoding::Native;
+};
+
 }  // namespace psm_cli
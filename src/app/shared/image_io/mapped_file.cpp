@@ -0,0 +1,195 @@
+#include "mapped_file.hpp"
+
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace psm_cli {
+
+#ifdef _WIN32
+
+namespace {
+// Closes a Win32 handle on scope exit; the view outlives both handles
+class WinHandle {
+ public:
+  explicit WinHandle(HANDLE handle) : handle_(handle) {}
+  ~WinHandle() {
+    if (handle_ && handle_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(handle_);
+    }
+  }
+
+  WinHandle(const WinHandle&) = delete;
+  WinHandle& operator=(const WinHandle&) = delete;
+
+  HANDLE get() const { return handle_; }
+  bool valid() const { return handle_ && handle_ != INVALID_HANDLE_VALUE; }
+
+ private:
+  HANDLE handle_;
+};
+
+uint8_t* map_view(HANDLE file, size_t size, bool writable,
+                  const std::string& filepath) {
+  ULARGE_INTEGER mapping_size;
+  mapping_size.QuadPart = size;
+  WinHandle mapping(CreateFileMappingA(
+      file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+      mapping_size.HighPart, mapping_size.LowPart, nullptr));
+  if (!mapping.valid()) {
+    throw std::runtime_error(std::format("Cannot map file: {}", filepath));
+  }
+
+  void* view = MapViewOfFile(
+      mapping.get(), writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+  if (!view) {
+    throw std::runtime_error(std::format("Cannot map file: {}", filepath));
+  }
+  return static_cast<uint8_t*>(view);
+}
+}  // anonymous namespace
+
+MappedFile MappedFile::open_read(const std::string& filepath) {
+  WinHandle file(CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+  if (!file.valid()) {
+    throw std::runtime_error(std::format("Cannot open file: {}", filepath));
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file.get(), &file_size) || file_size.QuadPart == 0) {
+    throw std::runtime_error(
+        std::format("Cannot map empty file: {}", filepath));
+  }
+
+  const auto size = static_cast<size_t>(file_size.QuadPart);
+  return MappedFile(map_view(file.get(), size, false, filepath), size, false);
+}
+
+MappedFile MappedFile::create(const std::string& filepath, size_t size) {
+  WinHandle file(CreateFileA(filepath.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                             nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                             nullptr));
+  if (!file.valid()) {
+    throw std::runtime_error(std::format("Cannot create file: {}", filepath));
+  }
+
+  // The mapping extends the file to its size
+  return MappedFile(map_view(file.get(), size, true, filepath), size, true);
+}
+
+void MappedFile::close() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  writable_ = false;
+}
+
+#else
+
+namespace {
+// Closes a file descriptor on scope exit; the mapping outlives it
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+uint8_t* map_fd(int fd, size_t size, bool writable,
+                const std::string& filepath) {
+  const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* data = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error(std::format("Cannot map file: {}", filepath));
+  }
+  return static_cast<uint8_t*>(data);
+}
+}  // anonymous namespace
+
+MappedFile MappedFile::open_read(const std::string& filepath) {
+  FileDescriptor fd(::open(filepath.c_str(), O_RDONLY));
+  if (fd.get() < 0) {
+    throw std::runtime_error(std::format("Cannot open file: {}", filepath));
+  }
+
+  struct stat file_stat{};
+  if (fstat(fd.get(), &file_stat) != 0 || file_stat.st_size == 0) {
+    throw std::runtime_error(
+        std::format("Cannot map empty file: {}", filepath));
+  }
+
+  const auto size = static_cast<size_t>(file_stat.st_size);
+  uint8_t* data = map_fd(fd.get(), size, false, filepath);
+  madvise(data, size, MADV_SEQUENTIAL);
+  return MappedFile(data, size, false);
+}
+
+MappedFile MappedFile::create(const std::string& filepath, size_t size) {
+  FileDescriptor fd(
+      ::open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644));
+  if (fd.get() < 0) {
+    throw std::runtime_error(std::format("Cannot create file: {}", filepath));
+  }
+
+  if (ftruncate(fd.get(), static_cast<off_t>(size)) != 0) {
+    throw std::runtime_error(
+        std::format("Cannot resize file to {} bytes: {}", size, filepath));
+  }
+  return MappedFile(map_fd(fd.get(), size, true, filepath), size, true);
+}
+
+void MappedFile::close() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  writable_ = false;
+}
+
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      writable_(std::exchange(other.writable_, false)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    writable_ = std::exchange(other.writable_, false);
+  }
+  return *this;
+}
+
+}  // namespace psm_cli
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace psm_cli {
+
+/**
+ * @brief Memory mapping of a whole file
+ *
+ * Read mappings are shared and read-only. Write mappings are created at their
+ * final size, so pages are written straight to the page cache with no
+ * intermediate buffer; they are written back when the mapping is closed.
+ */
+class MappedFile {
+ public:
+  /// Maps an existing file read-only
+  static MappedFile open_read(const std::string& filepath);
+
+  /// Creates or truncates a file of @p size bytes and maps it read-write
+  static MappedFile create(const std::string& filepath, size_t size);
+
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  std::span<const uint8_t> data() const { return {data_, size_}; }
+
+  /// Mapped bytes of a mapping made by create()
+  std::span<uint8_t> writable_data() { return {data_, writable_ ? size_ : 0}; }
+
+  size_t size() const { return size_; }
+
+  /// Unmaps the file; written pages are flushed by the OS
+  void close();
+
+ private:
+  MappedFile(uint8_t* data, size_t size, bool writable)
+      : data_(data), size_(size), writable_(writable) {}
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  bool writable_ = false;
+};
+
+}  // namespace psm_cli
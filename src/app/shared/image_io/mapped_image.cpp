@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "image_io.hpp"
+
+namespace psm_cli {
+
+namespace {
+constexpr int kChannels = 3;  // RGB
+constexpr size_t kRawHeaderSize = 32;
+constexpr char kRawMagic[8] = {'P', 'S', 'M', 'R', 'A', 'W', 0, 1};
+
+// Header length that puts the samples of written files on this boundary, so
+// 16-bit samples can be viewed in place
+constexpr size_t kSampleAlignment = 16;
+
+constexpr bool kLittleEndianHost = std::endian::native == std::endian::little;
+
+uint16_t byteswap16(uint16_t value) {
+  return static_cast<uint16_t>((value >> 8) | (value << 8));
+}
+
+uint32_t read_le32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) |
+         static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 |
+         static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+void write_le32(uint8_t* bytes, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+bool is_space(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+// Tokenizer for the text headers of PPM and PFM files
+class HeaderTokens {
+ public:
+  HeaderTokens(std::span<const uint8_t> bytes, const std::string& filepath)
+      : bytes_(bytes), filepath_(filepath) {}
+
+  std::string_view next() {
+    // Whitespace and '#' comments may separate tokens
+    while (pos_ < bytes_.size()) {
+      if (is_space(bytes_[pos_])) {
+        ++pos_;
+      } else if (bytes_[pos_] == '#') {
+        while (pos_ < bytes_.size() && bytes_[pos_] != '\n') {
+          ++pos_;
+        }
+      } else {
+        break;
+      }
+    }
+
+    const size_t start = pos_;
+    while (pos_ < bytes_.size() && !is_space(bytes_[pos_])) {
+      ++pos_;
+    }
+    if (start == pos_) {
+      fail();
+    }
+    return {reinterpret_cast<const char*>(bytes_.data()) + start,
+            pos_ - start};
+  }
+
+  int next_int() { return parse_int(next()); }
+
+  // The single whitespace byte that ends the header
+  size_t data_offset() {
+    if (pos_ >= bytes_.size() || !is_space(bytes_[pos_])) {
+      fail();
+    }
+    return pos_ + 1;
+  }
+
+  int parse_int(std::string_view token) const {
+    int value = 0;
+    for (const char c : token) {
+      if (c < '0' || c > '9' ||
+          value > (std::numeric_limits<int>::max() - 9) / 10) {
+        fail();
+      }
+      value = value * 10 + (c - '0');
+    }
+    return value;
+  }
+
+  [[noreturn]] void fail() const {
+    throw std::runtime_error(
+        std::format("Malformed image header: {}", filepath_));
+  }
+
+ private:
+  std::span<const uint8_t> bytes_;
+  const std::string& filepath_;
+  size_t pos_ = 0;
+};
+
+int bit_depth_for_maxval(int maxval, const std::string& filepath) {
+  if (maxval == 255) {
+    return 8;
+  }
+  if (maxval == 65535) {
+    return 16;
+  }
+  throw std::runtime_error(std::format(
+      "Unsupported maxval {} (255 or 65535 required): {}", maxval, filepath));
+}
+
+// Parses the "P7" header: KEY value lines up to ENDHDR
+size_t parse_pam_header(std::span<const uint8_t> bytes, ImageInfo& info,
+                        const std::string& filepath) {
+  HeaderTokens tokens(bytes, filepath);
+  const std::string_view text(reinterpret_cast<const char*>(bytes.data()),
+                              bytes.size());
+  int depth = 0;
+  int maxval = 0;
+
+  size_t line_start = text.find('\n');
+  while (line_start != std::string_view::npos) {
+    ++line_start;
+    const size_t line_end = text.find('\n', line_start);
+    if (line_end == std::string_view::npos) {
+      break;
+    }
+    std::string_view line = text.substr(line_start, line_end - line_start);
+    line_start = line_end;
+
+    const size_t key_end = line.find_first_of(" \t\r");
+    const std::string_view key = line.substr(0, key_end);
+    std::string_view value =
+        key_end == std::string_view::npos ? "" : line.substr(key_end + 1);
+    value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+    value = value.substr(0, value.find_last_not_of(" \t\r") + 1);
+
+    if (key == "ENDHDR") {
+      if (info.width <= 0 || info.height <= 0 || depth != kChannels) {
+        throw std::runtime_error(std::format(
+            "PAM must be RGB (DEPTH 3) with WIDTH and HEIGHT: {}", filepath));
+      }
+      info.bit_depth = bit_depth_for_maxval(maxval, filepath);
+      return line_end + 1;
+    } else if (key == "WIDTH") {
+      info.width = tokens.parse_int(value);
+    } else if (key == "HEIGHT") {
+      info.height = tokens.parse_int(value);
+    } else if (key == "DEPTH") {
+      depth = tokens.parse_int(value);
+    } else if (key == "MAXVAL") {
+      maxval = tokens.parse_int(value);
+    } else if (key == "TUPLTYPE") {
+      if (value != "RGB") {
+        throw std::runtime_error(std::format(
+            "Unsupported PAM tuple type {}: {}", value, filepath));
+      }
+    } else if (!key.empty() && key[0] != '#') {
+      tokens.fail();
+    }
+  }
+  tokens.fail();
+}
+
+uint64_t sample_count(const ImageInfo& info) {
+  return static_cast<uint64_t>(info.width) * info.height * kChannels;
+}
+
+// Bytes per stored sample
+size_t stored_sample_size(ImageFormat format, int bit_depth) {
+  return format == ImageFormat::PFM ? sizeof(float) : bit_depth / 8;
+}
+
+template <typename T>
+void check_sample_type(const ImageInfo& info) {
+  if (sizeof(T) * 8 != static_cast<size_t>(info.bit_depth)) {
+    throw std::logic_error(std::format("Image samples are {}-bit, not {}-bit",
+                                       info.bit_depth, sizeof(T) * 8));
+  }
+}
+
+// Number of whole rows in @p samples, which must fit in the image from
+// @p first_row
+template <typename T>
+int row_count(const ImageInfo& info, int first_row, std::span<T> samples) {
+  const size_t row_size = static_cast<size_t>(info.width) * kChannels;
+  const size_t rows = samples.size() / row_size;
+  if (samples.size() % row_size != 0 || first_row < 0 ||
+      first_row + rows > static_cast<size_t>(info.height)) {
+    throw std::invalid_argument(std::format(
+        "{} samples from row {} are not whole rows of the {}x{} image",
+        samples.size(), first_row, info.width, info.height));
+  }
+  return static_cast<int>(rows);
+}
+
+void check_dimensions(int width, int height, int bit_depth) {
+  if (width <= 0 || height <= 0) {
+    throw std::invalid_argument(
+        std::format("Invalid image size {}x{}", width, height));
+  }
+  if (bit_depth != 8 && bit_depth != 16) {
+    throw std::invalid_argument(
+        std::format("Unsupported bit depth: {}", bit_depth));
+  }
+}
+
+// Comment line that pads a Netpbm header to kSampleAlignment bytes
+std::string header_padding(size_t header_size) {
+  size_t padding =
+      (kSampleAlignment - header_size % kSampleAlignment) % kSampleAlignment;
+  if (padding == 1) {
+    padding += kSampleAlignment;  // A comment line takes at least "#\n"
+  }
+  if (padding == 0) {
+    return {};
+  }
+  return "#" + std::string(padding - 2, ' ') + "\n";
+}
+}  // anonymous namespace
+
+bool is_mapped_format(ImageFormat format) {
+  return format == ImageFormat::PPM || format == ImageFormat::PAM ||
+         format == ImageFormat::PFM || format == ImageFormat::RAW;
+}
+
+MappedImage::MappedImage(const std::string& filepath)
+    : file_(MappedFile::open_read(filepath)) {
+  // The format is taken from the header, whatever the extension
+  const std::span<const uint8_t> bytes = file_.data();
+  std::string_view magic(reinterpret_cast<const char*>(bytes.data()),
+                         std::min<size_t>(bytes.size(), 2));
+
+  if (bytes.size() >= kRawHeaderSize &&
+      std::memcmp(bytes.data(), kRawMagic, sizeof(kRawMagic)) == 0) {
+    info_.format = ImageFormat::RAW;
+    const uint32_t width = read_le32(bytes.data() + 8);
+    const uint32_t height = read_le32(bytes.data() + 12);
+    const uint32_t channels = read_le32(bytes.data() + 16);
+    const uint32_t bits = read_le32(bytes.data() + 20);
+    if (width == 0 || height == 0 ||
+        width > static_cast<uint32_t>(std::numeric_limits<int>::max()) ||
+        height > static_cast<uint32_t>(std::numeric_limits<int>::max()) ||
+        channels != kChannels || (bits != 8 && bits != 16)) {
+      throw std::runtime_error(
+          std::format("Unsupported RAW image layout: {}", filepath));
+    }
+    info_.width = static_cast<int>(width);
+    info_.height = static_cast<int>(height);
+    info_.bit_depth = static_cast<int>(bits);
+    data_offset_ = kRawHeaderSize;
+    if (info_.bit_depth == 16 && !kLittleEndianHost) {
+      encoding_ = Encoding::Swapped16;
+    }
+  } else if (magic == "P6") {
+    info_.format = ImageFormat::PPM;
+    HeaderTokens tokens(bytes, filepath);
+    tokens.next();
+    info_.width = tokens.next_int();
+    info_.height = tokens.next_int();
+    info_.bit_depth = bit_depth_for_maxval(tokens.next_int(), filepath);
+    data_offset_ = tokens.data_offset();
+  } else if (magic == "P7") {
+    info_.format = ImageFormat::PAM;
+    data_offset_ = parse_pam_header(bytes, info_, filepath);
+  } else if (magic == "PF") {
+    info_.format = ImageFormat::PFM;
+    HeaderTokens tokens(bytes, filepath);
+    tokens.next();
+    info_.width = tokens.next_int();
+    info_.height = tokens.next_int();
+    const std::string scale(tokens.next());
+    data_offset_ = tokens.data_offset();
+    try {
+      float_little_endian_ = std::stof(scale) < 0.0f;
+    } catch (const std::exception&) {
+      tokens.fail();
+    }
+    info_.bit_depth = 16;
+    encoding_ = Encoding::Float32;
+  } else {
+    throw std::runtime_error(std::format(
+        "Not a binary PPM, PAM, PFM or RAW image: {}", filepath));
+  }
+
+  if (info_.width <= 0 || info_.height <= 0) {
+    throw std::runtime_error(
+        std::format("Invalid image size in {}", filepath));
+  }
+  if ((info_.format == ImageFormat::PPM || info_.format == ImageFormat::PAM) &&
+      info_.bit_depth == 16 && kLittleEndianHost) {
+    encoding_ = Encoding::Swapped16;
+  }
+
+  const uint64_t data_size =
+      sample_count(info_) * stored_sample_size(info_.format, info_.bit_depth);
+  if (data_offset_ > bytes.size() || bytes.size() - data_offset_ < data_size) {
+    throw std::runtime_error(std::format(
+        "Image data is truncated: {} bytes, {} expected: {}",
+        bytes.size() - std::min(data_offset_, bytes.size()), data_size,
+        filepath));
+  }
+
+  // Unaligned 16-bit samples are copied instead of viewed
+  const auto address =
+      reinterpret_cast<uintptr_t>(bytes.data() + data_offset_);
+  direct_ = encoding_ == Encoding::Native &&
+            address % (info_.bit_depth / 8) == 0;
+}
+
+template <typename T>
+std::span<const T> MappedImage::samples() const {
+  check_sample_type<T>(info_);
+  if (!direct_) {
+    throw std::logic_error("Image samples cannot be used in place");
+  }
+  return {reinterpret_cast<const T*>(file_.data().data() + data_offset_),
+          static_cast<size_t>(sample_count(info_))};
+}
+
+template <typename T>
+void MappedImage::copy_rows(int first_row, std::span<T> out) const {
+  check_sample_type<T>(info_);
+  const int rows = row_count(info_, first_row, out);
+  const size_t row_size = static_cast<size_t>(info_.width) * kChannels;
+  const uint8_t* data = file_.data().data() + data_offset_;
+
+  switch (encoding_) {
+    case Encoding::Native:
+      std::memcpy(out.data(), data + first_row * row_size * sizeof(T),
+                  out.size_bytes());
+      break;
+    case Encoding::Swapped16: {
+      const uint8_t* src = data + first_row * row_size * sizeof(T);
+      for (size_t i = 0; i < out.size(); ++i) {
+        uint16_t value;
+        std::memcpy(&value, src + i * sizeof(value), sizeof(value));
+        out[i] = static_cast<T>(byteswap16(value));
+      }
+      break;
+    }
+    case Encoding::Float32: {
+      // PFM rows are stored bottom to top
+      const bool swap = float_little_endian_ != kLittleEndianHost;
+      for (int row = 0; row < rows; ++row) {
+        const size_t file_row = info_.height - 1 - (first_row + row);
+        const uint8_t* src = data + file_row * row_size * sizeof(float);
+        T* dst = out.data() + row * row_size;
+        for (size_t i = 0; i < row_size; ++i) {
+          uint32_t bits;
+          std::memcpy(&bits, src + i * sizeof(bits), sizeof(bits));
+          if (swap) {
+            bits = (bits >> 24) | ((bits >> 8) & 0xff00) |
+                   ((bits << 8) & 0xff0000) | (bits << 24);
+          }
+          const float value = std::bit_cast<float>(bits);
+          // NaN fails both comparisons and maps to 0
+          const float clamped = value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+          dst[i] = static_cast<T>(
+              std::lround(clamped * std::numeric_limits<T>::max()));
+        }
+      }
+      break;
+    }
+  }
+}
+
+template std::span<const uint8_t> MappedImage::samples<uint8_t>() const;
+template std::span<const uint16_t> MappedImage::samples<uint16_t>() const;
+template void MappedImage::copy_rows<uint8_t>(int, std::span<uint8_t>) const;
+template void MappedImage::copy_rows<uint16_t>(int,
+                                               std::span<uint16_t>) const;
+
+MappedImageWriter::MappedImageWriter(const std::string& filepath, int width,
+                                     int height, int bit_depth,
+                                     ImageFormat format)
+    : path_(filepath) {
+  check_dimensions(width, height, bit_depth);
+  info_ = ImageInfo{.width = width,
+                    .height = height,
+                    .bit_depth = bit_depth,
+                    .format = format != ImageFormat::UNKNOWN
+                                  ? format
+                                  : detect_format(filepath)};
+
+  std::string header;
+  const int maxval = bit_depth == 16 ? 65535 : 255;
+  switch (info_.format) {
+    case ImageFormat::PPM:
+      header = std::format("{} {}\n{}\n", width, height, maxval);
+      header = "P6\n" + header_padding(3 + header.size()) + header;
+      break;
+    case ImageFormat::PAM:
+      header = std::format(
+          "WIDTH {}\nHEIGHT {}\nDEPTH 3\nMAXVAL {}\nTUPLTYPE RGB\nENDHDR\n",
+          width, height, maxval);
+      header = "P7\n" + header_padding(3 + header.size()) + header;
+      break;
+    case ImageFormat::PFM:
+      // A negative scale marks little-endian floats
+      header = std::format("PF\n{} {}\n{}\n", width, height,
+                           kLittleEndianHost ? "-1.0" : "1.0");
+      encoding_ = MappedImage::Encoding::Float32;
+      break;
+    case ImageFormat::RAW:
+      header.assign(kRawHeaderSize, '\0');
+      break;
+    default:
+      throw std::runtime_error(std::format(
+          "Not a PPM, PAM, PFM or RAW output path: {}", filepath));
+  }
+
+  const bool big_endian_samples = info_.format == ImageFormat::PPM ||
+                                  info_.format == ImageFormat::PAM;
+  if (bit_depth == 16 && big_endian_samples == kLittleEndianHost) {
+    encoding_ = MappedImage::Encoding::Swapped16;
+  }
+
+  data_offset_ = header.size();
+  const size_t data_size =
+      sample_count(info_) * stored_sample_size(info_.format, bit_depth);
+  file_ = MappedFile::create(path_, data_offset_ + data_size);
+
+  const std::span<uint8_t> bytes = file_.writable_data();
+  std::memcpy(bytes.data(), header.data(), header.size());
+  if (info_.format == ImageFormat::RAW) {
+    std::memcpy(bytes.data(), kRawMagic, sizeof(kRawMagic));
+    write_le32(bytes.data() + 8, static_cast<uint32_t>(width));
+    write_le32(bytes.data() + 12, static_cast<uint32_t>(height));
+    write_le32(bytes.data() + 16, kChannels);
+    write_le32(bytes.data() + 20, static_cast<uint32_t>(bit_depth));
+  }
+}
+
+template <typename T>
+std::span<T> MappedImageWriter::samples() {
+  check_sample_type<T>(info_);
+  if (!direct()) {
+    throw std::logic_error("PFM samples cannot be written in place");
+  }
+  return {reinterpret_cast<T*>(file_.writable_data().data() + data_offset_),
+          static_cast<size_t>(sample_count(info_))};
+}
+
+template <typename T>
+void MappedImageWriter::write_rows(int first_row, std::span<const T> rows) {
+  check_sample_type<T>(info_);
+  const int row_total = row_count(info_, first_row, rows);
+  const size_t row_size = static_cast<size_t>(info_.width) * kChannels;
+  uint8_t* data = file_.writable_data().data() + data_offset_;
+
+  if (direct()) {
+    // Host order; finish() swaps the whole file once
+    std::memcpy(data + first_row * row_size * sizeof(T), rows.data(),
+                rows.size_bytes());
+    return;
+  }
+
+  for (int row = 0; row < row_total; ++row) {
+    const size_t file_row = info_.height - 1 - (first_row + row);
+    uint8_t* dst = data + file_row * row_size * sizeof(float);
+    const T* src = rows.data() + row * row_size;
+    for (size_t i = 0; i < row_size; ++i) {
+      // The text header leaves the floats unaligned
+      const float value = static_cast<float>(src[i]) /
+                          static_cast<float>(std::numeric_limits<T>::max());
+      std::memcpy(dst + i * sizeof(value), &value, sizeof(value));
+    }
+  }
+}
+
+template std::span<uint8_t> MappedImageWriter::samples<uint8_t>();
+template std::span<uint16_t> MappedImageWriter::samples<uint16_t>();
+template void MappedImageWriter::write_rows<uint8_t>(int,
+                                                     std::span<const uint8_t>);
+template void MappedImageWriter::write_rows<uint16_t>(
+    int, std::span<const uint16_t>);
+
+void MappedImageWriter::finish() {
+  if (encoding_ == MappedImage::Encoding::Swapped16 && file_.size() > 0) {
+    for (uint16_t& sample : samples<uint16_t>()) {
+      sample = byteswap16(sample);
+    }
+  }
+  file_.close();
+}
+
+}  // namespace psm_cli
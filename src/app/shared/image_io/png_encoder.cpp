@@ -0,0 +1,342 @@
+#include "png_encoder.hpp"
+
+#include <png.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace psm_cli {
+
+namespace {
+// Filtered bytes per deflate block; larger blocks lose less to restarts
+constexpr size_t kDeflateBlockSize = size_t{1} << 20;
+constexpr size_t kDeflateWindow = size_t{1} << 15;
+
+// Rows filtered per work item
+constexpr size_t kFilterRows = 64;
+
+// Largest IDAT chunk written; the format allows up to 2^31 - 1 bytes
+constexpr size_t kMaxChunkSize = size_t{1} << 30;
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a,
+                                      '\n'};
+
+// Runs fn(i) for every i in [0, count) on up to @p threads threads and
+// rethrows the first exception
+template <typename Fn>
+void parallel_for(size_t count, int threads, Fn&& fn) {
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto worker = [&] {
+    for (size_t i = next++; i < count; i = next++) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    }
+  };
+
+  const size_t workers =
+      std::min(count, static_cast<size_t>(std::max(threads, 1)));
+  std::vector<std::jthread> pool;
+  for (size_t i = 1; i < workers; ++i) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  pool.clear();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  const int p = a + b - c;
+  const int pa = std::abs(p - a);
+  const int pb = std::abs(p - b);
+  const int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+// Applies PNG filter @p type to @p row into @p out; returns the sum of
+// absolute signed residuals, the heuristic libpng minimizes
+unsigned long filter_row(int type, const uint8_t* row, const uint8_t* prior,
+                         size_t row_bytes, size_t bpp, uint8_t* out) {
+  unsigned long cost = 0;
+  for (size_t i = 0; i < row_bytes; ++i) {
+    const uint8_t left = i >= bpp ? row[i - bpp] : 0;
+    const uint8_t up = prior[i];
+    const uint8_t up_left = i >= bpp ? prior[i - bpp] : 0;
+    uint8_t predictor = 0;
+    switch (type) {
+      case 1:
+        predictor = left;
+        break;
+      case 2:
+        predictor = up;
+        break;
+      case 3:
+        predictor = static_cast<uint8_t>((left + up) / 2);
+        break;
+      case 4:
+        predictor = paeth(left, up, up_left);
+        break;
+      default:
+        break;
+    }
+    const auto residual = static_cast<uint8_t>(row[i] - predictor);
+    out[i] = residual;
+    cost += residual < 128 ? residual : 256 - residual;
+  }
+  return cost;
+}
+
+// Big-endian bytes of a row of samples, as stored in a PNG
+template <typename DataType>
+void row_bytes_of(const DataType* samples, size_t count, uint8_t* out) {
+  if constexpr (sizeof(DataType) == 1) {
+    std::copy_n(samples, count, out);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      out[2 * i] = static_cast<uint8_t>(samples[i] >> 8);
+      out[2 * i + 1] = static_cast<uint8_t>(samples[i] & 0xff);
+    }
+  }
+}
+
+// Filtered image: each row is its filter type byte followed by the residuals
+template <typename DataType>
+std::vector<uint8_t> filter_image(const ImageData<DataType>& image,
+                                  int filters, int threads) {
+  const size_t height = static_cast<size_t>(image.height());
+  const size_t channels = static_cast<size_t>(image.channels());
+  const size_t samples = image.row_samples();
+  const size_t bpp = channels * sizeof(DataType);
+  const size_t row_bytes = samples * sizeof(DataType);
+
+  static constexpr int kFilterMasks[] = {PNG_FILTER_NONE, PNG_FILTER_SUB,
+                                         PNG_FILTER_UP, PNG_FILTER_AVG,
+                                         PNG_FILTER_PAETH};
+
+  std::vector<uint8_t> filtered(height * (row_bytes + 1));
+  auto filter_rows = [&](size_t job) {
+    std::vector<uint8_t> prior(row_bytes, 0);
+    std::vector<uint8_t> row(row_bytes);
+    std::vector<uint8_t> candidate(row_bytes);
+
+    const size_t first = job * kFilterRows;
+    const size_t last = std::min(first + kFilterRows, height);
+    if (first > 0) {
+      row_bytes_of(image.data() + (first - 1) * samples, samples,
+                   prior.data());
+    }
+
+    for (size_t y = first; y < last; ++y) {
+      row_bytes_of(image.data() + y * samples, samples, row.data());
+      uint8_t* out = filtered.data() + y * (row_bytes + 1);
+
+      unsigned long best_cost = ~0UL;
+      for (int type = 0; type < 5; ++type) {
+        if (!(filters & kFilterMasks[type])) {
+          continue;
+        }
+        const unsigned long cost = filter_row(
+            type, row.data(), prior.data(), row_bytes, bpp, candidate.data());
+        if (cost < best_cost) {
+          best_cost = cost;
+          out[0] = static_cast<uint8_t>(type);
+          std::copy(candidate.begin(), candidate.end(), out + 1);
+        }
+      }
+      std::swap(prior, row);
+    }
+  };
+
+  parallel_for((height + kFilterRows - 1) / kFilterRows, threads, filter_rows);
+  return filtered;
+}
+
+struct DeflatedBlock {
+  std::vector<uint8_t> data;
+  uLong adler = 0;
+  size_t size = 0;
+};
+
+// Raw deflate of one block; all but the last end byte-aligned without
+// BFINAL so the blocks can be concatenated
+DeflatedBlock deflate_block(const std::vector<uint8_t>& filtered,
+                            size_t offset, size_t size, bool last,
+                            const PngCompression& compression) {
+  z_stream stream{};
+  if (deflateInit2(&stream, compression.level, Z_DEFLATED, -15,
+                   compression.mem_level, compression.strategy) != Z_OK) {
+    throw std::runtime_error("Failed to initialize deflate");
+  }
+
+  if (offset > 0) {
+    const size_t dictionary = std::min(offset, kDeflateWindow);
+    deflateSetDictionary(&stream, filtered.data() + offset - dictionary,
+                         static_cast<uInt>(dictionary));
+  }
+
+  DeflatedBlock block;
+  block.size = size;
+  block.adler = adler32(adler32(0, nullptr, 0), filtered.data() + offset,
+                        static_cast<uInt>(size));
+  // A sync flush appends an empty stored block on top of the bound
+  block.data.resize(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+
+  stream.next_in = const_cast<Bytef*>(filtered.data() + offset);
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = block.data.data();
+  stream.avail_out = static_cast<uInt>(block.data.size());
+  const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  const bool complete = last ? result == Z_STREAM_END
+                             : result == Z_OK && stream.avail_in == 0;
+  block.data.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (!complete) {
+    throw std::runtime_error("Failed to deflate PNG image data");
+  }
+  return block;
+}
+
+void put_be32(std::vector<uint8_t>& out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void write_chunk(std::ofstream& file, const char (&type)[5],
+                 const uint8_t* data, size_t size) {
+  std::vector<uint8_t> header;
+  put_be32(header, static_cast<uint32_t>(size));
+  header.insert(header.end(), type, type + 4);
+
+  uLong crc = crc32(0, header.data() + 4, 4);
+  if (size > 0) {
+    // crc32 returns its initial value for a null buffer
+    crc = crc32(crc, data, static_cast<uInt>(size));
+  }
+  std::vector<uint8_t> trailer;
+  put_be32(trailer, static_cast<uint32_t>(crc));
+
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  file.write(reinterpret_cast<const char*>(data),
+             static_cast<std::streamsize>(size));
+  file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+}
+
+// FLEVEL bits of the zlib header, as zlib itself sets them
+uint8_t zlib_header_flags(int level) {
+  if (level < 2) {
+    return 0x01;
+  }
+  if (level < 6) {
+    return 0x5e;
+  }
+  return level == 6 || level == Z_DEFAULT_COMPRESSION ? 0x9c : 0xda;
+}
+}  // anonymous namespace
+
+PngCompression png_compression(PngProfile profile) {
+  switch (profile) {
+    case PngProfile::Fastest:
+      return {PNG_FILTER_SUB, 1, Z_RLE, 8};
+    case PngProfile::Smallest:
+      return {PNG_ALL_FILTERS, 9, Z_FILTERED, 9};
+    case PngProfile::Balanced:
+    default:
+      return {PNG_ALL_FILTERS, 6, Z_FILTERED, 8};
+  }
+}
+
+template <typename DataType>
+void write_png_parallel(const ImageData<DataType>& image,
+                        const std::string& filepath,
+                        const PngEncodeOptions& options) {
+  const int threads =
+      options.threads > 0
+          ? options.threads
+          : static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+  const PngCompression compression = png_compression(options.profile);
+
+  const std::vector<uint8_t> filtered =
+      filter_image(image, compression.filters, threads);
+
+  const size_t block_count =
+      std::max<size_t>((filtered.size() + kDeflateBlockSize - 1) /
+                           kDeflateBlockSize,
+                       1);
+  std::vector<DeflatedBlock> blocks(block_count);
+  parallel_for(block_count, threads, [&](size_t i) {
+    const size_t offset = i * kDeflateBlockSize;
+    const size_t size = std::min(kDeflateBlockSize, filtered.size() - offset);
+    blocks[i] = deflate_block(filtered, offset, size, i + 1 == block_count,
+                              compression);
+  });
+
+  // zlib header, the joined blocks, then the Adler-32 of all filtered bytes
+  std::vector<uint8_t> idat = {0x78, zlib_header_flags(compression.level)};
+  uLong adler = adler32(0, nullptr, 0);
+  for (const DeflatedBlock& block : blocks) {
+    idat.insert(idat.end(), block.data.begin(), block.data.end());
+    adler = adler32_combine(adler, block.adler,
+                            static_cast<z_off_t>(block.size));
+  }
+  put_be32(idat, static_cast<uint32_t>(adler));
+
+  std::vector<uint8_t> ihdr;
+  put_be32(ihdr, static_cast<uint32_t>(image.width()));
+  put_be32(ihdr, static_cast<uint32_t>(image.height()));
+  ihdr.push_back(static_cast<uint8_t>(sizeof(DataType) * 8));
+  ihdr.push_back(image.channels() == 4 ? PNG_COLOR_TYPE_RGB_ALPHA
+                                       : PNG_COLOR_TYPE_RGB);
+  // Deflate compression, adaptive filtering, no interlacing
+  ihdr.insert(ihdr.end(), {0, 0, 0});
+
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(std::format("Cannot open file: {}", filepath));
+  }
+  file.write(reinterpret_cast<const char*>(kPngSignature),
+             sizeof(kPngSignature));
+  write_chunk(file, "IHDR", ihdr.data(), ihdr.size());
+  for (size_t offset = 0; offset < idat.size(); offset += kMaxChunkSize) {
+    write_chunk(file, "IDAT", idat.data() + offset,
+                std::min(kMaxChunkSize, idat.size() - offset));
+  }
+  write_chunk(file, "IEND", nullptr, 0);
+  if (!file) {
+    throw std::runtime_error(std::format("Failed to write file: {}", filepath));
+  }
+}
+
+template void write_png_parallel<uint8_t>(const ImageData<uint8_t>&,
+                                          const std::string&,
+                                          const PngEncodeOptions&);
+template void write_png_parallel<uint16_t>(const ImageData<uint16_t>&,
+                                           const std::string&,
+                                           const PngEncodeOptions&);
+
+}  // namespace psm_cli
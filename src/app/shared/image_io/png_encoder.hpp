@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "image_io.hpp"
+
+namespace psm_cli {
+
+/// libpng/zlib settings of a PngProfile
+struct PngCompression {
+  int filters;    ///< PNG_FILTER_* mask
+  int level;      ///< zlib compression level
+  int strategy;   ///< zlib strategy
+  int mem_level;  ///< zlib memLevel
+};
+
+PngCompression png_compression(PngProfile profile);
+
+/**
+ * @brief Writes an 8-bit or 16-bit RGB or RGBA PNG whose rows are filtered and
+ * deflated by options.threads workers (0 = all cores)
+ *
+ * The filtered image is cut into fixed-size blocks, each deflated with the
+ * 32 KiB preceding it as preset dictionary and ended with a sync flush, so
+ * the blocks concatenate into one zlib stream; the Adler-32 checksums of the
+ * blocks are combined for its trailer.
+ *
+ * @throws std::runtime_error if the file cannot be written
+ */
+template <typename DataType>
+void write_png_parallel(const ImageData<DataType>& image,
+                        const std::string& filepath,
+                        const PngEncodeOptions& options);
+
+}  // namespace psm_cli
@@ -0,0 +1,114 @@
+#include "scratch_file.hpp"
+
+#include <zlib.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <random>
+#include <stdexcept>
+
+namespace psm_cli {
+
+namespace {
+// Names tried before giving up on a directory full of collisions
+constexpr int kCreateAttempts = 16;
+
+// Spilled data is written once and read once, so speed beats ratio
+constexpr int kCompressionLevel = 1;
+
+// Creates a file that did not exist before under a random name
+std::FILE* create_unique(const std::filesystem::path& directory,
+                         std::string& path) {
+  std::random_device random;
+  for (int attempt = 0; attempt < kCreateAttempts; ++attempt) {
+    const uint64_t id = (static_cast<uint64_t>(random()) << 32) | random();
+    path = (directory / std::format("psm-scratch-{:016x}.tmp", id)).string();
+    // "x" fails instead of opening a file someone else created
+    if (std::FILE* file = std::fopen(path.c_str(), "w+bx")) {
+      return file;
+    }
+    if (errno != EEXIST) {
+      break;
+    }
+  }
+  throw std::runtime_error(
+      std::format("Cannot create scratch file in {}: {}", directory.string(),
+                  std::strerror(errno)));
+}
+}  // anonymous namespace
+
+ScratchFile::ScratchFile(const std::string& directory, bool compress)
+    : compress_(compress) {
+  file_ = create_unique(directory, path_);
+}
+
+ScratchFile::~ScratchFile() {
+  std::fclose(file_);
+  std::error_code error;
+  std::filesystem::remove(path_, error);
+}
+
+void ScratchFile::seek(uint64_t offset) {
+#ifdef _WIN32
+  const int result = _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const int result = fseeko(file_, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  if (result != 0) {
+    throw std::runtime_error(std::format("Cannot seek in scratch file {}: {}",
+                                         path_, std::strerror(errno)));
+  }
+}
+
+ScratchFile::Extent ScratchFile::append(std::span<const uint8_t> block) {
+  Extent extent{.offset = size_, .stored_size = block.size(),
+                .size = block.size()};
+  std::span<const uint8_t> stored = block;
+  if (compress_) {
+    uLongf deflated = compressBound(static_cast<uLong>(block.size()));
+    buffer_.resize(deflated);
+    if (compress2(buffer_.data(), &deflated, block.data(),
+                  static_cast<uLong>(block.size()),
+                  kCompressionLevel) != Z_OK) {
+      throw std::runtime_error("Cannot compress scratch data");
+    }
+    stored = std::span(buffer_).first(deflated);
+    extent.stored_size = deflated;
+  }
+
+  // Reads move the position, so every append seeks back to the end
+  seek(size_);
+  if (std::fwrite(stored.data(), 1, stored.size(), file_) != stored.size()) {
+    throw std::runtime_error(std::format(
+        "Cannot write scratch file {}: {}", path_, std::strerror(errno)));
+  }
+  size_ += stored.size();
+  return extent;
+}
+
+void ScratchFile::read(const Extent& extent, std::span<uint8_t> out) {
+  std::span<uint8_t> stored = out.first(extent.size);
+  if (compress_) {
+    buffer_.resize(extent.stored_size);
+    stored = buffer_;
+  }
+
+  seek(extent.offset);
+  if (std::fread(stored.data(), 1, stored.size(), file_) != stored.size()) {
+    throw std::runtime_error(
+        std::format("Cannot read scratch file {}", path_));
+  }
+  if (compress_) {
+    uLongf inflated = static_cast<uLongf>(extent.size);
+    if (uncompress(out.data(), &inflated, buffer_.data(),
+                   static_cast<uLong>(buffer_.size())) != Z_OK ||
+        inflated != extent.size) {
+      throw std::runtime_error(
+          std::format("Corrupt scratch file {}", path_));
+    }
+  }
+}
+
+}  // namespace psm_cli
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace psm_cli {
+
+/**
+ * @brief Temporary file holding blocks of data spilled out of memory
+ *
+ * The file is created under a unique name in the given directory and removed
+ * when the ScratchFile is destroyed. Blocks are appended and read back by the
+ * extent append() returned. With compression each block is deflated on its
+ * own (zlib level 1), so any block can be read without the others. Offsets
+ * are 64-bit, so the file may grow past 4 GiB on every platform.
+ */
+class ScratchFile {
+ public:
+  /// Where append() stored a block
+  struct Extent {
+    uint64_t offset = 0;
+    uint64_t stored_size = 0;  ///< Bytes in the file
+    size_t size = 0;           ///< Bytes of the block
+  };
+
+  /// @throws std::runtime_error if no file can be created in @p directory
+  ScratchFile(const std::string& directory, bool compress);
+  ~ScratchFile();
+
+  ScratchFile(const ScratchFile&) = delete;
+  ScratchFile& operator=(const ScratchFile&) = delete;
+
+  /// @throws std::runtime_error if the block cannot be written
+  Extent append(std::span<const uint8_t> block);
+
+  /// Reads the block at @p extent into @p out, which holds extent.size bytes
+  /// @throws std::runtime_error if the block cannot be read
+  void read(const Extent& extent, std::span<uint8_t> out);
+
+  /// Bytes written to the file so far
+  uint64_t size() const { return size_; }
+
+ private:
+  void seek(uint64_t offset);
+
+  std::string path_;
+  std::FILE* file_ = nullptr;
+  bool compress_;
+  uint64_t size_ = 0;
+  std::vector<uint8_t> buffer_;  // Deflated block being written or read
+};
+
+}  // namespace psm_cli
@@ -1,12 +1,24 @@
 #include "image_processor.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
 #include <format>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 
+#include "../../cli/bounded_queue.hpp"
 #include "../../cli/cli_parser.hpp"
 #include "psm/adjust_channels.hpp"
 #include "psm/psm.hpp"
+#include "psm/rgba.hpp"
+#include "psm/ycbcr.hpp"
+#include "resize.hpp"
 
 namespace psm_cli {
 
@@ -51,6 +63,36 @@ void convert_between(std::string_view from_space, std::string_view to_space,
   }
 }
 
+namespace {
+// Calls fn with a default-constructed tag of the named color space
+template <typename Fn>
+void with_color_space(std::string_view name, std::string_view role, Fn&& fn) {
+  if (name == "sRGB") {
+    fn(psm::sRGB{});
+  } else if (name == "AdobeRGB") {
+    fn(psm::AdobeRGB{});
+  } else if (name == "DisplayP3") {
+    fn(psm::DisplayP3{});
+  } else if (name == "oRGB") {
+    fn(psm::oRGB{});
+  } else if (name == "ProPhotoRGB") {
+    fn(psm::ProPhotoRGB{});
+  } else {
+    throw std::invalid_argument(
+        std::format("Unsupported {} color space: {}", role, name));
+  }
+}
+}  // anonymous namespace
+
+void convert_ycbcr(std::string_view from_space, std::string_view to_space,
+                   const psm::YCbCrPlanes& planes, std::span<uint8_t> output) {
+  with_color_space(to_space, "target", [&](auto target) {
+    with_color_space(from_space, "source", [&](auto source) {
+      psm::ConvertYCbCr<decltype(source), decltype(target)>(planes, output);
+    });
+  });
+}
+
 template void convert_from<psm::sRGB, uint8_t>(std::string_view,
                                                std::span<const uint8_t>,
                                                std::span<uint8_t>);
@@ -119,49 +161,551 @@ void convert_colorspace(std::span<const DataType> input,
 }
 
 template <typename DataType>
-std::vector<DataType> process_image(const ImageData<DataType>& image_data,
-                                    const CLIOptions& options) {
-  const size_t image_size = image_data.size();
-  std::span<const DataType> input_image{image_data.data(), image_size};
+bool convert_colorspace_chunked(std::span<const DataType> input,
+                                std::span<DataType> output,
+                                int from_colorspace_id, int to_colorspace_id,
+                                const psm::AsyncOptions& options) {
+  return psm::detail::ConvertChunked(
+      input, output, options,
+      [=](std::span<const DataType> input_chunk,
+          std::span<DataType> output_chunk) {
+        convert_colorspace(input_chunk, output_chunk, from_colorspace_id,
+                           to_colorspace_id);
+      });
+}
 
-  std::vector<DataType> output_storage(image_size);
-  std::span<DataType> output_image{output_storage};
+ImageFormat input_format(const CLIOptions& options) {
+  return options.in_format != ImageFormat::UNKNOWN
+             ? options.in_format
+             : detect_format(options.input_file);
+}
+
+ImageFormat output_format(const CLIOptions& options) {
+  return options.out_format != ImageFormat::UNKNOWN
+             ? options.out_format
+             : detect_format(options.output_file);
+}
 
+LoadOptions load_options(const CLIOptions& options) {
+  // Alpha is only decoded when the output can store it; stdout without
+  // --out-format is written in the input's format
+  const bool png_output =
+      output_format(options) == ImageFormat::PNG ||
+      (is_stdio_path(options.output_file) &&
+       options.out_format == ImageFormat::UNKNOWN);
+  return LoadOptions{.max_dim = options.max_dim,
+                     .scale_denom = options.scale_denom,
+                     .keep_alpha = png_output,
+                     .format = options.in_format,
+                     .crop = options.crop,
+                     .scratch_dir = options.scratch_dir,
+                     .compress_scratch = options.scratch_compress};
+}
+
+namespace {
+void print_processing(int width, int height, int bit_depth,
+                      const CLIOptions& options) {
   std::cout << std::format("Processing {}x{} image with {}-bit precision\n",
-                           image_data.width(), image_data.height(),
-                           sizeof(DataType) * 8);
+                           width, height, bit_depth);
   std::cout << std::format("Converting from {} to {}\n", options.from_space,
                            options.to_space);
 
-  conversion::convert_between<DataType>(options.from_space, options.to_space,
-                                        input_image, output_image);
-
   if (options.adjust_values) {
     std::cout << std::format("Adjusting channels by R:{}%, G:{}%, B:{}%\n",
                              options.adjust_values->channel(0),
                              options.adjust_values->channel(1),
                              options.adjust_values->channel(2));
+  }
+}
+
+// Runs the conversion and adjustment selected in @p options, where
+// convert_to_target(out) converts the input from options.from_space to
+// options.to_space into out
+template <typename DataType, typename ConvertToTarget>
+void process_with(ConvertToTarget&& convert_to_target,
+                  std::span<DataType> output, std::vector<DataType>& scratch,
+                  const CLIOptions& options) {
+  if (!options.adjust_values) {
+    convert_to_target(output);
+    return;
+  }
+
+  if (options.from_space == options.to_space) {
+    convert_to_target(output);
+    psm::AdjustChannels(output, *options.adjust_values);
+    return;
+  }
+
+  // Adjust in the target space, then convert back to the source space
+  scratch.resize(output.size());
+  std::span<DataType> adjusted{scratch};
+  convert_to_target(adjusted);
+  psm::AdjustChannels(adjusted, *options.adjust_values);
+  conversion::convert_between<DataType>(
+      options.to_space, options.from_space,
+      std::span<const DataType>{adjusted}, output);
+}
+
+// Writer of options.output_file for the rows @p info describes
+template <typename DataType>
+ImageRowWriter open_row_writer(const ImageInfo& info,
+                               const CLIOptions& options) {
+  // stdout without --out-format is written in the input's format
+  const ImageFormat format = is_stdio_path(options.output_file) &&
+                                     options.out_format == ImageFormat::UNKNOWN
+                                 ? info.format
+                                 : options.out_format;
+  return ImageRowWriter(options.output_file, info.width, info.height,
+                        static_cast<int>(sizeof(DataType) * 8), info.channels,
+                        options.png, format);
+}
+
+template <typename DataType>
+void stream_rows(ImageRowReader& reader, const CLIOptions& options) {
+  const ImageInfo& info = reader.info();
+  ImageRowWriter writer = open_row_writer<DataType>(info, options);
 
-    psm::AdjustChannels(output_image, *options.adjust_values);
+  const size_t row_size = static_cast<size_t>(info.width) * info.channels;
+  std::vector<DataType> input_row(row_size);
+  std::vector<DataType> output_row(row_size);
+  std::vector<DataType> scratch;
 
-    if (options.from_space != options.to_space) {
-      std::vector<DataType> temp_storage(output_image.size());
-      std::span<DataType> temp_image{temp_storage};
+  while (reader.read_row(std::span<DataType>{input_row})) {
+    process_pixels<DataType>(input_row, output_row, scratch, options,
+                             info.channels);
+    writer.write_row(std::span<const DataType>{output_row});
+  }
+  writer.finish();
+
+  std::cout << std::format("Saved streamed image: {}\n", writer.path());
+}
+
+// Rows are converted in tiles of about this many bytes
+constexpr size_t kTileBytes = size_t{8} << 20;
+
+// A band of whole rows on its way from the decoder to the encoder
+template <typename DataType>
+struct Tile {
+  size_t index = 0;
+  int rows = 0;
+  std::vector<DataType> pixels;
+  std::vector<DataType> converted;
+};
+
+template <typename DataType>
+void tile_rows(ImageRowReader& reader, const CLIOptions& options,
+               int threads) {
+  using TileQueue = BoundedQueue<std::unique_ptr<Tile<DataType>>>;
+  const ImageInfo& info = reader.info();
+  ImageRowWriter writer = open_row_writer<DataType>(info, options);
+
+  const size_t row_size = static_cast<size_t>(info.width) * info.channels;
+  const int rows_per_tile = static_cast<int>(
+      std::clamp<size_t>(kTileBytes / (row_size * sizeof(DataType)), 1,
+                         static_cast<size_t>(info.height)));
+  const size_t tile_count =
+      (static_cast<size_t>(info.height) + rows_per_tile - 1) / rows_per_tile;
+  // Two tiles per converter keep every converter busy while the decoder
+  // fills one and the encoder drains another. Only these tiles are ever
+  // allocated, which is what bounds memory
+  const size_t in_flight =
+      std::min(2 * static_cast<size_t>(threads) + 2, tile_count);
+
+  std::cout << std::format(
+      "Converting {} tiles of {} rows on {} thread(s), {} in flight\n",
+      tile_count, rows_per_tile, threads, in_flight);
+
+  TileQueue free_tiles(in_flight);
+  TileQueue decoded(in_flight);
+  for (size_t i = 0; i < in_flight; ++i) {
+    auto tile = std::make_unique<Tile<DataType>>();
+    tile->pixels.resize(row_size * rows_per_tile);
+    tile->converted.resize(row_size * rows_per_tile);
+    free_tiles.push(std::move(tile));
+  }
+
+  // Converted tiles by index modulo in_flight: a tile is only decoded after
+  // the one in_flight places before it was written, so slots never collide
+  std::vector<std::unique_ptr<Tile<DataType>>> converted(in_flight);
+  std::mutex mutex;
+  std::condition_variable converted_ready;
+  std::exception_ptr error;
+  std::atomic<bool> failed{false};
+  // Records the first error and stops the decoder, which stops the rest
+  auto fail = [&] {
+    {
+      std::lock_guard lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      failed = true;
+    }
+    converted_ready.notify_all();
+    free_tiles.close();
+  };
+
+  {
+    std::jthread decoder([&] {
+      try {
+        std::unique_ptr<Tile<DataType>> tile;
+        for (size_t index = 0;
+             index < tile_count && free_tiles.pop(tile) && !failed; ++index) {
+          tile->index = index;
+          tile->rows = std::min(
+              rows_per_tile,
+              info.height - static_cast<int>(index) * rows_per_tile);
+          for (int row = 0; row < tile->rows; ++row) {
+            reader.read_row(
+                std::span(tile->pixels).subspan(row * row_size, row_size));
+          }
+          decoded.push(std::move(tile));
+        }
+      } catch (...) {
+        fail();
+      }
+      decoded.close();
+    });
 
-      conversion::convert_between<DataType>(
-          options.to_space, options.from_space, output_image, temp_image);
-      output_storage = std::move(temp_storage);
+    std::vector<std::jthread> converters;
+    for (int i = 0; i < threads; ++i) {
+      converters.emplace_back([&] {
+        std::vector<DataType> scratch;
+        std::unique_ptr<Tile<DataType>> tile;
+        while (decoded.pop(tile)) {
+          const size_t samples = tile->rows * row_size;
+          try {
+            if (!failed) {
+              process_pixels<DataType>(
+                  std::span<const DataType>(tile->pixels).first(samples),
+                  std::span(tile->converted).first(samples), scratch,
+                  options, info.channels);
+            }
+          } catch (...) {
+            fail();
+          }
+          {
+            std::lock_guard lock(mutex);
+            converted[tile->index % in_flight] = std::move(tile);
+          }
+          converted_ready.notify_all();
+        }
+      });
     }
+
+    // Tiles are encoded in order as soon as they are converted, so the
+    // output is written while later tiles are still being decoded
+    for (size_t index = 0; index < tile_count; ++index) {
+      std::unique_ptr<Tile<DataType>> tile;
+      {
+        std::unique_lock lock(mutex);
+        std::unique_ptr<Tile<DataType>>& slot = converted[index % in_flight];
+        converted_ready.wait(lock, [&] { return failed || slot; });
+        if (failed) {
+          break;
+        }
+        tile = std::move(slot);
+      }
+      try {
+        for (int row = 0; row < tile->rows; ++row) {
+          writer.write_row(std::span<const DataType>(tile->converted)
+                               .subspan(row * row_size, row_size));
+        }
+      } catch (...) {
+        fail();
+        break;
+      }
+      free_tiles.push(std::move(tile));
+    }
+  }  // Joins the decoder and the converters
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  writer.finish();
+
+  std::cout << std::format("Saved tiled image: {}\n", writer.path());
+}
+
+template <typename DataType>
+void convert_mapped_as(const MappedImage& input, const CLIOptions& options) {
+  const ImageInfo& info = input.info();
+  MappedImageWriter writer(options.output_file, info.width, info.height,
+                           info.bit_depth, options.out_format);
+
+  const size_t image_size =
+      static_cast<size_t>(info.width) * info.height * 3;
+  std::vector<DataType> input_copy;
+  std::vector<DataType> output_buffer;
+  std::vector<DataType> scratch;
+
+  std::span<const DataType> source;
+  if (input.direct()) {
+    source = input.samples<DataType>();
+  } else {
+    input_copy.resize(image_size);
+    input.copy_rows<DataType>(0, input_copy);
+    source = input_copy;
+  }
+
+  std::span<DataType> target;
+  if (writer.direct()) {
+    target = writer.samples<DataType>();
+  } else {
+    output_buffer.resize(image_size);
+    target = output_buffer;
+  }
+
+  process_pixels<DataType>(source, target, scratch, options);
+  if (!writer.direct()) {
+    writer.write_rows<DataType>(0, output_buffer);
   }
+  writer.finish();
+
+  std::cout << std::format("Saved mapped image ({} input, {} output): {}\n",
+                           input.direct() ? "zero-copy" : "converted",
+                           writer.direct() ? "zero-copy" : "converted",
+                           writer.path());
+}
+}  // anonymous namespace
+
+template <typename DataType>
+void process_pixels(std::span<const DataType> input, std::span<DataType> output,
+                    std::vector<DataType>& scratch, const CLIOptions& options,
+                    int channels) {
+  if (channels == 4) {
+    // Color channels go through the RGB path a cache-sized band at a time
+    psm::TransformRGBA<DataType>(
+        input, output,
+        [&](std::span<const DataType> rgb_in, std::span<DataType> rgb_out) {
+          process_pixels<DataType>(rgb_in, rgb_out, scratch, options);
+        });
+    return;
+  }
+
+  process_with<DataType>(
+      [&](std::span<DataType> out) {
+        conversion::convert_between<DataType>(options.from_space,
+                                              options.to_space, input, out);
+      },
+      output, scratch, options);
+}
+
+template <typename DataType>
+void convert_to_hub(std::span<const DataType> input, std::span<DataType> hub,
+                    std::string_view from_space, int channels) {
+  if (channels == 4) {
+    psm::TransformRGBA<DataType>(
+        input, hub,
+        [&](std::span<const DataType> rgb_in, std::span<DataType> rgb_out) {
+          conversion::convert_between<DataType>(from_space, "sRGB", rgb_in,
+                                                rgb_out);
+        });
+    return;
+  }
+  conversion::convert_between<DataType>(from_space, "sRGB", input, hub);
+}
+
+template <typename DataType>
+void process_hub_pixels(std::span<const DataType> hub,
+                        std::span<DataType> output,
+                        std::vector<DataType>& scratch,
+                        const CLIOptions& options, int channels) {
+  if (channels == 4) {
+    psm::TransformRGBA<DataType>(
+        hub, output,
+        [&](std::span<const DataType> rgb_in, std::span<DataType> rgb_out) {
+          process_hub_pixels<DataType>(rgb_in, rgb_out, scratch, options);
+        });
+    return;
+  }
+
+  // sRGB's own stages are copies, so sRGB to the target is exactly the
+  // target half of from_space to the target
+  process_with<DataType>(
+      [&](std::span<DataType> out) {
+        conversion::convert_between<DataType>("sRGB", options.to_space, hub,
+                                              out);
+      },
+      output, scratch, options);
+}
+
+std::vector<uint8_t> process_ycbcr(const YCbCrImage& image,
+                                   const CLIOptions& options) {
+  const psm::YCbCrPlanes planes{
+      .y = image.y,
+      .cb = image.cb,
+      .cr = image.cr,
+      .width = static_cast<size_t>(image.width),
+      .height = static_cast<size_t>(image.height),
+      .y_stride = static_cast<size_t>(image.y_stride),
+      .chroma_stride = static_cast<size_t>(image.chroma_stride),
+      .subsample_x = static_cast<size_t>(image.subsample_x),
+      .subsample_y = static_cast<size_t>(image.subsample_y)};
+
+  std::vector<uint8_t> output_storage(planes.width * planes.height * 3);
+  std::vector<uint8_t> scratch;
+
+  print_processing(image.width, image.height, 8, options);
+  std::cout << "Converting directly from YCbCr planes\n";
+  process_with<uint8_t>(
+      [&](std::span<uint8_t> out) {
+        conversion::convert_ycbcr(options.from_space, options.to_space, planes,
+                                  out);
+      },
+      std::span<uint8_t>{output_storage}, scratch, options);
 
   return output_storage;
 }
 
+template <typename DataType>
+std::string resize_for_conversion(ImageData<DataType>& image,
+                                  const CLIOptions& options) {
+  const ResizeOptions& resize = *options.resize;
+  const auto [width, height] =
+      resized_size(resize, image.width(), image.height());
+  if (width == image.width() && height == image.height()) {
+    return options.from_space;
+  }
+  std::cout << std::format("Resizing {}x{} to {}x{} in linear light\n",
+                           image.width(), image.height(), width, height);
+
+  if (has_transfer_curve(options.from_space)) {
+    image = resize_image<DataType>(image, resize, options.from_space);
+    return options.from_space;
+  }
+  std::vector<DataType> hub(image.size());
+  convert_to_hub<DataType>({image.data(), image.size()}, hub,
+                           options.from_space, image.channels());
+  const ImageData<DataType> hub_image(std::move(hub), image.width(),
+                                     image.height(), image.channels());
+  image = resize_image<DataType>(hub_image, resize, "sRGB");
+  return "sRGB";
+}
+
+template <typename DataType>
+std::vector<DataType> process_image(const ImageData<DataType>& image_data,
+                                    const CLIOptions& options) {
+  const size_t image_size = image_data.size();
+  std::span<const DataType> input_image{image_data.data(), image_size};
+
+  std::vector<DataType> output_storage(image_size);
+  std::vector<DataType> scratch;
+
+  print_processing(image_data.width(), image_data.height(),
+                   static_cast<int>(sizeof(DataType) * 8), options);
+  if (image_data.channels() == 4) {
+    std::cout << "Passing alpha through unchanged\n";
+  }
+  process_pixels<DataType>(input_image, output_storage, scratch, options,
+                           image_data.channels());
+
+  return output_storage;
+}
+
+PassInfo stream_image(const CLIOptions& options) {
+  LoadOptions load = load_options(options);
+  // A pipe cannot be decoded whole instead, so interlaced PNGs on stdin
+  // always spill
+  if (load.scratch_dir.empty() && is_stdio_path(options.input_file)) {
+    load.scratch_dir = std::filesystem::temp_directory_path().string();
+  }
+  ImageRowReader reader(options.input_file, load);
+  const ImageInfo& info = reader.info();
+
+  std::cout << std::format("Streaming {} rows from {}\n", info.height,
+                           options.input_file);
+  print_processing(info.width, info.height, info.bit_depth, options);
+
+  if (info.bit_depth == 16) {
+    stream_rows<uint16_t>(reader, options);
+  } else {
+    stream_rows<uint8_t>(reader, options);
+  }
+  return {info, reader.bytes_read()};
+}
+
+PassInfo tile_image(const CLIOptions& options) {
+  LoadOptions load = load_options(options);
+  if (load.scratch_dir.empty()) {
+    load.scratch_dir = std::filesystem::temp_directory_path().string();
+  }
+  ImageRowReader reader(options.input_file, load);
+  const ImageInfo& info = reader.info();
+
+  std::cout << std::format("Tiling {} rows from {}\n", info.height,
+                           options.input_file);
+  print_processing(info.width, info.height, info.bit_depth, options);
+
+  const int threads =
+      options.jobs > 0
+          ? options.jobs
+          : static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+  if (info.bit_depth == 16) {
+    tile_rows<uint16_t>(reader, options, threads);
+  } else {
+    tile_rows<uint8_t>(reader, options, threads);
+  }
+  return {info, reader.bytes_read()};
+}
+
+PassInfo convert_mapped(const CLIOptions& options) {
+  const MappedImage input(options.input_file);
+  const ImageInfo& info = input.info();
+
+  std::cout << std::format("Mapping {}\n", options.input_file);
+  print_processing(info.width, info.height, info.bit_depth, options);
+
+  if (info.bit_depth == 16) {
+    convert_mapped_as<uint16_t>(input, options);
+  } else {
+    convert_mapped_as<uint8_t>(input, options);
+  }
+  return {info};
+}
+
 template void convert_colorspace<uint8_t>(std::span<const uint8_t>,
                                           std::span<uint8_t>, int, int);
 template void convert_colorspace<uint16_t>(std::span<const uint16_t>,
                                            std::span<uint16_t>, int, int);
 
+template bool convert_colorspace_chunked<uint8_t>(std::span<const uint8_t>,
+                                                  std::span<uint8_t>, int, int,
+                                                  const psm::AsyncOptions&);
+template bool convert_colorspace_chunked<uint16_t>(std::span<const uint16_t>,
+                                                   std::span<uint16_t>, int,
+                                                   int,
+                                                   const psm::AsyncOptions&);
+
+template void process_pixels<uint8_t>(std::span<const uint8_t>,
+                                      std::span<uint8_t>,
+                                      std::vector<uint8_t>&,
+                                      const CLIOptions&, int);
+template void process_pixels<uint16_t>(std::span<const uint16_t>,
+                                       std::span<uint16_t>,
+                                       std::vector<uint16_t>&,
+                                       const CLIOptions&, int);
+
+template void convert_to_hub<uint8_t>(std::span<const uint8_t>,
+                                      std::span<uint8_t>, std::string_view,
+                                      int);
+template void convert_to_hub<uint16_t>(std::span<const uint16_t>,
+                                       std::span<uint16_t>, std::string_view,
+                                       int);
+
+template void process_hub_pixels<uint8_t>(std::span<const uint8_t>,
+                                          std::span<uint8_t>,
+                                          std::vector<uint8_t>&,
+                                          const CLIOptions&, int);
+template void process_hub_pixels<uint16_t>(std::span<const uint16_t>,
+                                           std::span<uint16_t>,
+                                           std::vector<uint16_t>&,
+                                           const CLIOptions&, int);
+
+template std::string resize_for_conversion<uint8_t>(ImageData<uint8_t>&,
+                                                   const CLIOptions&);
+template std::string resize_for_conversion<uint16_t>(ImageData<uint16_t>&,
+                                                    const CLIOptions&);
+
 template std::vector<uint8_t> process_image<uint8_t>(const ImageData<uint8_t>&,
                                                      const CLIOptions&);
 template std::vector<uint16_t> process_image<uint16_t>(
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
 #include "image_io/image_io.hpp"
+#include "psm/async.hpp"
+#include "psm/ycbcr.hpp"
 
 struct CLIOptions;
 
@@ -22,6 +26,10 @@ void convert_between(std::string_view from_space, std::string_view to_space,
                      std::span<const DataType> input,
                      std::span<DataType> output);
 
+/// Converts JPEG YCbCr planes, coding from_space RGB, to to_space
+void convert_ycbcr(std::string_view from_space, std::string_view to_space,
+                   const psm::YCbCrPlanes& planes, std::span<uint8_t> output);
+
 }  // namespace conversion
 
 template <typename DataType>
@@ -29,8 +37,139 @@ void convert_colorspace(std::span<const DataType> input,
                         std::span<DataType> output, int from_colorspace_id,
                         int to_colorspace_id);
 
+/**
+ * @brief Chunked variant of convert_colorspace with progress reporting and
+ * cancellation between chunks
+ *
+ * @return true if the whole image was converted, false if stopped early
+ */
+template <typename DataType>
+bool convert_colorspace_chunked(std::span<const DataType> input,
+                                std::span<DataType> output,
+                                int from_colorspace_id, int to_colorspace_id,
+                                const psm::AsyncOptions& options);
+
+/// Format of options.input_file: --in-format, or else by extension
+ImageFormat input_format(const CLIOptions& options);
+
+/// Format of options.output_file: --out-format, or else by extension
+ImageFormat output_format(const CLIOptions& options);
+
+/// Decode options selected by --max-dim, --scale, --in-format, --crop and
+/// --scratch-dir; alpha is kept for PNG output
+LoadOptions load_options(const CLIOptions& options);
+
+/**
+ * @brief Applies the conversion and channel adjustment selected in @p options
+ * to a run of pixels
+ *
+ * Works on any whole number of pixels, so process_image and stream_image
+ * produce identical output. @p scratch is resized as needed and can be reused
+ * across calls to avoid reallocating per row. With 4 channels the pixels are
+ * RGBA: color goes through psm::TransformRGBA in the same pass and alpha is
+ * copied unchanged.
+ */
+template <typename DataType>
+void process_pixels(std::span<const DataType> input, std::span<DataType> output,
+                    std::vector<DataType>& scratch, const CLIOptions& options,
+                    int channels = 3);
+
+/**
+ * @brief Converts pixels from @p from_space to sRGB, the stage every
+ * conversion passes through, for sharing one source-side pass between
+ * several targets
+ *
+ * Converting the result with process_hub_pixels gives the same output as
+ * process_pixels on the original pixels. With 4 channels alpha is copied.
+ */
+template <typename DataType>
+void convert_to_hub(std::span<const DataType> input, std::span<DataType> hub,
+                    std::string_view from_space, int channels = 3);
+
+/**
+ * @brief process_pixels for pixels already converted by convert_to_hub:
+ * converts them to options.to_space and applies options.adjust_values
+ */
+template <typename DataType>
+void process_hub_pixels(std::span<const DataType> hub,
+                        std::span<DataType> output,
+                        std::vector<DataType>& scratch,
+                        const CLIOptions& options, int channels = 3);
+
+/**
+ * @brief Resizes a decoded image to options.resize ahead of its conversion,
+ * so only the output pixels are converted
+ *
+ * Pixels are filtered in linear light of options.from_space. oRGB has no
+ * transfer curve, so oRGB input is first converted to sRGB with
+ * convert_to_hub and resized there.
+ *
+ * @return The color space of the resized pixels: options.from_space, or sRGB
+ * for oRGB input
+ */
+template <typename DataType>
+std::string resize_for_conversion(ImageData<DataType>& image,
+                                  const CLIOptions& options);
+
 template <typename DataType>
 std::vector<DataType> process_image(const ImageData<DataType>& image_data,
                                     const CLIOptions& options);
 
+/**
+ * @brief process_image for a JPEG decoded to YCbCr planes, converting the
+ * planes straight to options.to_space without an RGB intermediate image
+ */
+std::vector<uint8_t> process_ycbcr(const YCbCrImage& image,
+                                   const CLIOptions& options);
+
+/// What stream_image, tile_image and convert_mapped read
+struct PassInfo {
+  ImageInfo info;           ///< The input, cropped if options.crop is set
+  uint64_t bytes_read = 0;  ///< ImageRowReader::bytes_read() of the input
+};
+
+/**
+ * @brief Converts options.input_file to options.output_file one row at a time
+ *
+ * Decoding, conversion and encoding are interleaved per row, so peak memory is
+ * a few rows plus codec state regardless of image height. Either file may be
+ * "-" for standard input or output; stdout is written in options.out_format,
+ * or the input's format if that is UNKNOWN. Interlaced PNGs are spilled to
+ * options.scratch_dir, or for standard input, which has no other way to
+ * decode them, to the system temporary directory.
+ *
+ * @throws std::runtime_error on decode or encode failure
+ */
+PassInfo stream_image(const CLIOptions& options);
+
+/**
+ * @brief stream_image for images too large to hold in memory, converting
+ * bands of rows on options.jobs threads (0 = one per core)
+ *
+ * One thread decodes tiles of whole rows, about 8 MiB each, the converter
+ * threads convert them, and the calling thread encodes them in order as soon
+ * as they are ready, so the output is written progressively. A fixed pool of
+ * tiles circulates between the stages; once every tile is in use the decoder
+ * waits, which bounds memory by the thread count rather than the image size.
+ * Interlaced PNGs, which cannot be decoded in row order, are spilled to
+ * options.scratch_dir or else the system temporary directory. The output is
+ * identical to stream_image's.
+ *
+ * @throws std::runtime_error on decode or encode failure
+ */
+PassInfo tile_image(const CLIOptions& options);
+
+/**
+ * @brief Converts between mapped formats (PPM, PAM, PFM, RAW) through memory
+ * mappings of options.input_file and options.output_file
+ *
+ * When both files store host-order samples the conversion reads the input
+ * mapping and writes the output mapping directly, with no decode buffer or
+ * encode buffer; otherwise the side that needs conversion goes through one
+ * image-sized buffer. The files must be different.
+ *
+ * @throws std::runtime_error if a file cannot be mapped or parsed
+ */
+PassInfo convert_mapped(const CLIOptions& options);
+
 }  // namespace psm_cli
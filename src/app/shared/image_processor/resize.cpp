@@ -0,0 +1,291 @@
+#include "resize.hpp"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "psm/detail/pixel_transformation.hpp"
+
+namespace psm_cli {
+
+namespace {
+
+enum class TransferCurve { SRGB, PRO_PHOTO };
+
+TransferCurve transfer_curve(std::string_view color_space) {
+  if (color_space == "ProPhotoRGB") {
+    return TransferCurve::PRO_PHOTO;
+  } else if (has_transfer_curve(color_space)) {
+    return TransferCurve::SRGB;
+  }
+  throw std::invalid_argument(
+      std::format("Cannot resize {} pixels in linear light", color_space));
+}
+
+// ProPhoto RGB transfer function, as in the ProPhoto RGB module
+constexpr auto encode_pro_photo = [](float value) {
+  return (value < 1.0f / 512.0f) ? (16 * value)
+                                 : (std::pow(value, 1.0f / 1.8f));
+};
+
+constexpr auto decode_pro_photo = [](float value) {
+  return (value < 16.0f / 512.0f) ? (value / 16.0f) : (std::pow(value, 1.8f));
+};
+
+// Linear value of every code, so decoding a sample is one lookup
+template <typename DataType>
+Eigen::VectorXf decode_table(TransferCurve curve) {
+  Eigen::Matrix<DataType, Eigen::Dynamic, 1> codes(
+      std::numeric_limits<DataType>::max() + 1);
+  std::iota(codes.begin(), codes.end(), DataType{0});
+  if (curve == TransferCurve::SRGB) {
+    return psm::detail::transform::srgb::decode(codes);
+  }
+  return psm::detail::normalize_pixels(codes).unaryExpr(decode_pro_photo);
+}
+
+// The color samples of a run of interleaved pixels, skipping alpha
+using ColorRows =
+    Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>, 0,
+               Eigen::OuterStride<>>;
+
+void encode_colors(ColorRows colors, TransferCurve curve) {
+  colors = colors.cwiseMax(0.0f).cwiseMin(1.0f);
+  if (curve == TransferCurve::SRGB) {
+    colors = psm::detail::transform::srgb::encode(colors);
+  } else {
+    colors = colors.unaryExpr(encode_pro_photo);
+  }
+}
+
+float sinc(float x) {
+  if (x == 0.0f) {
+    return 1.0f;
+  }
+  x *= std::numbers::pi_v<float>;
+  return std::sin(x) / x;
+}
+
+float lanczos3(float x) {
+  x = std::abs(x);
+  return x < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+}
+
+float mitchell(float x) {
+  constexpr float B = 1.0f / 3.0f;
+  constexpr float C = 1.0f / 3.0f;
+  x = std::abs(x);
+  if (x < 1.0f) {
+    return ((12 - 9 * B - 6 * C) * x * x * x +
+            (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) /
+           6;
+  }
+  if (x < 2.0f) {
+    return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x +
+            (-12 * B - 48 * C) * x + (8 * B + 24 * C)) /
+           6;
+  }
+  return 0.0f;
+}
+
+struct Kernel {
+  float (*weight)(float);
+  float radius;
+};
+
+Kernel kernel_for(ResizeFilter filter) {
+  return filter == ResizeFilter::MITCHELL ? Kernel{mitchell, 2.0f}
+                                          : Kernel{lanczos3, 3.0f};
+}
+
+// Filter taps of one pass: output i is the sum over k < taps of
+// weights[i * taps + k] times input first[i] + k. Every output has the same
+// number of taps, padded with zero weights, so the inner loops have a fixed
+// trip count
+struct Taps {
+  int taps = 0;
+  std::vector<int> first;
+  std::vector<float> weights;
+};
+
+Taps compute_taps(int in_size, int out_size, const Kernel& kernel) {
+  const float scale = static_cast<float>(in_size) / out_size;
+  // Downscaling stretches the kernel over every input it covers, which makes
+  // it a low-pass filter; upscaling interpolates with the kernel as it is
+  const float stretch = std::max(scale, 1.0f);
+  const float support = kernel.radius * stretch;
+
+  Taps taps;
+  taps.taps =
+      std::min(in_size, static_cast<int>(std::ceil(2 * support)) + 2);
+  taps.first.resize(out_size);
+  taps.weights.assign(static_cast<size_t>(out_size) * taps.taps, 0.0f);
+  for (int i = 0; i < out_size; ++i) {
+    const float center = (i + 0.5f) * scale;
+    const int start = static_cast<int>(std::floor(center - support));
+    const int end = static_cast<int>(std::ceil(center + support));
+    const int first = std::clamp(start, 0, in_size - taps.taps);
+    float* weights = &taps.weights[static_cast<size_t>(i) * taps.taps];
+
+    float sum = 0.0f;
+    for (int j = start; j < end; ++j) {
+      const float weight = kernel.weight((j + 0.5f - center) / stretch);
+      // Inputs past the edges repeat the edge pixels
+      weights[std::clamp(j, 0, in_size - 1) - first] += weight;
+      sum += weight;
+    }
+    for (int k = 0; k < taps.taps; ++k) {
+      weights[k] /= sum;
+    }
+    taps.first[i] = first;
+  }
+  return taps;
+}
+
+// Linearizes and premultiplies one row of input pixels
+template <typename DataType>
+void decode_row(const DataType* input, float* row, int width, int channels,
+                const Eigen::VectorXf& table) {
+  constexpr float max_value = std::numeric_limits<DataType>::max();
+  for (int x = 0; x < width; ++x) {
+    const DataType* pixel = input + static_cast<size_t>(x) * channels;
+    float* out = row + static_cast<size_t>(x) * channels;
+    const float alpha = channels == 4 ? pixel[3] / max_value : 1.0f;
+    for (int c = 0; c < 3; ++c) {
+      out[c] = table[pixel[c]] * alpha;
+    }
+    if (channels == 4) {
+      out[3] = alpha;
+    }
+  }
+}
+
+template <int Channels>
+void filter_row(const float* row, float* out, const Taps& taps, int width) {
+  for (int x = 0; x < width; ++x) {
+    const float* weights = &taps.weights[static_cast<size_t>(x) * taps.taps];
+    const float* in = row + static_cast<size_t>(taps.first[x]) * Channels;
+    float sum[Channels] = {};
+    for (int k = 0; k < taps.taps; ++k) {
+      for (int c = 0; c < Channels; ++c) {
+        sum[c] += weights[k] * in[k * Channels + c];
+      }
+    }
+    for (int c = 0; c < Channels; ++c) {
+      out[static_cast<size_t>(x) * Channels + c] = sum[c];
+    }
+  }
+}
+
+// Undoes the premultiplication and the transfer curve of one output row
+template <typename DataType>
+void encode_row(float* row, DataType* output, int width, int channels,
+                TransferCurve curve) {
+  constexpr float max_value = std::numeric_limits<DataType>::max();
+  if (channels == 4) {
+    for (int x = 0; x < width; ++x) {
+      float* pixel = row + static_cast<size_t>(x) * 4;
+      pixel[3] = std::clamp(pixel[3], 0.0f, 1.0f);
+      if (pixel[3] > 0.0f) {
+        for (int c = 0; c < 3; ++c) {
+          pixel[c] /= pixel[3];
+        }
+      }
+    }
+  }
+  encode_colors(ColorRows(row, width, 3, Eigen::OuterStride<>(channels)),
+                curve);
+
+  const size_t samples = static_cast<size_t>(width) * channels;
+  for (size_t i = 0; i < samples; ++i) {
+    output[i] = static_cast<DataType>(row[i] * max_value + 0.5f);
+  }
+}
+}  // anonymous namespace
+
+std::pair<int, int> resized_size(const ResizeOptions& resize, int width,
+                                 int height) {
+  if (resize.width > 0 && resize.height > 0) {
+    return {resize.width, resize.height};
+  }
+  if (resize.width > 0) {
+    const double ratio = static_cast<double>(height) / width;
+    return {resize.width,
+            std::max(1, static_cast<int>(std::lround(resize.width * ratio)))};
+  }
+  const double ratio = static_cast<double>(width) / height;
+  return {std::max(1, static_cast<int>(std::lround(resize.height * ratio))),
+          resize.height};
+}
+
+bool has_transfer_curve(std::string_view color_space) {
+  return color_space == "sRGB" || color_space == "AdobeRGB" ||
+         color_space == "DisplayP3" || color_space == "ProPhotoRGB";
+}
+
+template <typename DataType>
+ImageData<DataType> resize_image(const ImageData<DataType>& image,
+                                 const ResizeOptions& resize,
+                                 std::string_view color_space) {
+  const TransferCurve curve = transfer_curve(color_space);
+  const auto [width, height] =
+      resized_size(resize, image.width(), image.height());
+  const int channels = image.channels();
+  const Kernel kernel = kernel_for(resize.filter);
+  const Taps columns = compute_taps(image.width(), width, kernel);
+  const Taps rows = compute_taps(image.height(), height, kernel);
+  const Eigen::VectorXf table = decode_table<DataType>(curve);
+
+  // Horizontal pass: every input row, already at the output width
+  const size_t in_row = image.row_samples();
+  const size_t out_row = static_cast<size_t>(width) * channels;
+  std::vector<float> linear(in_row);
+  std::vector<float> filtered(out_row * image.height());
+  for (int y = 0; y < image.height(); ++y) {
+    decode_row<DataType>(image.data() + y * in_row, linear.data(),
+                         image.width(), channels, table);
+    float* out = filtered.data() + y * out_row;
+    if (channels == 4) {
+      filter_row<4>(linear.data(), out, columns, width);
+    } else {
+      filter_row<3>(linear.data(), out, columns, width);
+    }
+  }
+
+  // Vertical pass: each output row is a weighted sum of whole rows
+  std::vector<DataType> output(out_row * height);
+  std::vector<float> row(out_row);
+  for (int y = 0; y < height; ++y) {
+    std::fill(row.begin(), row.end(), 0.0f);
+    const float* weights = &rows.weights[static_cast<size_t>(y) * rows.taps];
+    for (int k = 0; k < rows.taps; ++k) {
+      const float weight = weights[k];
+      if (weight == 0.0f) {
+        continue;
+      }
+      const float* in = filtered.data() + (rows.first[y] + k) * out_row;
+      for (size_t i = 0; i < out_row; ++i) {
+        row[i] += weight * in[i];
+      }
+    }
+    encode_row<DataType>(row.data(), output.data() + y * out_row, width,
+                         channels, curve);
+  }
+
+  return ImageData<DataType>(std::move(output), width, height, channels);
+}
+
+template ImageData<uint8_t> resize_image<uint8_t>(const ImageData<uint8_t>&,
+                                                  const ResizeOptions&,
+                                                  std::string_view);
+template ImageData<uint16_t> resize_image<uint16_t>(
+    const ImageData<uint16_t>&, const ResizeOptions&, std::string_view);
+
+}  // namespace psm_cli
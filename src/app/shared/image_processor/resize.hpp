@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+
+#include "image_io/image_io.hpp"
+
+namespace psm_cli {
+
+/// Resampling filter of --resize
+enum class ResizeFilter {
+  LANCZOS3,  ///< Windowed sinc over 3 lobes; sharpest, rings at hard edges
+  MITCHELL,  ///< Mitchell-Netravali cubic, B = C = 1/3; softer, no ringing
+};
+
+/// Output size and filter of --resize; a side of 0 follows the other side so
+/// the aspect ratio is kept
+struct ResizeOptions {
+  int width = 0;
+  int height = 0;
+  ResizeFilter filter = ResizeFilter::LANCZOS3;
+};
+
+/// @return The width and height a @p width x @p height image is resized to
+std::pair<int, int> resized_size(const ResizeOptions& resize, int width,
+                                 int height);
+
+/// Whether resize_image can linearize pixels of @p color_space; oRGB has no
+/// transfer curve to undo
+bool has_transfer_curve(std::string_view color_space);
+
+/**
+ * @brief Resamples @p image to the size selected by @p resize in linear light
+ *
+ * Samples are decoded through the transfer curve of @p color_space (psm
+ * codes sRGB, Adobe RGB and Display P3 with the sRGB curve, ProPhoto RGB with
+ * its own), filtered horizontally and then vertically, and encoded back, so
+ * the result is still in @p color_space. Filtering the encoded values instead
+ * would darken fine detail and high-contrast edges. Each pass uses precomputed
+ * taps of one fixed length, and the vertical pass accumulates whole rows, so
+ * the inner loops vectorize. Alpha is premultiplied while filtering.
+ *
+ * @throws std::invalid_argument if @p color_space has no transfer curve
+ */
+template <typename DataType>
+ImageData<DataType> resize_image(const ImageData<DataType>& image,
+                                 const ResizeOptions& resize,
+                                 std::string_view color_space);
+
+}  // namespace psm_cli
@@ -18,14 +18,13 @@ void adjustChannels(std::span<T> buffer, const Percent& adjust_percentage) {
       static_cast<float>(adjust_percentage.channel(1)) / 100.0f,
       static_cast<float>(adjust_percentage.channel(2)) / 100.0f;
 
-  Eigen::MatrixXf normalized_src = normalize_pixels(split_src);
-  Eigen::MatrixXf adjusted =
-      (normalized_src.array() *
-       (1.0f + adjustments.replicate(split_src.rows(), 1)))
+  // Evaluated coefficient-wise straight back into the buffer, so adjusting
+  // needs no scratch memory
+  split_src = denormalize_as<T>(
+      (normalize_pixels(split_src).array().rowwise() * (1.0f + adjustments))
           .cwiseMin(1.0f)
-          .cwiseMax(0.0f);
-
-  split_src = denormalize_as<T>(adjusted);
+          .cwiseMax(0.0f)
+          .matrix());
 }
 
 template void adjustChannels<unsigned char>(std::span<unsigned char>,
@@ -6,26 +6,29 @@
 
 #include "psm/detail/colorspace.hpp"
 #include "psm/detail/pixel_transformation.hpp"
+#include "psm/detail/scratch_buffer.hpp"
 #include "psm/detail/types.hpp"
 
 namespace {
 
-psm::detail::Mat3f xyz2adobe_rgb(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto xyz2adobe_rgb(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 2.0413690f, -0.5649464f, -0.3446944f,
-                   -0.9692660f, 1.8760108f, 0.0415560f,
-                   0.0134474f, -0.1183897f, 1.0154096f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      2.0413690f, -0.5649464f, -0.3446944f,
+     -0.9692660f,  1.8760108f,  0.0415560f,
+      0.0134474f, -0.1183897f,  1.0154096f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
 
-psm::detail::Mat3f adobe_rgb2xyz(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto adobe_rgb2xyz(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 0.5767309f,  0.1855540f,  0.1881852f,
-                   0.2973769f,  0.6273491f,  0.0752741f,
-                   0.0270343f,  0.0706872f,  0.9911085f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      0.5767309f,  0.1855540f,  0.1881852f,
+      0.2973769f,  0.6273491f,  0.0752741f,
+      0.0270343f,  0.0706872f,  0.9911085f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
@@ -36,46 +39,67 @@ namespace psm::detail {
 template <typename T>
 void AdobeRgb::fromSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = transform::srgb::decode(map_src);
 
   // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView norm_rgb(norm_src.data(), norm_src.cols() / 3,
-                                        3);
-  const psm::detail::Mat3f xyz = psm::detail::srgbToXyz(norm_rgb);
-  const psm::detail::Mat3f adobe_rgb = xyz2adobe_rgb(xyz);
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() = transform::srgb::decode(map_src);
+  xyz.pixels().noalias() = psm::detail::srgbToXyz(rgb.pixels());
 
-  const Eigen::Map<const psm::detail::RowXf> adobe_rgb_row(
-      adobe_rgb.data(), adobe_rgb.rows() * adobe_rgb.cols());
-
-  psm::detail::RowXf encoded_adobe_rgb = transform::srgb::encode(adobe_rgb_row);
-
-  const psm::detail::Mat3fView result(encoded_adobe_rgb.data(),
-                                      encoded_adobe_rgb.size() / 3, 3);
+  // Reuse the decoded buffer for the Adobe RGB result
+  rgb.pixels().noalias() = xyz2adobe_rgb(xyz.pixels());
+  rgb.flat() = transform::srgb::encode(rgb.flat());
 
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(rgb.flat());
 }
 
 template <typename T>
 void AdobeRgb::toSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = transform::srgb::decode(map_src);
 
   // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView adobe_rgb(norm_src.data(), norm_src.cols() / 3,
-                                         3);
-  const psm::detail::Mat3f xyz = adobe_rgb2xyz(adobe_rgb);
-  const psm::detail::Mat3f srgb = psm::detail::xyzToSrgb(xyz);
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() = transform::srgb::decode(map_src);
+  xyz.pixels().noalias() = adobe_rgb2xyz(rgb.pixels());
 
-  const Eigen::Map<const psm::detail::RowXf> srgb_row(
-      srgb.data(), srgb.rows() * srgb.cols());
-  psm::detail::RowXf encoded_srgb = transform::srgb::encode(srgb_row);
-
-  const psm::detail::Mat3fView result(encoded_srgb.data(),
-                                      encoded_srgb.size() / 3, 3);
+  // Reuse the decoded buffer for the sRGB result
+  rgb.pixels().noalias() = psm::detail::xyzToSrgb(xyz.pixels());
+  rgb.flat() = transform::srgb::encode(rgb.flat());
 
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(rgb.flat());
+}
+
+// Single-pixel versions of the stages above, evaluated in fixed-size
+// vectors so they never touch the heap
+template <typename T>
+Pixel<T> AdobeRgb::fromSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = transform::srgb::decode(map_src);
+  const Eigen::RowVector3f xyz = psm::detail::srgbToXyz(rgb);
+  const Eigen::RowVector3f linear = xyz2adobe_rgb(xyz);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(transform::srgb::encode(linear));
+  return dst;
+}
+
+template <typename T>
+Pixel<T> AdobeRgb::toSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = transform::srgb::decode(map_src);
+  const Eigen::RowVector3f xyz = adobe_rgb2xyz(rgb);
+  const Eigen::RowVector3f linear = psm::detail::xyzToSrgb(xyz);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(transform::srgb::encode(linear));
+  return dst;
 }
 
 template void AdobeRgb::fromSRGB<unsigned char>(std::span<const unsigned char>,
@@ -87,4 +111,14 @@ template void AdobeRgb::fromSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                                 std::span<std::uint16_t>);
 template void AdobeRgb::toSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                               std::span<std::uint16_t>);
+
+template Pixel<unsigned char> AdobeRgb::fromSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+template Pixel<unsigned char> AdobeRgb::toSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+
+template Pixel<std::uint16_t> AdobeRgb::fromSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
+template Pixel<std::uint16_t> AdobeRgb::toSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
 }  // namespace psm::detail
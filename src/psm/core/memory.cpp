@@ -0,0 +1,88 @@
+#include "psm/memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace psm::memory {
+
+namespace {
+
+struct ThreadCounters {
+  std::size_t allocations = 0;
+  std::size_t bytes_allocated = 0;
+  std::size_t live_bytes = 0;
+  std::size_t peak_bytes = 0;
+};
+
+std::atomic<std::size_t> g_allocations{0};
+std::atomic<std::size_t> g_bytes_allocated{0};
+std::atomic<std::size_t> g_live_bytes{0};
+std::atomic<std::size_t> g_peak_bytes{0};
+
+thread_local ThreadCounters t_counters;
+
+void raisePeak(std::atomic<std::size_t>& peak, std::size_t value) {
+  std::size_t current = peak.load(std::memory_order_relaxed);
+  while (current < value &&
+         !peak.compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+namespace detail {
+
+void recordAllocation(std::size_t bytes) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+  const std::size_t live =
+      g_live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  raisePeak(g_peak_bytes, live);
+
+  ThreadCounters& counters = t_counters;
+  ++counters.allocations;
+  counters.bytes_allocated += bytes;
+  counters.live_bytes += bytes;
+  counters.peak_bytes = std::max(counters.peak_bytes, counters.live_bytes);
+}
+
+void recordRelease(std::size_t bytes) {
+  g_live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  t_counters.live_bytes -= bytes;
+}
+
+}  // namespace detail
+
+Stats Snapshot() {
+  return {g_allocations.load(std::memory_order_relaxed),
+          g_bytes_allocated.load(std::memory_order_relaxed),
+          g_peak_bytes.load(std::memory_order_relaxed)};
+}
+
+void Reset() {
+  g_allocations.store(0, std::memory_order_relaxed);
+  g_bytes_allocated.store(0, std::memory_order_relaxed);
+  g_peak_bytes.store(g_live_bytes.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+}
+
+ScopedTracker::ScopedTracker()
+    : start_allocations_(t_counters.allocations),
+      start_bytes_allocated_(t_counters.bytes_allocated),
+      start_live_bytes_(t_counters.live_bytes),
+      saved_peak_bytes_(t_counters.peak_bytes) {
+  t_counters.peak_bytes = t_counters.live_bytes;
+}
+
+ScopedTracker::~ScopedTracker() {
+  t_counters.peak_bytes = std::max(saved_peak_bytes_, t_counters.peak_bytes);
+}
+
+Stats ScopedTracker::stats() const {
+  return {t_counters.allocations - start_allocations_,
+          t_counters.bytes_allocated - start_bytes_allocated_,
+          t_counters.peak_bytes - start_live_bytes_};
+}
+
+}  // namespace psm::memory
@@ -0,0 +1,112 @@
+#include "psm/metrics.hpp"
+
+#include <atomic>
+
+namespace psm::metrics {
+
+#ifdef PSM_ENABLE_METRICS
+
+namespace {
+
+struct AtomicCounter {
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> pixels{0};
+  std::atomic<std::uint64_t> nanoseconds{0};
+
+  void add(std::size_t pixel_count, std::uint64_t elapsed) {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    pixels.fetch_add(pixel_count, std::memory_order_relaxed);
+    nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+  }
+
+  Counter load() const {
+    return {calls.load(std::memory_order_relaxed),
+            pixels.load(std::memory_order_relaxed),
+            nanoseconds.load(std::memory_order_relaxed)};
+  }
+
+  void reset() {
+    calls.store(0, std::memory_order_relaxed);
+    pixels.store(0, std::memory_order_relaxed);
+    nanoseconds.store(0, std::memory_order_relaxed);
+  }
+};
+
+template <std::size_t Outer, std::size_t Inner>
+using AtomicTable = std::array<
+    std::array<std::array<AtomicCounter, kPixelTypeCount>, Inner>, Outer>;
+
+AtomicTable<kModuleCount, kStageCount> g_stages;
+AtomicTable<kModuleCount, kModuleCount> g_conversions;
+
+template <typename Enum>
+constexpr std::size_t index(Enum value) {
+  return static_cast<std::size_t>(value);
+}
+
+template <typename Source, typename Target>
+void copyTable(const Source& source, Target& target) {
+  for (std::size_t i = 0; i < source.size(); ++i) {
+    for (std::size_t j = 0; j < source[i].size(); ++j) {
+      for (std::size_t k = 0; k < source[i][j].size(); ++k) {
+        target[i][j][k] = source[i][j][k].load();
+      }
+    }
+  }
+}
+
+template <typename Table>
+void resetTable(Table& table) {
+  for (auto& outer : table) {
+    for (auto& inner : outer) {
+      for (auto& counter : inner) {
+        counter.reset();
+      }
+    }
+  }
+}
+
+}  // namespace
+
+namespace detail {
+
+void recordStage(Module module, Stage stage, PixelType type, std::size_t pixels,
+                 std::uint64_t nanoseconds) {
+  g_stages[index(module)][index(stage)][index(type)].add(pixels, nanoseconds);
+}
+
+void recordConversion(Module src, Module dst, PixelType type,
+                      std::size_t pixels, std::uint64_t nanoseconds) {
+  g_conversions[index(src)][index(dst)][index(type)].add(pixels, nanoseconds);
+}
+
+}  // namespace detail
+
+Snapshot Collect() {
+  Snapshot snapshot;
+  copyTable(g_stages, snapshot.stages);
+  copyTable(g_conversions, snapshot.conversions);
+  return snapshot;
+}
+
+void Reset() {
+  resetTable(g_stages);
+  resetTable(g_conversions);
+}
+
+#else
+
+namespace detail {
+
+void recordStage(Module, Stage, PixelType, std::size_t, std::uint64_t) {}
+void recordConversion(Module, Module, PixelType, std::size_t, std::uint64_t) {}
+
+}  // namespace detail
+
+Snapshot Collect() { return {}; }
+
+void Reset() {}
+
+#endif
+
+}  // namespace psm::metrics
@@ -6,26 +6,29 @@
 
 #include "psm/detail/colorspace.hpp"
 #include "psm/detail/pixel_transformation.hpp"
+#include "psm/detail/scratch_buffer.hpp"
 #include "psm/detail/types.hpp"
 
 namespace {
 
-psm::detail::Mat3f xyz2display_p3(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto xyz2display_p3(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 2.4934969, -0.9313836, -0.4027107,
-                  -0.8294889,  1.7626640,  0.0236247,
-                   0.0358458, -0.0761724,  0.9568845;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      2.4934969f, -0.9313836f, -0.4027107f,
+     -0.8294889f,  1.7626640f,  0.0236247f,
+      0.0358458f, -0.0761724f,  0.9568845f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
 
-psm::detail::Mat3f display_p3_2xyz(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto display_p3_2xyz(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 0.4865709, 0.2656677, 0.1982173,
-                   0.2289746, 0.6917385, 0.0792869,
-                   0.0000000, 0.0451134, 1.0439444;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      0.4865709f, 0.2656677f, 0.1982173f,
+      0.2289746f, 0.6917385f, 0.0792869f,
+      0.0000000f, 0.0451134f, 1.0439444f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
@@ -37,47 +40,67 @@ namespace psm::detail {
 template <typename T>
 void DisplayP3::fromSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = transform::srgb::decode(map_src);
 
   // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView norm_rgb(norm_src.data(), norm_src.cols() / 3,
-                                        3);
-  const psm::detail::Mat3f xyz = psm::detail::srgbToXyz(norm_rgb);
-  const psm::detail::Mat3f display_p3 = xyz2display_p3(xyz);
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() = transform::srgb::decode(map_src);
+  xyz.pixels().noalias() = psm::detail::srgbToXyz(rgb.pixels());
 
-  const Eigen::Map<const psm::detail::RowXf> display_p3_row(
-      display_p3.data(), display_p3.rows() * display_p3.cols());
-
-  psm::detail::RowXf encoded_display_p3 =
-      transform::srgb::encode(display_p3_row);
-
-  const psm::detail::Mat3fView result(encoded_display_p3.data(),
-                                      encoded_display_p3.size() / 3, 3);
+  // Reuse the decoded buffer for the Display P3 result
+  rgb.pixels().noalias() = xyz2display_p3(xyz.pixels());
+  rgb.flat() = transform::srgb::encode(rgb.flat());
 
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(rgb.flat());
 }
 
 template <typename T>
 void DisplayP3::toSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = transform::srgb::decode(map_src);
 
   // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView display_p3(norm_src.data(), norm_src.cols() / 3,
-                                          3);
-  const psm::detail::Mat3f xyz = display_p3_2xyz(display_p3);
-  const psm::detail::Mat3f srgb = psm::detail::xyzToSrgb(xyz);
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() = transform::srgb::decode(map_src);
+  xyz.pixels().noalias() = display_p3_2xyz(rgb.pixels());
 
-  const Eigen::Map<const psm::detail::RowXf> srgb_row(
-      srgb.data(), srgb.rows() * srgb.cols());
-  psm::detail::RowXf encoded_srgb = transform::srgb::encode(srgb_row);
-
-  const psm::detail::Mat3fView result(encoded_srgb.data(),
-                                      encoded_srgb.size() / 3, 3);
+  // Reuse the decoded buffer for the sRGB result
+  rgb.pixels().noalias() = psm::detail::xyzToSrgb(xyz.pixels());
+  rgb.flat() = transform::srgb::encode(rgb.flat());
 
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(rgb.flat());
+}
+
+// Single-pixel versions of the stages above, evaluated in fixed-size
+// vectors so they never touch the heap
+template <typename T>
+Pixel<T> DisplayP3::fromSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = transform::srgb::decode(map_src);
+  const Eigen::RowVector3f xyz = psm::detail::srgbToXyz(rgb);
+  const Eigen::RowVector3f linear = xyz2display_p3(xyz);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(transform::srgb::encode(linear));
+  return dst;
+}
+
+template <typename T>
+Pixel<T> DisplayP3::toSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = transform::srgb::decode(map_src);
+  const Eigen::RowVector3f xyz = display_p3_2xyz(rgb);
+  const Eigen::RowVector3f linear = psm::detail::xyzToSrgb(xyz);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(transform::srgb::encode(linear));
+  return dst;
 }
 
 template void DisplayP3::fromSRGB<unsigned char>(std::span<const unsigned char>,
@@ -89,4 +112,14 @@ template void DisplayP3::fromSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                                  std::span<std::uint16_t>);
 template void DisplayP3::toSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                                std::span<std::uint16_t>);
+
+template Pixel<unsigned char> DisplayP3::fromSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+template Pixel<unsigned char> DisplayP3::toSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+
+template Pixel<std::uint16_t> DisplayP3::fromSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
+template Pixel<std::uint16_t> DisplayP3::toSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
 }  // namespace psm::detail
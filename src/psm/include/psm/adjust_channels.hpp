@@ -2,7 +2,11 @@
 
 #include <ranges>
 #include <span>
+#include <type_traits>
 
+#include "detail/module_id.hpp"
+#include "detail/trace.hpp"
+#include "metrics.hpp"
 #include "percent.hpp"
 
 namespace psm {
@@ -14,7 +18,13 @@ void adjustChannels(std::span<T> buffer, const Percent& adjust_percentage);
 
 template <typename T>
 void AdjustChannelsImpl(std::span<T> buffer, const Percent& adjust_percentage) {
+  constexpr auto type_id = pixelTypeIdOf<std::remove_const_t<T>>();
+  const std::size_t pixels = buffer.size() / 3;
+  const metrics::detail::StageTimer timer(
+      ModuleId::AdjustChannels, metrics::Stage::Adjust, type_id, pixels);
+  PSM_TRACE(adjust_entry, static_cast<int>(type_id), pixels);
   adjustChannels(buffer, adjust_percentage);
+  PSM_TRACE(adjust_return, static_cast<int>(type_id), pixels);
 }
 
 }  // namespace detail
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <ranges>
+#include <span>
+#include <stop_token>
+#include <utility>
+
+#include "psm.hpp"
+
+namespace psm {
+
+/**
+ * @brief Progress callback, called after each chunk with the number of pixels
+ * converted so far and the total number of pixels
+ */
+using ProgressCallback =
+    std::function<void(std::size_t done_pixels, std::size_t total_pixels)>;
+
+/**
+ * @brief Options for chunked conversions such as psm::ConvertAsync
+ */
+struct AsyncOptions {
+  /// Pixels converted per chunk. Progress and cancellation are handled
+  /// between chunks, so this bounds the reaction time to a stop request.
+  std::size_t chunk_pixels = 64 * 1024;
+  /// Called on the converting thread after every chunk (may be empty)
+  ProgressCallback on_progress = {};
+  /// Checked before every chunk; once stop is requested no further chunk starts
+  std::stop_token stop_token = {};
+};
+
+namespace detail {
+
+/**
+ * @brief Runs @p convert_chunk over consecutive pixel-aligned chunks of
+ * @p src and @p dst, reporting progress and honoring cancellation
+ *
+ * @return true if every chunk was converted, false if stopped early
+ */
+template <typename T, typename ConvertChunk>
+bool ConvertChunked(std::span<const T> src, std::span<T> dst,
+                    const AsyncOptions& options, ConvertChunk&& convert_chunk) {
+  checkBufferSizes(src.size(), dst.size());
+
+  const std::size_t total = src.size() / 3;
+  const std::size_t chunk = std::max<std::size_t>(options.chunk_pixels, 1);
+  for (std::size_t done = 0; done < total;) {
+    if (options.stop_token.stop_requested()) {
+      return false;
+    }
+
+    const std::size_t count = std::min(chunk, total - done);
+    convert_chunk(src.subspan(done * 3, count * 3),
+                  dst.subspan(done * 3, count * 3));
+    done += count;
+
+    if (options.on_progress) {
+      options.on_progress(done, total);
+    }
+  }
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Converts color values on a background thread, chunk by chunk
+ *
+ * Buffer sizes are validated before the work starts. The conversion then runs
+ * in chunks of AsyncOptions::chunk_pixels; results are identical to
+ * psm::Convert. @p src and @p dst are referenced, not copied, and must stay
+ * alive and untouched until the returned future is ready.
+ *
+ * @tparam SrcFormat Source color space format
+ * @tparam DstFormat Destination color space format
+ * @param src Source range containing color values
+ * @param dst Destination range where converted values will be stored
+ * @param options Chunk size, progress callback and stop token
+ * @return Future holding true when the whole image was converted, or false if
+ * the stop token was triggered (@p dst is then only partially written)
+ *
+ * @throws std::invalid_argument if input buffer size is not a multiple of 3
+ * @throws std::invalid_argument if output buffer size doesn't match input buffer size
+ *
+ * @code
+ * std::stop_source stop;
+ * auto done = psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(
+ *     input, output,
+ *     {.on_progress = [](std::size_t done, std::size_t total) { ... },
+ *      .stop_token = stop.get_token()});
+ * // stop.request_stop() from any thread aborts after the current chunk
+ * @endcode
+ */
+template <typename SrcFormat, typename DstFormat,
+          std::ranges::contiguous_range SrcRange,
+          std::ranges::contiguous_range DstRange>
+std::future<bool> ConvertAsync(const SrcRange& src, DstRange& dst,
+                               AsyncOptions options = {}) {
+  using T = std::ranges::range_value_t<DstRange>;
+  const std::span<const std::ranges::range_value_t<SrcRange>> src_span{
+      src.data(), src.size()};
+  const std::span<T> dst_span{dst.data(), dst.size()};
+  detail::checkBufferSizes(src_span.size(), dst_span.size());
+
+  return std::async(
+      std::launch::async,
+      [src_span, dst_span, options = std::move(options)] {
+        return detail::ConvertChunked(
+            src_span, dst_span, options,
+            [](std::span<const T> src_chunk, std::span<T> dst_chunk) {
+              detail::ConvertImpl<SrcFormat, DstFormat>(src_chunk, dst_chunk);
+            });
+      });
+}
+
+}  // namespace psm
@@ -2,6 +2,8 @@
 #include <concepts>
 #include <span>
 
+#include "psm/pixel.hpp"
+
 namespace psm::detail {
 
 template <typename Tag>
@@ -14,6 +16,14 @@ concept ColorSpaceType = requires {
   { Tag::type::fromSRGB(src, dst) } -> std::same_as<void>;
 };
 
+template <typename Tag, typename T>
+concept PixelColorSpaceType =
+    ColorSpaceType<Tag> && requires(const Pixel<T>& pixel) {
+      // Single-pixel overloads used by ConvertPixel
+      { Tag::type::toSRGB(pixel) } -> std::same_as<Pixel<T>>;
+      { Tag::type::fromSRGB(pixel) } -> std::same_as<Pixel<T>>;
+    };
+
 template <typename Tag>
   requires ColorSpaceType<Tag>
 using ColorSpaceImpl = typename Tag::type;
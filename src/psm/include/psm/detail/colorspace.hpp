@@ -7,22 +7,24 @@ namespace psm::detail {
 /**
  * @brief Convert from sRGB color space to CIE XYZ color space
  * 
- * @param src Source RGB data in sRGB color space
- * @return Data in XYZ color space
+ * @param src Source RGB data in sRGB color space (one pixel per row)
+ * @return Product expression yielding the data in XYZ color space
  * 
  * @note This assumes the input is in linear space (not gamma-encoded)
+ * @note Assign with noalias() into a buffer that does not overlap @p src
  * @note If your input is in standard sRGB, you should first decode the gamma:
  * @code
- * auto linear_rgb = transform::srgb::decode<uint8_t>(input_data);
- * auto xyz = srgbToXyz(linear_rgb);
+ * linear_rgb = transform::srgb::decode(input_data);
+ * xyz.noalias() = srgbToXyz(linear_rgb);
  * @endcode
  */
-inline Mat3f srgbToXyz(const Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto srgbToXyz(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 0.4124564f, 0.3575761f, 0.1804375f,
-                   0.2126729f, 0.7151522f, 0.0721750f, 
-                   0.0193339f, 0.1191920f, 0.9503041f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      0.4124564f, 0.3575761f, 0.1804375f,
+      0.2126729f, 0.7151522f, 0.0721750f,
+      0.0193339f, 0.1191920f, 0.9503041f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
@@ -30,21 +32,23 @@ inline Mat3f srgbToXyz(const Mat3f& src) {
 /**
  * @brief Convert from CIE XYZ color space to sRGB color space
  * 
- * @param src Source data in XYZ color space
- * @return Data in linear RGB color space
+ * @param src Source data in XYZ color space (one pixel per row)
+ * @return Product expression yielding the data in linear RGB color space
  * 
+ * @note Assign with noalias() into a buffer that does not overlap @p src
  * @note This produces linear RGB values. To convert to standard sRGB, apply sRGB encoding:
  * @code
- * auto linear_rgb = xyzToSrgb(xyz_data);
- * auto srgb = transform::srgb::encode<float>(linear_rgb);
+ * linear_rgb.noalias() = xyzToSrgb(xyz_data);
+ * srgb = transform::srgb::encode(linear_rgb);
  * @endcode
  */
-inline Mat3f xyzToSrgb(const Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto xyzToSrgb(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 3.2404542f, -1.5371385f, -0.4985314f,
-                  -0.9692660f,  1.8760108f,  0.0415560f,
-                   0.0556434f, -0.2040259f,  1.0572252f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      3.2404542f, -1.5371385f, -0.4985314f,
+     -0.9692660f,  1.8760108f,  0.0415560f,
+      0.0556434f, -0.2040259f,  1.0572252f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
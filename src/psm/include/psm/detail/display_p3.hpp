@@ -2,6 +2,9 @@
 
 #include <span>
 
+#include "psm/detail/module_id.hpp"
+#include "psm/pixel.hpp"
+
 namespace psm {
 namespace detail {
 
@@ -13,11 +16,17 @@ class DisplayP3 {
   static void fromSRGB(std::span<const T> src, std::span<T> dst);
   template <typename T>
   static void toSRGB(std::span<const T> src, std::span<T> dst);
+
+  template <typename T>
+  static Pixel<T> fromSRGB(const Pixel<T>& src);
+  template <typename T>
+  static Pixel<T> toSRGB(const Pixel<T>& src);
 };
 }  // namespace detail
 
 struct DisplayP3 {
   using type = detail::DisplayP3;
+  static constexpr detail::ModuleId id = detail::ModuleId::DisplayP3;
 };
 
 }  // namespace psm
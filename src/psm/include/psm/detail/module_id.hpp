@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace psm::detail {
+
+/**
+ * @brief Numeric identity of a psm module, used to label instrumentation
+ *
+ * Color space tags expose their identity through a static @c id member.
+ * Tags without one (e.g. user supplied color spaces) report @c Other.
+ */
+enum class ModuleId : std::uint8_t {
+  sRGB,
+  AdobeRGB,
+  DisplayP3,
+  oRGB,
+  ProPhotoRGB,
+  AdjustChannels,
+  Other,
+  Count
+};
+
+/** @brief Numeric identity of a pixel sample type */
+enum class PixelTypeId : std::uint8_t { UInt8, UInt16, Other, Count };
+
+template <typename Tag>
+constexpr ModuleId moduleIdOf() {
+  if constexpr (requires { Tag::id; }) {
+    return Tag::id;
+  } else {
+    return ModuleId::Other;
+  }
+}
+
+template <typename T>
+constexpr PixelTypeId pixelTypeIdOf() {
+  if constexpr (std::is_same_v<T, std::uint8_t>) {
+    return PixelTypeId::UInt8;
+  } else if constexpr (std::is_same_v<T, std::uint16_t>) {
+    return PixelTypeId::UInt16;
+  } else {
+    return PixelTypeId::Other;
+  }
+}
+
+constexpr std::string_view toString(ModuleId id) {
+  switch (id) {
+    case ModuleId::sRGB:
+      return "sRGB";
+    case ModuleId::AdobeRGB:
+      return "AdobeRGB";
+    case ModuleId::DisplayP3:
+      return "DisplayP3";
+    case ModuleId::oRGB:
+      return "oRGB";
+    case ModuleId::ProPhotoRGB:
+      return "ProPhotoRGB";
+    case ModuleId::AdjustChannels:
+      return "AdjustChannels";
+    default:
+      return "Other";
+  }
+}
+
+constexpr std::string_view toString(PixelTypeId id) {
+  switch (id) {
+    case PixelTypeId::UInt8:
+      return "uint8";
+    case PixelTypeId::UInt16:
+      return "uint16";
+    default:
+      return "other";
+  }
+}
+
+}  // namespace psm::detail
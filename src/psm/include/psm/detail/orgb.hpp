@@ -1,6 +1,9 @@
 #pragma once
 #include <span>
 
+#include "psm/detail/module_id.hpp"
+#include "psm/pixel.hpp"
+
 namespace psm {
 
 namespace detail {
@@ -13,12 +16,18 @@ class Orgb {
   static void fromSRGB(std::span<const T> src, std::span<T> dst);
   template <typename T>
   static void toSRGB(std::span<const T> src, std::span<T> dst);
+
+  template <typename T>
+  static Pixel<T> fromSRGB(const Pixel<T>& src);
+  template <typename T>
+  static Pixel<T> toSRGB(const Pixel<T>& src);
 };
 
 }  // namespace detail
 
 struct oRGB {
   using type = detail::Orgb;
+  static constexpr detail::ModuleId id = detail::ModuleId::oRGB;
 };
 
 }  // namespace psm
@@ -86,6 +86,10 @@ auto denormalize_as(const Eigen::MatrixBase<Derived>& src) {
 /**
  * @namespace transform
  * @brief Contains color space transformation utility functions
+ *
+ * Transfer functions return lazy Eigen expressions so the result can be
+ * assigned straight into a destination buffer (including the source buffer
+ * itself) without allocating a temporary.
  */
 namespace transform {
 
@@ -100,12 +104,11 @@ namespace gamma {
  * @tparam Derived Eigen expression type
  * @param src Source data
  * @param gamma Gamma value (default: 2.2)
- * @return Gamma-encoded data (normalized 0.0-1.0)
+ * @return Gamma-encoded expression (normalized 0.0-1.0)
  */
 template <typename Derived>
-RowXf encode(const Eigen::MatrixBase<Derived>& src, float gamma = 2.2f) {
-  const RowXf normalized = src.template cast<float>();
-  return normalized.unaryExpr(
+auto encode(const Eigen::MatrixBase<Derived>& src, float gamma = 2.2f) {
+  return src.template cast<float>().unaryExpr(
       [gamma](float v) { return std::pow(v, 1.0f / gamma); });
 }
 
@@ -115,12 +118,12 @@ RowXf encode(const Eigen::MatrixBase<Derived>& src, float gamma = 2.2f) {
  * @tparam Derived Eigen expression type
  * @param src Source data
  * @param gamma Gamma value (default: 2.2)
- * @return Linear data (normalized 0.0-1.0)
+ * @return Linear expression (normalized 0.0-1.0)
  */
 template <typename Derived>
-RowXf decode(const Eigen::MatrixBase<Derived>& src, float gamma = 2.2f) {
-  const RowXf normalized = normalize_pixels(src);
-  return normalized.unaryExpr([gamma](float v) { return std::pow(v, gamma); });
+auto decode(const Eigen::MatrixBase<Derived>& src, float gamma = 2.2f) {
+  return normalize_pixels(src).unaryExpr(
+      [gamma](float v) { return std::pow(v, gamma); });
 }
 }  // namespace gamma
 
@@ -134,13 +137,11 @@ namespace srgb {
  *
  * @tparam Derived Eigen expression type
  * @param src Source data
- * @return sRGB encoded data (normalized 0.0-1.0)
+ * @return sRGB encoded expression (normalized 0.0-1.0)
  */
 template <typename Derived>
-RowXf encode(const Eigen::MatrixBase<Derived>& src) {
-  const RowXf normalized = src.template cast<float>();
-
-  return normalized.unaryExpr([](float value) {
+auto encode(const Eigen::MatrixBase<Derived>& src) {
+  return src.template cast<float>().unaryExpr([](float value) {
     return (value <= 0.0031308f)
                ? (12.92f * value)
                : ((1.055f * std::pow(value, 1.0f / 2.4f)) - 0.055f);
@@ -152,13 +153,11 @@ RowXf encode(const Eigen::MatrixBase<Derived>& src) {
  *
  * @tparam Derived Eigen expression type
  * @param src Source data
- * @return Linear data (normalized 0.0-1.0)
+ * @return Linear expression (normalized 0.0-1.0)
  */
 template <typename Derived>
-RowXf decode(const Eigen::MatrixBase<Derived>& src) {
-  const RowXf normalized = normalize_pixels(src);
-
-  return normalized.unaryExpr([](float value) {
+auto decode(const Eigen::MatrixBase<Derived>& src) {
+  return normalize_pixels(src).unaryExpr([](float value) {
     return (value <= 0.04045f) ? (value / 12.92f)
                                : std::pow((value + 0.055f) / 1.055f, 2.4f);
   });
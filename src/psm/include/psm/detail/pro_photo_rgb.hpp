@@ -2,6 +2,9 @@
 
 #include <span>
 
+#include "psm/detail/module_id.hpp"
+#include "psm/pixel.hpp"
+
 namespace psm {
 
 namespace detail {
@@ -14,12 +17,18 @@ class ProPhotoRgb {
   static void fromSRGB(std::span<const T> src, std::span<T> dst);
   template <typename T>
   static void toSRGB(std::span<const T> src, std::span<T> dst);
+
+  template <typename T>
+  static Pixel<T> fromSRGB(const Pixel<T>& src);
+  template <typename T>
+  static Pixel<T> toSRGB(const Pixel<T>& src);
 };
 
 }  // namespace detail
 
 struct ProPhotoRGB {
   using type = detail::ProPhotoRgb;
+  static constexpr detail::ModuleId id = detail::ModuleId::ProPhotoRGB;
 };
 
 }  // namespace psm
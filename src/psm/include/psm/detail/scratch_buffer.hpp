@@ -0,0 +1,31 @@
+#pragma once
+
+#include "psm/detail/tracked_buffer.hpp"
+#include "psm/detail/types.hpp"
+
+namespace psm::detail {
+
+/**
+ * @brief Float working buffer used by modules for intermediate results
+ *
+ * All heap memory a module needs while converting is taken through this type
+ * so that it is reported by psm::memory. Eigen expressions are evaluated into
+ * these buffers through the flat() and pixels() views instead of into
+ * temporaries.
+ */
+class ScratchBuffer : public TrackedBuffer<float> {
+ public:
+  using TrackedBuffer::TrackedBuffer;
+
+  /** @brief The buffer as one row of samples */
+  RowXfView flat() {
+    return {data(), static_cast<Eigen::Index>(size())};
+  }
+
+  /** @brief The buffer as one pixel per row with 3 channels */
+  Mat3fView pixels() {
+    return {data(), static_cast<Eigen::Index>(size() / 3), 3};
+  }
+};
+
+}  // namespace psm::detail
@@ -1,6 +1,9 @@
 #pragma once
 #include <span>
 
+#include "psm/detail/module_id.hpp"
+#include "psm/pixel.hpp"
+
 namespace psm {
 
 namespace detail {
@@ -20,12 +23,23 @@ class Srgb {
     // passthrough because we are already in sRGB
     std::copy(src.begin(), src.end(), dst.begin());
   }
+
+  template <typename T>
+  static constexpr Pixel<T> fromSRGB(const Pixel<T>& src) {
+    return src;
+  }
+
+  template <typename T>
+  static constexpr Pixel<T> toSRGB(const Pixel<T>& src) {
+    return src;
+  }
 };
 
 }  // namespace detail
 
 struct sRGB {
   using type = detail::Srgb;
+  static constexpr detail::ModuleId id = detail::ModuleId::sRGB;
 };
 
 }  // namespace psm
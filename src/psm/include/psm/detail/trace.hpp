@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * @file trace.hpp
+ * @brief Linux USDT (SystemTap SDT) probes on psm hot paths
+ *
+ * Probes are compiled in when psm is configured with -DENABLE_PSM_USDT=ON and
+ * <sys/sdt.h> is available. They need no runtime library: an unattached probe
+ * is a single nop, and tools such as bpftrace or perf attach to it in a live
+ * process. Otherwise PSM_TRACE expands to nothing and its arguments are not
+ * evaluated.
+ *
+ * All probes use the provider @c psm. Module and pixel type arguments are the
+ * numeric values of psm::detail::ModuleId and psm::detail::PixelTypeId.
+ *
+ * | Probe                               | Arguments                          |
+ * |-------------------------------------|------------------------------------|
+ * | convert_entry / convert_return      | src id, dst id, type id, pixels    |
+ * | to_srgb_entry / to_srgb_return      | module id, type id, pixels         |
+ * | from_srgb_entry / from_srgb_return  | module id, type id, pixels         |
+ * | adjust_entry / adjust_return        | type id, pixels                    |
+ * | load_image_entry                    | path, format                       |
+ * | load_image_return                   | path, type id, pixels              |
+ * | save_image_entry / save_image_return| path, type id, pixels              |
+ *
+ * @code
+ * bpftrace -e '
+ *   usdt:./psm_cli:psm:convert_entry { @start[tid] = nsecs; }
+ *   usdt:./psm_cli:psm:convert_return /@start[tid]/ {
+ *     @ns[arg0, arg1] = hist(nsecs - @start[tid]); delete(@start[tid]);
+ *   }'
+ * @endcode
+ */
+
+#if defined(PSM_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PSM_TRACE(probe, ...) STAP_PROBEV(psm, probe, __VA_ARGS__)
+#else
+#define PSM_TRACE(probe, ...) static_cast<void>(0)
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "psm/memory.hpp"
+
+namespace psm::detail {
+
+/**
+ * @brief Heap array whose size is reported by psm::memory
+ *
+ * Code that allocates working memory while converting takes it through this
+ * type, or through ScratchBuffer for float buffers with Eigen views, so that
+ * a ScopedTracker sees it. Elements are default-initialized, which leaves
+ * arithmetic types indeterminate. An empty buffer allocates nothing and is
+ * not counted.
+ *
+ * @tparam T Element type
+ */
+template <typename T>
+class TrackedBuffer {
+ public:
+  explicit TrackedBuffer(std::size_t size) : size_(size) {
+    if (size_ > 0) {
+      data_ = std::make_unique_for_overwrite<T[]>(size_);
+      memory::detail::recordAllocation(size_ * sizeof(T));
+    }
+  }
+
+  ~TrackedBuffer() {
+    if (size_ > 0) {
+      memory::detail::recordRelease(size_ * sizeof(T));
+    }
+  }
+
+  TrackedBuffer(const TrackedBuffer&) = delete;
+  TrackedBuffer& operator=(const TrackedBuffer&) = delete;
+
+  T* data() { return data_.get(); }
+  const T* data() const { return data_.get(); }
+  std::size_t size() const { return size_; }
+
+  T& operator[](std::size_t index) { return data_[index]; }
+  const T& operator[](std::size_t index) const { return data_[index]; }
+
+ private:
+  std::unique_ptr<T[]> data_;
+  std::size_t size_;
+};
+
+}  // namespace psm::detail
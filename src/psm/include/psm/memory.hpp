@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @namespace psm::memory
+ * @brief Heap usage reporting for the scratch buffers psm allocates while
+ * converting or adjusting images.
+ *
+ * Counters are kept both process-wide (see Snapshot()) and per thread, so a
+ * ScopedTracker placed around a single call reports exactly what that call
+ * allocated.
+ *
+ * @code
+ * psm::memory::ScopedTracker tracker;
+ * psm::Convert<psm::AdobeRGB, psm::sRGB>(input, output);
+ * const auto stats = tracker.stats();  // allocations, bytes, peak scratch
+ * @endcode
+ */
+namespace psm::memory {
+
+/**
+ * @brief Allocation counters for psm's internal scratch memory
+ */
+struct Stats {
+  std::size_t allocations = 0;      ///< Number of scratch buffers allocated
+  std::size_t bytes_allocated = 0;  ///< Sum of all scratch buffer sizes
+  std::size_t peak_bytes = 0;       ///< High-water mark of live scratch bytes
+};
+
+/**
+ * @brief Cumulative counters across all threads since start-up or Reset()
+ */
+Stats Snapshot();
+
+/**
+ * @brief Clears the cumulative counters
+ *
+ * The peak is reset to the amount of scratch currently alive.
+ */
+void Reset();
+
+/**
+ * @brief Measures the scratch memory used by the calling thread while the
+ * tracker is alive
+ *
+ * Trackers may be nested; an inner tracker does not hide allocations from an
+ * outer one.
+ */
+class ScopedTracker {
+ public:
+  ScopedTracker();
+  ~ScopedTracker();
+
+  ScopedTracker(const ScopedTracker&) = delete;
+  ScopedTracker& operator=(const ScopedTracker&) = delete;
+
+  /**
+   * @brief Counters accumulated on this thread since construction
+   *
+   * @c peak_bytes is relative to the scratch that was already alive when the
+   * tracker was created.
+   */
+  Stats stats() const;
+
+ private:
+  std::size_t start_allocations_;
+  std::size_t start_bytes_allocated_;
+  std::size_t start_live_bytes_;
+  std::size_t saved_peak_bytes_;
+};
+
+namespace detail {
+
+void recordAllocation(std::size_t bytes);
+void recordRelease(std::size_t bytes);
+
+}  // namespace detail
+
+}  // namespace psm::memory
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "psm/detail/module_id.hpp"
+
+/**
+ * @namespace psm::metrics
+ * @brief Optional performance counters for conversions and adjustments
+ *
+ * Counting is compiled out unless psm is configured with
+ * @c -DENABLE_PSM_METRICS=ON, which defines @c PSM_ENABLE_METRICS for psm and
+ * its consumers. When compiled out the API stays available and Collect()
+ * returns an all-zero snapshot.
+ *
+ * @code
+ * const auto snapshot = psm::metrics::Collect();
+ * const auto& c = snapshot.conversion(psm::metrics::Module::AdobeRGB,
+ *                                     psm::metrics::Module::sRGB,
+ *                                     psm::metrics::PixelType::UInt16);
+ * // c.calls, c.pixels, c.nanoseconds
+ * @endcode
+ */
+namespace psm::metrics {
+
+#ifdef PSM_ENABLE_METRICS
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+using Module = psm::detail::ModuleId;
+using PixelType = psm::detail::PixelTypeId;
+
+/** @brief Processing stage of a module */
+enum class Stage : std::uint8_t { ToSRGB, FromSRGB, Adjust, Count };
+
+inline constexpr std::size_t kModuleCount =
+    static_cast<std::size_t>(Module::Count);
+inline constexpr std::size_t kStageCount = static_cast<std::size_t>(Stage::Count);
+inline constexpr std::size_t kPixelTypeCount =
+    static_cast<std::size_t>(PixelType::Count);
+
+/** @brief Accumulated work for one counter slot */
+struct Counter {
+  std::uint64_t calls = 0;
+  std::uint64_t pixels = 0;
+  std::uint64_t nanoseconds = 0;  ///< Wall time spent inside the calls
+};
+
+/**
+ * @brief Point-in-time copy of all counters
+ */
+struct Snapshot {
+  template <std::size_t Outer, std::size_t Inner>
+  using Table = std::array<std::array<std::array<Counter, kPixelTypeCount>,
+                                      Inner>,
+                           Outer>;
+
+  /** Per module stage, e.g. AdobeRGB toSRGB on 16-bit data */
+  Table<kModuleCount, kStageCount> stages{};
+  /** Per Convert call, keyed by source and destination color space */
+  Table<kModuleCount, kModuleCount> conversions{};
+
+  const Counter& stage(Module module, Stage stage, PixelType type) const {
+    return stages[index(module)][index(stage)][index(type)];
+  }
+
+  const Counter& conversion(Module src, Module dst, PixelType type) const {
+    return conversions[index(src)][index(dst)][index(type)];
+  }
+
+ private:
+  template <typename Enum>
+  static constexpr std::size_t index(Enum value) {
+    return static_cast<std::size_t>(value);
+  }
+};
+
+/**
+ * @brief Copies the current process-wide counters
+ */
+Snapshot Collect();
+
+/**
+ * @brief Zeroes all counters
+ */
+void Reset();
+
+constexpr std::string_view toString(Stage stage) {
+  switch (stage) {
+    case Stage::ToSRGB:
+      return "toSRGB";
+    case Stage::FromSRGB:
+      return "fromSRGB";
+    case Stage::Adjust:
+      return "adjust";
+    default:
+      return "other";
+  }
+}
+
+using psm::detail::toString;
+
+namespace detail {
+
+void recordStage(Module module, Stage stage, PixelType type, std::size_t pixels,
+                 std::uint64_t nanoseconds);
+void recordConversion(Module src, Module dst, PixelType type,
+                      std::size_t pixels, std::uint64_t nanoseconds);
+
+inline std::uint64_t elapsedNanoseconds(
+    std::chrono::steady_clock::time_point start) {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+/**
+ * @brief Times its own lifetime and records it into a stage counter
+ *
+ * Reduces to an empty object when metrics are compiled out.
+ */
+class StageTimer {
+ public:
+#ifdef PSM_ENABLE_METRICS
+  StageTimer(Module module, Stage stage, PixelType type, std::size_t pixels)
+      : module_(module),
+        stage_(stage),
+        type_(type),
+        pixels_(pixels),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~StageTimer() {
+    recordStage(module_, stage_, type_, pixels_, elapsedNanoseconds(start_));
+  }
+#else
+  constexpr StageTimer(Module, Stage, PixelType, std::size_t) noexcept {}
+#endif
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+#ifdef PSM_ENABLE_METRICS
+ private:
+  Module module_;
+  Stage stage_;
+  PixelType type_;
+  std::size_t pixels_;
+  std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+/**
+ * @brief Times a whole source to destination conversion
+ *
+ * Reduces to an empty object when metrics are compiled out.
+ */
+class ConversionTimer {
+ public:
+#ifdef PSM_ENABLE_METRICS
+  ConversionTimer(Module src, Module dst, PixelType type, std::size_t pixels)
+      : src_(src),
+        dst_(dst),
+        type_(type),
+        pixels_(pixels),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~ConversionTimer() {
+    recordConversion(src_, dst_, type_, pixels_, elapsedNanoseconds(start_));
+  }
+#else
+  constexpr ConversionTimer(Module, Module, PixelType, std::size_t) noexcept {}
+#endif
+
+  ConversionTimer(const ConversionTimer&) = delete;
+  ConversionTimer& operator=(const ConversionTimer&) = delete;
+
+#ifdef PSM_ENABLE_METRICS
+ private:
+  Module src_;
+  Module dst_;
+  PixelType type_;
+  std::size_t pixels_;
+  std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+}  // namespace detail
+
+}  // namespace psm::metrics
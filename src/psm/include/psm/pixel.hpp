@@ -0,0 +1,16 @@
+#pragma once
+
+#include <array>
+
+namespace psm {
+
+/**
+ * @brief A single RGB pixel, stored in the same channel order as the
+ * interleaved buffers accepted by psm::Convert
+ *
+ * @tparam T Channel type (unsigned char or std::uint16_t)
+ */
+template <typename T>
+using Pixel = std::array<T, 3>;
+
+}  // namespace psm
@@ -18,28 +18,64 @@
 #endif
 
 #include "detail/color_space_concept.hpp"
+#include "detail/module_id.hpp"
 #include "detail/srgb.hpp"
+#include "detail/trace.hpp"
+#include "metrics.hpp"
+#include "pixel.hpp"
 
 namespace psm {
 
 namespace detail {
-template <ColorSpaceType SrcTag, ColorSpaceType DstTag, typename T>
-void ConvertImpl(std::span<const T> src, std::span<T> dst) {
-  if (src.size() % 3 != 0) {
+inline void checkBufferSizes(std::size_t src_size, std::size_t dst_size) {
+  if (src_size % 3 != 0) {
     throw std::invalid_argument("Input buffer size must be a multiple of 3");
   }
 
-  if (dst.size() != src.size()) {
+  if (dst_size != src_size) {
     throw std::invalid_argument(
         "Output buffer must be the same size as input buffer");
   }
+}
+
+template <ColorSpaceType SrcTag, ColorSpaceType DstTag, typename T>
+void ConvertImpl(std::span<const T> src, std::span<T> dst) {
+  checkBufferSizes(src.size(), dst.size());
 
   using SrcColorSpace = detail::ColorSpaceImpl<SrcTag>;
   using DstColorSpace = detail::ColorSpaceImpl<DstTag>;
 
-  SrcColorSpace::toSRGB(src, dst);
-  const std::span<const T> dst_view{dst.data(), dst.size()};
-  DstColorSpace::fromSRGB(dst_view, dst);
+  constexpr auto src_id = moduleIdOf<SrcTag>();
+  constexpr auto dst_id = moduleIdOf<DstTag>();
+  constexpr auto type_id = pixelTypeIdOf<T>();
+  const std::size_t pixels = src.size() / 3;
+  PSM_TRACE(convert_entry, static_cast<int>(src_id), static_cast<int>(dst_id),
+            static_cast<int>(type_id), pixels);
+  {
+    const metrics::detail::ConversionTimer conversion_timer(src_id, dst_id,
+                                                            type_id, pixels);
+    {
+      const metrics::detail::StageTimer timer(src_id, metrics::Stage::ToSRGB,
+                                              type_id, pixels);
+      PSM_TRACE(to_srgb_entry, static_cast<int>(src_id),
+                static_cast<int>(type_id), pixels);
+      SrcColorSpace::toSRGB(src, dst);
+      PSM_TRACE(to_srgb_return, static_cast<int>(src_id),
+                static_cast<int>(type_id), pixels);
+    }
+    const std::span<const T> dst_view{dst.data(), dst.size()};
+    {
+      const metrics::detail::StageTimer timer(
+          dst_id, metrics::Stage::FromSRGB, type_id, pixels);
+      PSM_TRACE(from_srgb_entry, static_cast<int>(dst_id),
+                static_cast<int>(type_id), pixels);
+      DstColorSpace::fromSRGB(dst_view, dst);
+      PSM_TRACE(from_srgb_return, static_cast<int>(dst_id),
+                static_cast<int>(type_id), pixels);
+    }
+  }
+  PSM_TRACE(convert_return, static_cast<int>(src_id), static_cast<int>(dst_id),
+            static_cast<int>(type_id), pixels);
 }
 }  // namespace detail
 
@@ -66,4 +102,47 @@ void Convert(const SrcRange& src, DstRange& dst) {
                                                             src.size()},
       std::span<std::ranges::range_value_t<DstRange>>{dst.data(), dst.size()});
 }
+
+/**
+ * @brief Converts a single pixel from source format to destination format
+ *
+ * Runs the same toSRGB/fromSRGB stages as Convert, including rounding the
+ * intermediate sRGB value to @p T, so the result is identical to converting a
+ * one-pixel buffer. The math is done in fixed-size vectors on the stack: no
+ * heap use, no buffer checks and nothing thrown, which suits per-pixel code
+ * such as color pickers and palette builders. Calls are not counted by
+ * psm::metrics and fire no trace probes.
+ *
+ * Usable in constant expressions when both formats are sRGB.
+ *
+ * @tparam SrcFormat Source color space format
+ * @tparam DstFormat Destination color space format
+ * @param pixel Source pixel
+ * @return The converted pixel
+ *
+ * @code
+ * const auto p3 = psm::ConvertPixel<psm::sRGB, psm::DisplayP3>(
+ *     psm::Pixel<std::uint8_t>{255, 128, 0});
+ * @endcode
+ */
+template <typename SrcFormat, typename DstFormat, typename T>
+  requires detail::PixelColorSpaceType<SrcFormat, T> &&
+           detail::PixelColorSpaceType<DstFormat, T>
+constexpr Pixel<T> ConvertPixel(const Pixel<T>& pixel) {
+  using SrcColorSpace = detail::ColorSpaceImpl<SrcFormat>;
+  using DstColorSpace = detail::ColorSpaceImpl<DstFormat>;
+  return DstColorSpace::fromSRGB(SrcColorSpace::toSRGB(pixel));
+}
+
+/**
+ * @brief Converts a single pixel given as separate channel values
+ *
+ * @see ConvertPixel(const Pixel<T>&)
+ */
+template <typename SrcFormat, typename DstFormat, typename T>
+  requires detail::PixelColorSpaceType<SrcFormat, T> &&
+           detail::PixelColorSpaceType<DstFormat, T>
+constexpr Pixel<T> ConvertPixel(T r, T g, T b) {
+  return ConvertPixel<SrcFormat, DstFormat>(Pixel<T>{r, g, b});
+}
 }  // namespace psm
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+
+#include "adjust_channels.hpp"
+#include "detail/tracked_buffer.hpp"
+#include "psm.hpp"
+
+namespace psm {
+
+namespace detail {
+
+// Pixels gathered per call of an RGBA band transform
+inline constexpr std::size_t kRGBABandPixels = 4096;
+
+inline void checkRGBABuffers(std::size_t src_size, std::size_t dst_size) {
+  if (src_size % 4 != 0) {
+    throw std::invalid_argument("Input buffer size must be a multiple of 4");
+  }
+
+  if (dst_size != src_size) {
+    throw std::invalid_argument(
+        "Output buffer must be the same size as input buffer");
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Applies an RGB transform to interleaved RGBA samples, passing alpha
+ * through unchanged
+ *
+ * The color channels of a band of pixels are gathered into a small RGB
+ * buffer, handed to @p fn, and written back next to the band's alpha while
+ * still in cache, so the image is traversed once with no separate split or
+ * merge pass and no image-sized intermediate. @p src and @p dst may be the
+ * same buffer.
+ *
+ * @param src Interleaved RGBA source samples
+ * @param dst Interleaved RGBA output, the same size as @p src
+ * @param fn Called as fn(std::span<const T> rgb_in, std::span<T> rgb_out)
+ * with the same number of RGB samples in both spans
+ *
+ * @throws std::invalid_argument if @p src is not whole RGBA pixels or
+ * @p dst differs in size
+ */
+template <typename T, typename Fn>
+  requires std::invocable<Fn&, std::span<const T>, std::span<T>>
+void TransformRGBA(std::span<const T> src, std::span<T> dst, Fn&& fn) {
+  detail::checkRGBABuffers(src.size(), dst.size());
+
+  const std::size_t pixels = src.size() / 4;
+  const std::size_t band_pixels = std::min(detail::kRGBABandPixels, pixels);
+  detail::TrackedBuffer<T> rgb_in(band_pixels * 3);
+  detail::TrackedBuffer<T> rgb_out(band_pixels * 3);
+
+  for (std::size_t first = 0; first < pixels; first += band_pixels) {
+    const std::size_t count = std::min(band_pixels, pixels - first);
+    const T* in = src.data() + first * 4;
+    T* out = dst.data() + first * 4;
+
+    for (std::size_t i = 0; i < count; ++i) {
+      rgb_in[i * 3 + 0] = in[i * 4 + 0];
+      rgb_in[i * 3 + 1] = in[i * 4 + 1];
+      rgb_in[i * 3 + 2] = in[i * 4 + 2];
+    }
+
+    fn(std::span<const T>{rgb_in.data(), count * 3},
+       std::span<T>{rgb_out.data(), count * 3});
+
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i * 4 + 0] = rgb_out[i * 3 + 0];
+      out[i * 4 + 1] = rgb_out[i * 3 + 1];
+      out[i * 4 + 2] = rgb_out[i * 3 + 2];
+      out[i * 4 + 3] = in[i * 4 + 3];
+    }
+  }
+}
+
+/**
+ * @brief Converts interleaved RGBA samples from source format to destination
+ * format, copying alpha unchanged
+ *
+ * Color channels give the same result as psm::Convert on the RGB samples.
+ *
+ * @tparam SrcFormat Source color space format
+ * @tparam DstFormat Destination color space format
+ * @param src Source range of RGBA samples
+ * @param dst Destination range, which may be @p src itself
+ *
+ * @throws std::invalid_argument if input buffer size is not a multiple of 4
+ * @throws std::invalid_argument if output buffer size doesn't match input
+ * buffer size
+ */
+template <typename SrcFormat, typename DstFormat,
+          std::ranges::contiguous_range SrcRange,
+          std::ranges::contiguous_range DstRange>
+void ConvertRGBA(const SrcRange& src, DstRange& dst) {
+  using T = std::ranges::range_value_t<DstRange>;
+  TransformRGBA<T>(
+      std::span<const T>{std::ranges::data(src), std::ranges::size(src)},
+      std::span<T>{std::ranges::data(dst), std::ranges::size(dst)},
+      [](std::span<const T> rgb_in, std::span<T> rgb_out) {
+        detail::ConvertImpl<SrcFormat, DstFormat>(rgb_in, rgb_out);
+      });
+}
+
+/**
+ * @brief Adjusts the color channels of interleaved RGBA samples in place,
+ * leaving alpha unchanged
+ *
+ * @see AdjustChannels
+ */
+template <std::ranges::contiguous_range Range>
+void AdjustChannelsRGBA(Range& buffer, const Percent& adjust_percentage) {
+  using T = std::ranges::range_value_t<Range>;
+  const std::span<T> samples{std::ranges::data(buffer),
+                             std::ranges::size(buffer)};
+  TransformRGBA<T>(samples, samples,
+                   [&](std::span<const T> rgb_in, std::span<T> rgb_out) {
+                     std::ranges::copy(rgb_in, rgb_out.begin());
+                     detail::AdjustChannelsImpl(rgb_out, adjust_percentage);
+                   });
+}
+
+}  // namespace psm
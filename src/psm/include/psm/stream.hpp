@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "psm.hpp"
+
+namespace psm {
+
+/**
+ * @brief Incremental converter for data that arrives a piece at a time
+ *
+ * Samples can be pushed in rows or arbitrarily sized chunks. Complete pixels
+ * are converted as soon as they are available; a trailing partial pixel is
+ * carried over to the next push. Output is identical to converting the whole
+ * concatenated input with psm::Convert, while memory stays bounded by the
+ * chunk size rather than the image size.
+ *
+ * @tparam SrcFormat Source color space format
+ * @tparam DstFormat Destination color space format
+ * @tparam T Sample type (unsigned char or std::uint16_t)
+ *
+ * @code
+ * psm::StreamConverter<psm::ProPhotoRGB, psm::sRGB, std::uint16_t> stream;
+ * while (decoder.readRow(row)) {
+ *   stream.push(row, [&](std::span<const std::uint16_t> converted) {
+ *     encoder.write(converted);
+ *   });
+ * }
+ * stream.finish();
+ * @endcode
+ */
+template <typename SrcFormat, typename DstFormat, typename T>
+class StreamConverter {
+ public:
+  /// Pixels converted per emitted chunk unless the constructor says otherwise
+  static constexpr std::size_t DefaultChunkPixels = 4096;
+
+  /**
+   * @param chunk_pixels Maximum number of pixels per chunk handed to a sink,
+   * which also bounds the converter's working memory
+   */
+  explicit StreamConverter(std::size_t chunk_pixels = DefaultChunkPixels)
+      : output_(std::max<std::size_t>(chunk_pixels, 1) * 3) {}
+
+  /**
+   * @brief Converts every complete pixel of @p input and passes the result to
+   * @p sink in chunks of at most chunk_pixels pixels
+   *
+   * The span handed to @p sink is only valid during the call.
+   */
+  template <typename Sink>
+    requires std::invocable<Sink&, std::span<const T>>
+  void push(std::span<const T> input, Sink&& sink) {
+    input = completeCarry(input);
+    if (carry_size_ == 3) {
+      emit(std::span<const T>{carry_}, sink);
+      carry_size_ = 0;
+    }
+    if (carry_size_ != 0) {
+      return;  // still short of a pixel, all of the input went to the carry
+    }
+
+    const std::size_t whole = input.size() - (input.size() % 3);
+    for (std::size_t offset = 0; offset < whole; offset += output_.size()) {
+      const std::size_t count = std::min(output_.size(), whole - offset);
+      emit(input.subspan(offset, count), sink);
+    }
+    carry(input.subspan(whole));
+  }
+
+  /**
+   * @brief Converts every complete pixel of @p input straight into @p output
+   *
+   * @return The written prefix of @p output, which holds pending() plus
+   * input.size() samples rounded down to whole pixels
+   *
+   * @throws std::invalid_argument if @p output is too small
+   */
+  std::span<T> push(std::span<const T> input, std::span<T> output) {
+    const std::size_t available = carry_size_ + input.size();
+    const std::size_t produced = available - (available % 3);
+    if (output.size() < produced) {
+      throw std::invalid_argument("Output buffer is too small for the input");
+    }
+
+    std::size_t written = 0;
+    input = completeCarry(input);
+    if (carry_size_ == 3) {
+      detail::ConvertImpl<SrcFormat, DstFormat>(std::span<const T>{carry_},
+                                                output.first(3));
+      carry_size_ = 0;
+      written = 3;
+    }
+    if (carry_size_ != 0) {
+      return output.first(0);
+    }
+
+    const std::size_t whole = input.size() - (input.size() % 3);
+    if (whole > 0) {
+      detail::ConvertImpl<SrcFormat, DstFormat>(input.first(whole),
+                                                output.subspan(written, whole));
+      written += whole;
+    }
+    carry(input.subspan(whole));
+    return output.first(written);
+  }
+
+  /**
+   * @brief Ends the stream
+   *
+   * @throws std::invalid_argument if a partial pixel is still pending
+   */
+  void finish() {
+    if (carry_size_ != 0) {
+      carry_size_ = 0;
+      throw std::invalid_argument("Input buffer size must be a multiple of 3");
+    }
+  }
+
+  /// Number of samples (0 to 2) of a partial pixel carried to the next push
+  std::size_t pending() const { return carry_size_; }
+
+  /// Drops any partial pixel so the converter can start a new stream
+  void reset() { carry_size_ = 0; }
+
+ private:
+  // Tops up a carried partial pixel from the front of @p input and returns
+  // the part of @p input that is left
+  std::span<const T> completeCarry(std::span<const T> input) {
+    if (carry_size_ == 0) {
+      return input;
+    }
+    const std::size_t take = std::min(3 - carry_size_, input.size());
+    std::copy_n(input.begin(), take, carry_.begin() + carry_size_);
+    carry_size_ += take;
+    return input.subspan(take);
+  }
+
+  void carry(std::span<const T> rest) {
+    std::copy(rest.begin(), rest.end(), carry_.begin());
+    carry_size_ = rest.size();
+  }
+
+  template <typename Sink>
+  void emit(std::span<const T> pixels, Sink& sink) {
+    const std::span<T> converted{output_.data(), pixels.size()};
+    detail::ConvertImpl<SrcFormat, DstFormat>(pixels, converted);
+    sink(std::span<const T>{converted});
+  }
+
+  std::vector<T> output_;
+  std::array<T, 3> carry_{};
+  std::size_t carry_size_ = 0;
+};
+
+}  // namespace psm
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "psm.hpp"
+
+/**
+ * @namespace psm::views
+ * @brief Lazy range adaptors over psm conversions
+ *
+ * psm::views::convert<Src, Dst> adapts either a range of psm::Pixel<T> or a
+ * random-access range of interleaved samples (three per pixel) into a view of
+ * converted psm::Pixel<T>. Each pixel is converted with psm::ConvertPixel only
+ * when it is dereferenced, so sampling pipelines touch just the pixels they
+ * keep:
+ *
+ * @code
+ * // Convert every 16th pixel of an interleaved 8-bit image
+ * for (const auto& p : image | psm::views::convert<psm::AdobeRGB, psm::sRGB> |
+ *                          std::views::stride(16)) {
+ *   histogram.add(p);
+ * }
+ * @endcode
+ */
+namespace psm::views {
+
+namespace detail {
+
+template <typename P>
+concept PixelValue = requires { typename P::value_type; } &&
+                     std::same_as<P, Pixel<typename P::value_type>>;
+
+template <typename R>
+concept PixelRange =
+    std::ranges::input_range<R> && PixelValue<std::ranges::range_value_t<R>>;
+
+// Samples are grouped into pixels by index, which needs random access and a
+// view that can be copied into the transform
+template <typename R>
+concept SampleRange =
+    std::ranges::random_access_range<R> && std::ranges::sized_range<R> &&
+    std::is_arithmetic_v<std::ranges::range_value_t<R>> &&
+    std::copy_constructible<std::views::all_t<R>>;
+
+template <typename SrcFormat, typename DstFormat>
+struct ConvertFn {
+  template <std::ranges::viewable_range R>
+    requires PixelRange<R>
+  constexpr auto operator()(R&& range) const {
+    using T = typename std::ranges::range_value_t<R>::value_type;
+    return std::views::transform(
+        std::forward<R>(range), [](const Pixel<T>& pixel) {
+          return psm::ConvertPixel<SrcFormat, DstFormat>(pixel);
+        });
+  }
+
+  template <std::ranges::viewable_range R>
+    requires SampleRange<R>
+  constexpr auto operator()(R&& range) const {
+    using T = std::ranges::range_value_t<R>;
+    auto samples = std::views::all(std::forward<R>(range));
+    const std::size_t size = std::ranges::size(samples);
+    if (size % 3 != 0) {
+      throw std::invalid_argument("Input buffer size must be a multiple of 3");
+    }
+
+    return std::views::iota(std::size_t{0}, size / 3) |
+           std::views::transform([samples](std::size_t i) {
+             const auto first = std::ranges::begin(samples) +
+                                static_cast<std::ptrdiff_t>(i * 3);
+             return psm::ConvertPixel<SrcFormat, DstFormat>(
+                 Pixel<T>{first[0], first[1], first[2]});
+           });
+  }
+
+  template <std::ranges::viewable_range R>
+    requires PixelRange<R> || SampleRange<R>
+  friend constexpr auto operator|(R&& range, const ConvertFn& fn) {
+    return fn(std::forward<R>(range));
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief Range adaptor converting each pixel from @p SrcFormat to
+ * @p DstFormat on dereference
+ *
+ * Usable as `psm::views::convert<Src, Dst>(range)` or
+ * `range | psm::views::convert<Src, Dst>`. The result is a view of
+ * psm::Pixel<T> values with the same traversal category as the input, so it
+ * composes with std::views::take, drop, filter, stride and the like.
+ *
+ * Interleaved sample ranges must be random access and sized, and are checked
+ * up front like psm::Convert.
+ *
+ * @throws std::invalid_argument if a sample range's size is not a multiple of 3
+ */
+template <typename SrcFormat, typename DstFormat>
+inline constexpr detail::ConvertFn<SrcFormat, DstFormat> convert{};
+
+}  // namespace psm::views
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "detail/tracked_buffer.hpp"
+#include "psm.hpp"
+
+namespace psm {
+
+/**
+ * @brief Planar 8-bit YCbCr image, as decoded from a JPEG before color
+ * conversion
+ *
+ * Samples use the full-range BT.601 coding of JFIF. The chroma planes may be
+ * subsampled by an integer factor in each direction (4:4:4, 4:2:2, 4:2:0,
+ * 4:4:0, 4:1:1, ...) and then hold ceil(width / subsample_x) by
+ * ceil(height / subsample_y) samples; both are empty for grayscale images.
+ * Rows may be padded, as TurboJPEG pads planes to whole MCUs.
+ */
+struct YCbCrPlanes {
+  std::span<const std::uint8_t> y = {};
+  std::span<const std::uint8_t> cb = {};  ///< Empty for grayscale
+  std::span<const std::uint8_t> cr = {};  ///< Empty for grayscale
+  std::size_t width = 0;          ///< Luma width, which is the image width
+  std::size_t height = 0;         ///< Luma height, which is the image height
+  std::size_t y_stride = 0;       ///< Samples per luma row, >= width
+  std::size_t chroma_stride = 0;  ///< Samples per chroma row
+  std::size_t subsample_x = 1;    ///< Luma columns per chroma column
+  std::size_t subsample_y = 1;    ///< Luma rows per chroma row
+
+  std::size_t chromaWidth() const {
+    return (width + subsample_x - 1) / subsample_x;
+  }
+  std::size_t chromaHeight() const {
+    return (height + subsample_y - 1) / subsample_y;
+  }
+};
+
+namespace detail {
+
+// Pixels converted per ConvertImpl call, rounded down to whole luma rows
+// (at least one)
+inline constexpr std::size_t kYCbCrBandPixels = 4096;
+
+inline void checkYCbCrPlanes(const YCbCrPlanes& planes, std::size_t dst_size) {
+  if (dst_size != planes.width * planes.height * 3) {
+    throw std::invalid_argument(
+        "Output buffer must hold width * height * 3 samples");
+  }
+  if (planes.width == 0 || planes.height == 0) {
+    return;
+  }
+  if (planes.y_stride < planes.width ||
+      planes.y.size() < (planes.height - 1) * planes.y_stride + planes.width) {
+    throw std::invalid_argument("Luma plane is smaller than width x height");
+  }
+
+  if (planes.cb.empty() && planes.cr.empty()) {
+    return;
+  }
+  if (planes.subsample_x == 0 || planes.subsample_y == 0 ||
+      planes.chroma_stride < planes.chromaWidth()) {
+    throw std::invalid_argument("Invalid chroma plane dimensions");
+  }
+  const std::size_t chroma_size =
+      (planes.chromaHeight() - 1) * planes.chroma_stride + planes.chromaWidth();
+  if (planes.cb.size() < chroma_size || planes.cr.size() < chroma_size) {
+    throw std::invalid_argument("Chroma plane is smaller than its dimensions");
+  }
+}
+
+// Source sample position and weight of the next sample for centered linear
+// upsampling by an integer factor, the "fancy upsampling" of libjpeg
+struct UpsampleTap {
+  std::size_t index0;
+  std::size_t index1;
+  float weight1;
+};
+
+inline UpsampleTap upsampleTap(std::size_t pos, std::size_t factor,
+                               std::size_t size) {
+  const float src =
+      (static_cast<float>(pos) + 0.5f) / static_cast<float>(factor) - 0.5f;
+  const float clamped = std::clamp(src, 0.0f, static_cast<float>(size - 1));
+  const auto index0 = static_cast<std::size_t>(clamped);
+  const std::size_t index1 = std::min(index0 + 1, size - 1);
+  return {index0, index1, clamped - static_cast<float>(index0)};
+}
+
+inline std::uint8_t clampSample(float value) {
+  return static_cast<std::uint8_t>(std::clamp(std::round(value), 0.0f, 255.0f));
+}
+
+// Writes rows [first_row, first_row + rows) as interleaved R'G'B'
+inline void ycbcrToRgbRows(const YCbCrPlanes& planes,
+                           std::span<const UpsampleTap> column_taps,
+                           std::size_t first_row, std::size_t rows,
+                           std::span<std::uint8_t> rgb) {
+  const bool has_chroma = !planes.cb.empty();
+
+  for (std::size_t row = 0; row < rows; ++row) {
+    const std::size_t y = first_row + row;
+    const std::uint8_t* luma = planes.y.data() + y * planes.y_stride;
+    std::uint8_t* out = rgb.data() + row * planes.width * 3;
+
+    if (!has_chroma) {
+      for (std::size_t x = 0; x < planes.width; ++x) {
+        out[x * 3 + 0] = luma[x];
+        out[x * 3 + 1] = luma[x];
+        out[x * 3 + 2] = luma[x];
+      }
+      continue;
+    }
+
+    const UpsampleTap row_tap =
+        upsampleTap(y, planes.subsample_y, planes.chromaHeight());
+    const std::size_t offset0 = row_tap.index0 * planes.chroma_stride;
+    const std::size_t offset1 = row_tap.index1 * planes.chroma_stride;
+    const float wy = row_tap.weight1;
+
+    auto chroma = [&](std::span<const std::uint8_t> plane,
+                      const UpsampleTap& tap) {
+      const float top = static_cast<float>(plane[offset0 + tap.index0]) +
+                        tap.weight1 *
+                            (static_cast<float>(plane[offset0 + tap.index1]) -
+                             static_cast<float>(plane[offset0 + tap.index0]));
+      const float bottom =
+          static_cast<float>(plane[offset1 + tap.index0]) +
+          tap.weight1 * (static_cast<float>(plane[offset1 + tap.index1]) -
+                         static_cast<float>(plane[offset1 + tap.index0]));
+      return top + wy * (bottom - top) - 128.0f;
+    };
+
+    for (std::size_t x = 0; x < planes.width; ++x) {
+      const UpsampleTap& tap = column_taps[x];
+      const float luma_value = static_cast<float>(luma[x]);
+      const float cb = chroma(planes.cb, tap);
+      const float cr = chroma(planes.cr, tap);
+
+      // JFIF YCbCr to R'G'B'
+      out[x * 3 + 0] = clampSample(luma_value + 1.402f * cr);
+      out[x * 3 + 1] =
+          clampSample(luma_value - 0.344136f * cb - 0.714136f * cr);
+      out[x * 3 + 2] = clampSample(luma_value + 1.772f * cb);
+    }
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Converts planar YCbCr straight to interleaved RGB in another color
+ * space
+ *
+ * Chroma upsampling and the YCbCr to R'G'B' transform are done a band of rows
+ * at a time into a small buffer, which is then converted from @p SrcFormat to
+ * @p DstFormat while still in cache. No full-size RGB intermediate is made.
+ * The result equals psm::Convert applied to the R'G'B' image, which can
+ * differ by a unit from a decoder's own color conversion since decoders
+ * round and upsample slightly differently.
+ *
+ * @tparam SrcFormat Color space of the RGB data encoded as YCbCr (sRGB for
+ * untagged JPEGs)
+ * @tparam DstFormat Destination color space format
+ * @param planes Source planes
+ * @param dst Output buffer of planes.width * planes.height * 3 samples
+ *
+ * @throws std::invalid_argument if @p dst or a plane has the wrong size
+ */
+template <typename SrcFormat, typename DstFormat>
+  requires detail::ColorSpaceType<SrcFormat> &&
+           detail::ColorSpaceType<DstFormat>
+void ConvertYCbCr(const YCbCrPlanes& planes, std::span<std::uint8_t> dst) {
+  detail::checkYCbCrPlanes(planes, dst.size());
+  if (dst.empty()) {
+    return;
+  }
+
+  // Grayscale has no chroma to upsample
+  detail::TrackedBuffer<detail::UpsampleTap> column_taps(
+      planes.cb.empty() ? 0 : planes.width);
+  for (std::size_t x = 0; x < column_taps.size(); ++x) {
+    column_taps[x] =
+        detail::upsampleTap(x, planes.subsample_x, planes.chromaWidth());
+  }
+
+  const std::size_t band_rows =
+      std::max<std::size_t>(detail::kYCbCrBandPixels / planes.width, 1);
+  detail::TrackedBuffer<std::uint8_t> band(std::min(band_rows, planes.height) *
+                                           planes.width * 3);
+
+  for (std::size_t row = 0; row < planes.height; row += band_rows) {
+    const std::size_t rows = std::min(band_rows, planes.height - row);
+    const std::size_t samples = rows * planes.width * 3;
+    const std::span<std::uint8_t> rgb{band.data(), samples};
+
+    detail::ycbcrToRgbRows(
+        planes, {column_taps.data(), column_taps.size()}, row, rows, rgb);
+    detail::ConvertImpl<SrcFormat, DstFormat>(
+        std::span<const std::uint8_t>{rgb},
+        dst.subspan(row * planes.width * 3, samples));
+  }
+}
+
+}  // namespace psm
@@ -6,6 +6,7 @@
 #include <numbers>
 
 #include "psm/detail/pixel_transformation.hpp"
+#include "psm/detail/scratch_buffer.hpp"
 #include "psm/detail/types.hpp"
 
 namespace {
@@ -29,79 +30,88 @@ float convertToOrgbangle(float theta) {
          ((4.0f / 3.0f) * (theta - std::numbers::pi_v<float> / 2));
 }
 
-psm::detail::Mat3f rgb2lcc(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto rgb2lcc(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 0.2990f, 0.5870f, 0.1140f,
-                   0.5000f, 0.5000f, -1.0000f,
-                   0.8660f, -0.8660f, 0.0000f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      0.2990f, 0.5870f, 0.1140f,
+      0.5000f, 0.5000f, -1.0000f,
+      0.8660f, -0.8660f, 0.0000f).finished();
   // clang-format on
   return src * transform_mat;
 }
 
-psm::detail::Mat3f lcc2rgb(const psm::detail::Mat3f& lcc) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto lcc2rgb(const Eigen::MatrixBase<Derived>& lcc) {
   // clang-format off
-  transform_mat << 1.0000f, 0.1140f, 0.7436f,
-                   1.0000f, 0.1140f, -0.4111f,
-                   1.0000f, -0.8660f, 0.1663f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      1.0000f, 0.1140f, 0.7436f,
+      1.0000f, 0.1140f, -0.4111f,
+      1.0000f, -0.8660f, 0.1663f).finished();
   // clang-format on
   return lcc * transform_mat;
 }
 
-psm::detail::Mat3f lcc2orgb(psm::detail::Mat3f lcc) {
-  psm::detail::Mat3f orgb(lcc.rows(), 3);
-
-  for (int i = 0; i < lcc.rows(); ++i) {
-    const float L = lcc(i, 0);
-    const float C1 = lcc(i, 1);
-    const float C2 = lcc(i, 2);
-
-    const float theta = std::atan2(C2, C1);
-    const float orgb_theta =
-        (theta > 0.0f) ? convertToRGBangle(theta) : -convertToRGBangle(-theta);
-    const float angle = orgb_theta - theta;
-
-    Eigen::Matrix2f rotation_matrix;
-    // clang-format off
-    rotation_matrix << std::cos(angle), -std::sin(angle),
-                      std::sin(angle), std::cos(angle);
-    // clang-format on
-    const Eigen::Vector2f C1C2(C1, C2);
-    const Eigen::Vector2f CybCrg = rotation_matrix * C1C2;
-    orgb(i, 0) = L;
-    orgb(i, 1) = CybCrg(0);
-    orgb(i, 2) = CybCrg(1);
+// Rotates the chroma of a single L, C1, C2 row in place; the row is read
+// before it is written so no separate output is needed
+template <typename Row>
+void lcc2orgbRow(Row&& lcc) {
+  const float L = lcc(0);
+  const float C1 = lcc(1);
+  const float C2 = lcc(2);
+
+  const float theta = std::atan2(C2, C1);
+  const float orgb_theta =
+      (theta > 0.0f) ? convertToRGBangle(theta) : -convertToRGBangle(-theta);
+  const float angle = orgb_theta - theta;
+
+  Eigen::Matrix2f rotation_matrix;
+  // clang-format off
+  rotation_matrix << std::cos(angle), -std::sin(angle),
+                    std::sin(angle), std::cos(angle);
+  // clang-format on
+  const Eigen::Vector2f C1C2(C1, C2);
+  const Eigen::Vector2f CybCrg = rotation_matrix * C1C2;
+  lcc(0) = L;
+  lcc(1) = CybCrg(0);
+  lcc(2) = CybCrg(1);
+}
+
+// Inverse of lcc2orgbRow, also applied in place
+template <typename Row>
+void orgb2lccRow(Row&& orgb) {
+  const float L = orgb(0);
+  const float Cyb = orgb(1);
+  const float Crg = orgb(2);
+
+  const float theta = std::atan2(Crg, Cyb);
+  const float rgb_theta = (theta > 0.0f) ? convertToOrgbangle(theta)
+                                         : -convertToOrgbangle(-theta);
+  const float angle = rgb_theta - theta;
+
+  Eigen::Matrix2f rotation_matrix;
+  // clang-format off
+  rotation_matrix << std::cos(angle), -std::sin(angle),
+                    std::sin(angle), std::cos(angle);
+  // clang-format on
+  const Eigen::Vector2f CybCrg(Cyb, Crg);
+  const Eigen::Vector2f C1C2 = rotation_matrix * CybCrg;
+
+  orgb(0) = L;
+  orgb(1) = C1C2(0);
+  orgb(2) = C1C2(1);
+}
+
+void lcc2orgb(psm::detail::Mat3fView lcc) {
+  for (Eigen::Index i = 0; i < lcc.rows(); ++i) {
+    lcc2orgbRow(lcc.row(i));
   }
-  return orgb;
 }
 
-psm::detail::Mat3f orgb2lcc(const psm::detail::Mat3f& orgb) {
-  psm::detail::Mat3f lcc(orgb.rows(), 3);
-
-  for (int i = 0; i < orgb.rows(); ++i) {
-    const float L = orgb(i, 0);
-    const float Cyb = orgb(i, 1);
-    const float Crg = orgb(i, 2);
-
-    const float theta = std::atan2(Crg, Cyb);
-    const float rgb_theta = (theta > 0.0f) ? convertToOrgbangle(theta)
-                                           : -convertToOrgbangle(-theta);
-    const float angle = rgb_theta - theta;
-
-    Eigen::Matrix2f rotation_matrix;
-    // clang-format off
-    rotation_matrix << std::cos(angle), -std::sin(angle),
-                      std::sin(angle), std::cos(angle);
-    // clang-format on
-    const Eigen::Vector2f CybCrg(Cyb, Crg);
-    const Eigen::Vector2f C1C2 = rotation_matrix * CybCrg;
-
-    lcc(i, 0) = L;
-    lcc(i, 1) = C1C2(0);
-    lcc(i, 2) = C1C2(1);
+void orgb2lcc(psm::detail::Mat3fView orgb) {
+  for (Eigen::Index i = 0; i < orgb.rows(); ++i) {
+    orgb2lccRow(orgb.row(i));
   }
-  return lcc;
 }
 }  // namespace
 
@@ -109,41 +119,81 @@ namespace psm::detail {
 template <typename T>
 void Orgb::fromSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = psm::detail::normalize_pixels(map_src);
 
   // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView norm_rgb(norm_src.data(), norm_src.cols() / 3,
-                                        3);
-  const psm::detail::Mat3f lcc = rgb2lcc(norm_rgb);
-  psm::detail::Mat3f orgb = lcc2orgb(lcc);
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer orgb(src.size());
+  rgb.flat() = psm::detail::normalize_pixels(map_src);
+  orgb.pixels().noalias() = rgb2lcc(rgb.pixels());
+  lcc2orgb(orgb.pixels());
+
   // map [-1, 2] to [0, 1] to preserve data when converting back to sRGB
-  psm::detail::Mat3f shifted_orgb =
-      ((orgb.array() + 1.0f) / 3.0f).min(1.0f).max(0.0f);
+  orgb.flat() =
+      ((orgb.flat().array() + 1.0f) / 3.0f).min(1.0f).max(0.0f).matrix();
 
-  const psm::detail::RowXfView result(
-      shifted_orgb.data(), shifted_orgb.cols() * shifted_orgb.rows());
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(orgb.flat());
 }
 
 template <typename T>
 void Orgb::toSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = psm::detail::normalize_pixels(map_src);
 
   // Assuming RGB/BGR as input for oRGB
-  psm::detail::Mat3fView norm_orgb(norm_src.data(), norm_src.cols() / 3, 3);
+  ScratchBuffer orgb(src.size());
+  ScratchBuffer rgb(src.size());
 
   // remap [0, 1] back to [-1, 2] to preserve data
-  const psm::detail::Mat3f unshifted_orgb =
-      ((norm_orgb.array() * 3.0f) - 1.0f).min(2.0f).max(-1.0f);
+  orgb.flat() =
+      ((psm::detail::normalize_pixels(map_src).array() * 3.0f) - 1.0f)
+          .min(2.0f)
+          .max(-1.0f)
+          .matrix();
 
-  const psm::detail::Mat3f lcc = orgb2lcc(unshifted_orgb);
-  psm::detail::Mat3f rgb = lcc2rgb(lcc);
+  orgb2lcc(orgb.pixels());
+  rgb.pixels().noalias() = lcc2rgb(orgb.pixels());
 
-  const psm::detail::RowXfView result(rgb.data(), rgb.cols() * rgb.rows());
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(rgb.flat());
+}
+
+// Single-pixel versions of the stages above, evaluated in fixed-size
+// vectors so they never touch the heap
+template <typename T>
+Pixel<T> Orgb::fromSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = psm::detail::normalize_pixels(map_src);
+  Eigen::RowVector3f orgb = rgb2lcc(rgb);
+  lcc2orgbRow(orgb);
+
+  // map [-1, 2] to [0, 1] to preserve data when converting back to sRGB
+  orgb = ((orgb.array() + 1.0f) / 3.0f).min(1.0f).max(0.0f).matrix();
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(orgb);
+  return dst;
+}
+
+template <typename T>
+Pixel<T> Orgb::toSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  // remap [0, 1] back to [-1, 2] to preserve data
+  Eigen::RowVector3f orgb =
+      ((psm::detail::normalize_pixels(map_src).array() * 3.0f) - 1.0f)
+          .min(2.0f)
+          .max(-1.0f)
+          .matrix();
+
+  orgb2lccRow(orgb);
+  const Eigen::RowVector3f rgb = lcc2rgb(orgb);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(rgb);
+  return dst;
 }
 
 template void Orgb::fromSRGB<unsigned char>(std::span<const unsigned char>,
@@ -155,4 +205,14 @@ template void Orgb::fromSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                             std::span<std::uint16_t>);
 template void Orgb::toSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                           std::span<std::uint16_t>);
+
+template Pixel<unsigned char> Orgb::fromSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+template Pixel<unsigned char> Orgb::toSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+
+template Pixel<std::uint16_t> Orgb::fromSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
+template Pixel<std::uint16_t> Orgb::toSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
 }  // namespace psm::detail
@@ -6,30 +6,68 @@
 
 #include "psm/detail/colorspace.hpp"
 #include "psm/detail/pixel_transformation.hpp"
+#include "psm/detail/scratch_buffer.hpp"
 #include "psm/detail/types.hpp"
 
 namespace {
 
-psm::detail::Mat3f xyz2pro_photo_rgb(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto xyz2pro_photo_rgb(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 1.3460f, -0.2556f, -0.0511f,
-                  -0.5446f,  1.5082f,  0.0205f,
-                   0.0f,     0.0f,     1.2123f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      1.3460f, -0.2556f, -0.0511f,
+     -0.5446f,  1.5082f,  0.0205f,
+      0.0f,     0.0f,     1.2123f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
 
-psm::detail::Mat3f pro_photo_rgb2xyz(const psm::detail::Mat3f& src) {
-  Eigen::Matrix3f transform_mat;
+template <typename Derived>
+auto pro_photo_rgb2xyz(const Eigen::MatrixBase<Derived>& src) {
   // clang-format off
-  transform_mat << 0.7974f,   0.1352f,   0.03131f,
-                   0.2880f,   0.7118f,   0.00008f,
-                   0.0f,      0.0f,      0.8251f;
+  static const Eigen::Matrix3f transform_mat = (Eigen::Matrix3f() <<
+      0.7974f,   0.1352f,   0.03131f,
+      0.2880f,   0.7118f,   0.00008f,
+      0.0f,      0.0f,      0.8251f).finished();
   // clang-format on
   return src * transform_mat.transpose();
 }
 
+// Bradford chromatic adaptation matrix from D65 to D50
+template <typename Derived>
+auto bradford_d65_to_d50(const Eigen::MatrixBase<Derived>& src) {
+  // clang-format off
+  static const Eigen::Matrix3f bradford = (Eigen::Matrix3f() <<
+      1.0478f, 0.0229f, -0.0501f,
+      0.0295f, 0.9904f, -0.0170f,
+     -0.0092f, 0.0150f,  0.7521f).finished();
+  // clang-format on
+  return src * bradford.transpose();
+}
+
+// Bradford chromatic adaptation matrix from D50 to D65 (inverse of D65->D50)
+template <typename Derived>
+auto bradford_d50_to_d65(const Eigen::MatrixBase<Derived>& src) {
+  // clang-format off
+  static const Eigen::Matrix3f bradford_inverse = (Eigen::Matrix3f() <<
+      0.9555766f, -0.0230393f, 0.0631636f,
+     -0.0282895f,  1.0099416f, 0.0210077f,
+      0.0122982f, -0.0204830f, 1.3299098f).finished();
+  // clang-format on
+  return src * bradford_inverse.transpose();
+}
+
+// ProPhoto RGB transfer function (linear to encoded)
+constexpr auto encode_pro_photo = [](float value) {
+  return (value < 1.0f / 512.0f) ? (16 * value)
+                                 : (std::pow(value, 1.0f / 1.8f));
+};
+
+// Inverse of encode_pro_photo (encoded to linear)
+constexpr auto decode_pro_photo = [](float value) {
+  return (value < 16.0f / 512.0f) ? (value / 16.0f) : (std::pow(value, 1.8f));
+};
+
 }  // namespace
 
 namespace psm::detail {
@@ -37,76 +75,73 @@ namespace psm::detail {
 template <typename T>
 void ProPhotoRgb::fromSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = transform::srgb::decode(map_src);
-
-  // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView norm_rgb(norm_src.data(), norm_src.cols() / 3,
-                                        3);
-  const psm::detail::Mat3f xyz65 = psm::detail::srgbToXyz(norm_rgb);
-
-  // Bradford chromatic adaptation matrix from D65 to D50
-  Eigen::Matrix3f bradford;
-  // clang-format off
-  bradford << 1.0478f, 0.0229f, -0.0501f,
-             0.0295f, 0.9904f, -0.0170f,
-            -0.0092f, 0.0150f,  0.7521f;
-  // clang-format on
-  const psm::detail::Mat3f xyz50 = xyz65 * bradford.transpose();
-
-  const psm::detail::Mat3f pro_photo_rgb = xyz2pro_photo_rgb(xyz50);
 
-  const Eigen::Map<const psm::detail::RowXf> pro_photo_rgb_row(
-      pro_photo_rgb.data(), pro_photo_rgb.rows() * pro_photo_rgb.cols());
+  // Assuming RGB/BGR as input. The two scratch buffers are used alternately
+  // as source and destination of each matrix stage.
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() = transform::srgb::decode(map_src);
+  xyz.pixels().noalias() = psm::detail::srgbToXyz(rgb.pixels());
+  rgb.pixels().noalias() = bradford_d65_to_d50(xyz.pixels());
+  xyz.pixels().noalias() = xyz2pro_photo_rgb(rgb.pixels());
 
-  psm::detail::RowXf encoded_pro_photo_rgb =
-      pro_photo_rgb_row.unaryExpr([](float value) {
-        return (value < 1.0f / 512.0f) ? (16 * value)
-                                       : (std::pow(value, 1.0f / 1.8f));
-      });
-
-  const psm::detail::Mat3fView result(encoded_pro_photo_rgb.data(),
-                                      encoded_pro_photo_rgb.size() / 3, 3);
+  xyz.flat() = xyz.flat().unaryExpr(encode_pro_photo);
 
   Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+  dst_map = psm::detail::denormalize_as<T>(xyz.flat());
 }
 
 template <typename T>
 void ProPhotoRgb::toSRGB(std::span<const T> src, std::span<T> dst) {
   const Eigen::Map<const Eigen::RowVectorX<T>> map_src(src.data(), src.size());
-  psm::detail::RowXf norm_src = psm::detail::normalize_pixels(map_src);
-
-  psm::detail::RowXf decoded_pro_photo = norm_src.unaryExpr([](float value) {
-    return (value < 16.0f / 512.0f) ? (value / 16.0f) : (std::pow(value, 1.8f));
-  });
-
-  // Assuming RGB/BGR as input
-  const psm::detail::Mat3fView pro_photo_rgb(decoded_pro_photo.data(),
-                                             decoded_pro_photo.cols() / 3, 3);
-
-  const psm::detail::Mat3f xyz50 = pro_photo_rgb2xyz(pro_photo_rgb);
 
-  // Bradford chromatic adaptation matrix from D50 to D65 (inverse of D65->D50)
-  Eigen::Matrix3f bradford_inverse;
-  // clang-format off
-  bradford_inverse << 0.9555766, -0.0230393, 0.0631636,
-                     -0.0282895,  1.0099416, 0.0210077,
-                      0.0122982, -0.0204830, 1.3299098;
-  // clang-format on
+  // Assuming RGB/BGR as input. The two scratch buffers are used alternately
+  // as source and destination of each matrix stage.
+  ScratchBuffer rgb(src.size());
+  ScratchBuffer xyz(src.size());
+  rgb.flat() =
+      psm::detail::normalize_pixels(map_src).unaryExpr(decode_pro_photo);
 
-  const psm::detail::Mat3f xyz65 = xyz50 * bradford_inverse.transpose();
+  xyz.pixels().noalias() = pro_photo_rgb2xyz(rgb.pixels());
+  rgb.pixels().noalias() = bradford_d50_to_d65(xyz.pixels());
+  xyz.pixels().noalias() = psm::detail::xyzToSrgb(rgb.pixels());
+  xyz.flat() = transform::srgb::encode(xyz.flat());
 
-  const psm::detail::Mat3f srgb = psm::detail::xyzToSrgb(xyz65);
-
-  const Eigen::Map<const psm::detail::RowXf> srgb_row(
-      srgb.data(), srgb.rows() * srgb.cols());
-  psm::detail::RowXf encoded_srgb = transform::srgb::encode(srgb_row);
+  Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
+  dst_map = psm::detail::denormalize_as<T>(xyz.flat());
+}
 
-  const psm::detail::Mat3fView result(encoded_srgb.data(),
-                                      encoded_srgb.size() / 3, 3);
+// Single-pixel versions of the stages above, evaluated in fixed-size
+// vectors so they never touch the heap
+template <typename T>
+Pixel<T> ProPhotoRgb::fromSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb = transform::srgb::decode(map_src);
+  const Eigen::RowVector3f xyz_d65 = psm::detail::srgbToXyz(rgb);
+  const Eigen::RowVector3f xyz_d50 = bradford_d65_to_d50(xyz_d65);
+  const Eigen::RowVector3f linear = xyz2pro_photo_rgb(xyz_d50);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(linear.unaryExpr(encode_pro_photo));
+  return dst;
+}
 
-  Eigen::Map<Eigen::RowVectorX<T>> dst_map(dst.data(), dst.size());
-  dst_map = psm::detail::denormalize_as<T>(result);
+template <typename T>
+Pixel<T> ProPhotoRgb::toSRGB(const Pixel<T>& src) {
+  const Eigen::Map<const Eigen::RowVector3<T>> map_src(src.data());
+
+  const Eigen::RowVector3f rgb =
+      psm::detail::normalize_pixels(map_src).unaryExpr(decode_pro_photo);
+  const Eigen::RowVector3f xyz_d50 = pro_photo_rgb2xyz(rgb);
+  const Eigen::RowVector3f xyz_d65 = bradford_d50_to_d65(xyz_d50);
+  const Eigen::RowVector3f linear = psm::detail::xyzToSrgb(xyz_d65);
+
+  Pixel<T> dst;
+  Eigen::Map<Eigen::RowVector3<T>>(dst.data()) =
+      psm::detail::denormalize_as<T>(transform::srgb::encode(linear));
+  return dst;
 }
 
 template void ProPhotoRgb::fromSRGB<unsigned char>(
@@ -118,4 +153,14 @@ template void ProPhotoRgb::fromSRGB<std::uint16_t>(
     std::span<const std::uint16_t>, std::span<std::uint16_t>);
 template void ProPhotoRgb::toSRGB<std::uint16_t>(std::span<const std::uint16_t>,
                                                  std::span<std::uint16_t>);
+
+template Pixel<unsigned char> ProPhotoRgb::fromSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+template Pixel<unsigned char> ProPhotoRgb::toSRGB<unsigned char>(
+    const Pixel<unsigned char>&);
+
+template Pixel<std::uint16_t> ProPhotoRgb::fromSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
+template Pixel<std::uint16_t> ProPhotoRgb::toSRGB<std::uint16_t>(
+    const Pixel<std::uint16_t>&);
 }  // namespace psm::detail
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "AppState.hpp"
+
+namespace psm_test::full_decode {
+
+using psm_gui::AppState;
+using namespace std::chrono_literals;
+
+// Stands in for a large decode: runs until stopped, checking between rows
+AppState::FullDecode::Decoder slowDecode(std::atomic<bool>& stopped) {
+  return [&stopped](std::stop_token stop) {
+    while (!stop.stop_requested()) {
+      std::this_thread::sleep_for(1ms);
+    }
+    stopped = true;
+    return AppState::FullDecode::Result{};
+  };
+}
+
+AppState::FullDecode::Decoder quickDecode() {
+  return [](std::stop_token) {
+    return AppState::FullDecode::Result{
+        .data = std::vector<std::uint8_t>(2 * 3 * 3, 7),
+        .width = 2,
+        .height = 3};
+  };
+}
+
+TEST(FullDecodeTest, StartDoesNotWaitForPendingDecode) {
+  AppState::FullDecode full_decode;
+  std::atomic<bool> stopped = false;
+  full_decode.start(slowDecode(stopped));
+
+  const auto begin = std::chrono::steady_clock::now();
+  full_decode.start(quickDecode());
+  EXPECT_LT(std::chrono::steady_clock::now() - begin, 1s);
+
+  const auto result = full_decode.pending.get();
+  EXPECT_EQ(result.width, 2);
+  EXPECT_EQ(result.height, 3);
+
+  // The abandoned decode was asked to stop, and is dropped once it has
+  while (!full_decode.retired.empty()) {
+    full_decode.reap();
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_TRUE(stopped);
+}
+
+TEST(FullDecodeTest, AbandonStopsPendingDecode) {
+  AppState state;
+  std::atomic<bool> stopped = false;
+  state.full_decode.start(slowDecode(stopped));
+  ASSERT_TRUE(state.full_decode.isRunning());
+
+  state.reset();
+
+  EXPECT_FALSE(state.full_decode.isRunning());
+  ASSERT_EQ(state.full_decode.retired.size(), 1u);
+  EXPECT_EQ(state.full_decode.retired.front().wait_for(10s),
+            std::future_status::ready);
+  EXPECT_TRUE(stopped);
+}
+
+TEST(FullDecodeTest, DestructionStopsPendingDecode) {
+  std::atomic<bool> stopped = false;
+  {
+    AppState::FullDecode full_decode;
+    full_decode.start(slowDecode(stopped));
+  }
+  EXPECT_TRUE(stopped);
+}
+
+}  // namespace psm_test::full_decode
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <stop_token>
+#include <vector>
+
+#include "psm/async.hpp"
+#include "psm/psm.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::async {
+
+class AsyncTest : public ::testing::Test {
+ protected:
+  static constexpr std::size_t PixelCount = 10000;
+
+  void SetUp() override {
+    src.resize(PixelCount * 3);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+      src[i] = static_cast<std::uint16_t>(i * 37);
+    }
+    expected.resize(src.size());
+    psm::Convert<psm::ProPhotoRGB, psm::sRGB>(src, expected);
+  }
+
+  std::vector<std::uint16_t> src;
+  std::vector<std::uint16_t> expected;
+};
+
+TEST_F(AsyncTest, MatchesSynchronousConvert) {
+  std::vector<std::uint16_t> dst(src.size());
+
+  auto done = psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(
+      src, dst, {.chunk_pixels = 999});
+
+  EXPECT_TRUE(done.get());
+  EXPECT_EQ(dst, expected);
+}
+
+TEST_F(AsyncTest, ReportsProgressPerChunk) {
+  std::vector<std::uint16_t> dst(src.size());
+  std::vector<std::size_t> reported;
+
+  auto done = psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(
+      src, dst,
+      {.chunk_pixels = 4000,
+       .on_progress = [&](std::size_t done_pixels, std::size_t total) {
+         EXPECT_EQ(total, PixelCount);
+         reported.push_back(done_pixels);
+       }});
+
+  ASSERT_TRUE(done.get());
+  EXPECT_EQ(reported, (std::vector<std::size_t>{4000, 8000, 10000}));
+}
+
+TEST_F(AsyncTest, StopsBetweenChunks) {
+  std::vector<std::uint16_t> dst(src.size(), 0);
+  std::stop_source stop;
+  std::size_t chunks = 0;
+
+  auto done = psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(
+      src, dst,
+      {.chunk_pixels = 1000,
+       .on_progress =
+           [&](std::size_t, std::size_t) {
+             if (++chunks == 2) {
+               stop.request_stop();
+             }
+           },
+       .stop_token = stop.get_token()});
+
+  EXPECT_FALSE(done.get());
+  EXPECT_EQ(chunks, 2u);
+  EXPECT_TRUE(
+      std::equal(dst.begin(), dst.begin() + 2000 * 3, expected.begin()));
+  EXPECT_EQ(dst[2000 * 3], 0);
+}
+
+TEST_F(AsyncTest, StopRequestedBeforeStartConvertsNothing) {
+  std::vector<std::uint16_t> dst(src.size(), 0);
+  std::stop_source stop;
+  stop.request_stop();
+
+  auto done = psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(
+      src, dst, {.stop_token = stop.get_token()});
+
+  EXPECT_FALSE(done.get());
+  EXPECT_EQ(dst, std::vector<std::uint16_t>(src.size(), 0));
+}
+
+TEST_F(AsyncTest, ChunksBoundScratchMemory) {
+  std::vector<std::uint16_t> dst(src.size());
+
+  const auto stats = ScratchUsage([&] {
+    psm::detail::ConvertChunked(
+        std::span<const std::uint16_t>{src}, std::span<std::uint16_t>{dst},
+        {.chunk_pixels = 100}, [](auto src_chunk, auto dst_chunk) {
+          psm::detail::ConvertImpl<psm::ProPhotoRGB, psm::sRGB>(src_chunk,
+                                                                 dst_chunk);
+        });
+  });
+
+  EXPECT_LE(stats.peak_bytes, 2 * 100 * 3 * sizeof(float));
+}
+
+TEST_F(AsyncTest, InvalidBufferSizeThrowsImmediately) {
+  std::vector<std::uint16_t> dst(src.size() - 3);
+
+  EXPECT_THROW(
+      (psm::ConvertAsync<psm::ProPhotoRGB, psm::sRGB>(src, dst)),
+      std::invalid_argument);
+}
+
+}  // namespace psm_test::async
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "psm/psm.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::convert_pixel {
+
+// Every channel combination on a regular grid, as one interleaved buffer
+template <typename T>
+std::vector<T> GridImage(unsigned step) {
+  std::vector<T> image;
+  const unsigned max = std::numeric_limits<T>::max();
+  for (unsigned r = 0; r <= max; r += step) {
+    for (unsigned g = 0; g <= max; g += step) {
+      for (unsigned b = 0; b <= max; b += step) {
+        image.push_back(static_cast<T>(r));
+        image.push_back(static_cast<T>(g));
+        image.push_back(static_cast<T>(b));
+      }
+    }
+  }
+  return image;
+}
+
+template <typename Src, typename Dst, typename T>
+void ExpectMatchesBulk(const std::vector<T>& src) {
+  std::vector<T> bulk(src.size());
+  psm::Convert<Src, Dst>(src, bulk);
+
+  for (std::size_t i = 0; i < src.size(); i += 3) {
+    const auto pixel =
+        psm::ConvertPixel<Src, Dst>(src[i], src[i + 1], src[i + 2]);
+    ASSERT_EQ(pixel, (psm::Pixel<T>{bulk[i], bulk[i + 1], bulk[i + 2]}))
+        << "pixel " << i / 3 << " (" << +src[i] << ", " << +src[i + 1]
+        << ", " << +src[i + 2] << ")";
+  }
+}
+
+template <typename Src, typename T>
+void ExpectMatchesBulkToAll(const std::vector<T>& src) {
+  ExpectMatchesBulk<Src, psm::sRGB>(src);
+  ExpectMatchesBulk<Src, psm::AdobeRGB>(src);
+  ExpectMatchesBulk<Src, psm::DisplayP3>(src);
+  ExpectMatchesBulk<Src, psm::oRGB>(src);
+  ExpectMatchesBulk<Src, psm::ProPhotoRGB>(src);
+}
+
+template <typename T>
+void ExpectAllPairsMatchBulk(unsigned step) {
+  const auto src = GridImage<T>(step);
+  ExpectMatchesBulkToAll<psm::sRGB>(src);
+  ExpectMatchesBulkToAll<psm::AdobeRGB>(src);
+  ExpectMatchesBulkToAll<psm::DisplayP3>(src);
+  ExpectMatchesBulkToAll<psm::oRGB>(src);
+  ExpectMatchesBulkToAll<psm::ProPhotoRGB>(src);
+}
+
+TEST(ConvertPixelTest, EightBitMatchesBulkConversion) {
+  ExpectAllPairsMatchBulk<unsigned char>(15);
+}
+
+TEST(ConvertPixelTest, SixteenBitMatchesBulkConversion) {
+  ExpectAllPairsMatchBulk<std::uint16_t>(4369);
+}
+
+TEST(ConvertPixelTest, PixelAndChannelOverloadsAgree) {
+  const psm::Pixel<unsigned char> pixel{200, 100, 50};
+  EXPECT_EQ((psm::ConvertPixel<psm::AdobeRGB, psm::DisplayP3>(pixel)),
+            (psm::ConvertPixel<psm::AdobeRGB, psm::DisplayP3>(
+                pixel[0], pixel[1], pixel[2])));
+}
+
+TEST(ConvertPixelTest, DoesNotAllocateScratch) {
+  const auto stats = ScratchUsage([] {
+    for (unsigned v = 0; v < 256; ++v) {
+      const auto c = static_cast<unsigned char>(v);
+      static_cast<void>(
+          psm::ConvertPixel<psm::ProPhotoRGB, psm::oRGB>(c, c, c));
+    }
+  });
+
+  EXPECT_EQ(stats.allocations, 0);
+}
+
+TEST(ConvertPixelTest, SrgbPassthroughIsConstexpr) {
+  constexpr psm::Pixel<unsigned char> pixel{1, 2, 3};
+  static_assert(psm::ConvertPixel<psm::sRGB, psm::sRGB>(pixel) == pixel);
+}
+
+}  // namespace psm_test::convert_pixel
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "psm/memory.hpp"
+#include "psm/psm.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::memory {
+
+class MemoryTest : public ::testing::Test {
+ protected:
+  static constexpr std::size_t Width4K = 3840;
+  static constexpr std::size_t Height4K = 2160;
+  static constexpr std::size_t Samples4K = Width4K * Height4K * 3;
+
+  // Each module stage may hold two float working buffers of the image size
+  static constexpr std::size_t MaxStageBytes = 2 * Samples4K * sizeof(float);
+};
+
+TEST_F(MemoryTest, SrgbPassthroughDoesNotAllocate) {
+  const std::vector<unsigned char> src(300, 128);
+  std::vector<unsigned char> dst(src.size());
+
+  const auto stats =
+      ScratchUsage([&] { psm::Convert<psm::sRGB, psm::sRGB>(src, dst); });
+
+  EXPECT_EQ(stats.allocations, 0);
+  EXPECT_EQ(stats.bytes_allocated, 0);
+  EXPECT_EQ(stats.peak_bytes, 0);
+}
+
+TEST_F(MemoryTest, AdobeToSrgbOn4KImageIsBounded) {
+  const std::vector<unsigned char> src(Samples4K, 100);
+  std::vector<unsigned char> dst(src.size());
+
+  const auto stats =
+      ScratchUsage([&] { psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst); });
+
+  EXPECT_LE(stats.allocations, 2);
+  EXPECT_LE(stats.peak_bytes, MaxStageBytes);
+  EXPECT_GE(stats.bytes_allocated, stats.peak_bytes);
+}
+
+TEST_F(MemoryTest, SixteenBitAdobeToSrgbOn4KImageIsBounded) {
+  const std::vector<std::uint16_t> src(Samples4K, 30000);
+  std::vector<std::uint16_t> dst(src.size());
+
+  const auto stats =
+      ScratchUsage([&] { psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst); });
+
+  EXPECT_LE(stats.allocations, 2);
+  EXPECT_LE(stats.peak_bytes, MaxStageBytes);
+}
+
+TEST_F(MemoryTest, ScratchIsReleasedAfterEachStage) {
+  const std::vector<unsigned char> src(3000, 100);
+  std::vector<unsigned char> dst(src.size());
+
+  const auto stats = ScratchUsage(
+      [&] { psm::Convert<psm::AdobeRGB, psm::AdobeRGB>(src, dst); });
+
+  // Both stages allocate, but never at the same time
+  EXPECT_EQ(stats.allocations, 4);
+  EXPECT_EQ(stats.bytes_allocated, 2 * stats.peak_bytes);
+}
+
+TEST_F(MemoryTest, NestedTrackersReportOwnUsage) {
+  const std::vector<unsigned char> src(300, 100);
+  std::vector<unsigned char> dst(src.size());
+
+  psm::memory::Stats inner;
+  const auto outer = ScratchUsage([&] {
+    psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+    inner =
+        ScratchUsage([&] { psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst); });
+  });
+
+  EXPECT_EQ(outer.allocations, 2 * inner.allocations);
+  EXPECT_EQ(outer.peak_bytes, inner.peak_bytes);
+}
+
+TEST_F(MemoryTest, SnapshotAccumulatesUntilReset) {
+  const std::vector<unsigned char> src(300, 100);
+  std::vector<unsigned char> dst(src.size());
+
+  psm::memory::Reset();
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+
+  const auto cumulative = psm::memory::Snapshot();
+  EXPECT_EQ(cumulative.allocations, 4);
+  EXPECT_EQ(cumulative.bytes_allocated, 4 * src.size() * sizeof(float));
+  EXPECT_EQ(cumulative.peak_bytes, 2 * src.size() * sizeof(float));
+
+  psm::memory::Reset();
+  EXPECT_EQ(psm::memory::Snapshot().allocations, 0);
+  EXPECT_EQ(psm::memory::Snapshot().peak_bytes, 0);
+}
+
+}  // namespace psm_test::memory
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "psm/metrics.hpp"
+#include "psm/psm.hpp"
+
+namespace psm_test::metrics {
+
+using psm::metrics::Module;
+using psm::metrics::PixelType;
+using psm::metrics::Stage;
+
+class MetricsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { psm::metrics::Reset(); }
+
+  std::vector<unsigned char> src = std::vector<unsigned char>(300, 100);
+  std::vector<unsigned char> dst = std::vector<unsigned char>(300);
+};
+
+TEST_F(MetricsTest, CountsConversionPairs) {
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+
+  const auto snapshot = psm::metrics::Collect();
+  const auto& pair =
+      snapshot.conversion(Module::AdobeRGB, Module::sRGB, PixelType::UInt8);
+  const auto& reverse =
+      snapshot.conversion(Module::sRGB, Module::AdobeRGB, PixelType::UInt8);
+
+  if constexpr (psm::metrics::kEnabled) {
+    EXPECT_EQ(pair.calls, 2);
+    EXPECT_EQ(pair.pixels, 200);
+    EXPECT_GT(pair.nanoseconds, 0);
+  } else {
+    EXPECT_EQ(pair.calls, 0);
+    EXPECT_EQ(pair.pixels, 0);
+  }
+  EXPECT_EQ(reverse.calls, 0);
+}
+
+TEST_F(MetricsTest, CountsStagesPerModuleAndPixelType) {
+  const std::vector<std::uint16_t> src16(30, 1000);
+  std::vector<std::uint16_t> dst16(src16.size());
+
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+  psm::Convert<psm::sRGB, psm::AdobeRGB>(src16, dst16);
+
+  const auto snapshot = psm::metrics::Collect();
+  const auto& to_srgb =
+      snapshot.stage(Module::AdobeRGB, Stage::ToSRGB, PixelType::UInt8);
+  const auto& from_srgb =
+      snapshot.stage(Module::AdobeRGB, Stage::FromSRGB, PixelType::UInt16);
+  const auto& unused =
+      snapshot.stage(Module::AdobeRGB, Stage::FromSRGB, PixelType::UInt8);
+
+  const std::uint64_t expected_calls = psm::metrics::kEnabled ? 1 : 0;
+  EXPECT_EQ(to_srgb.calls, expected_calls);
+  EXPECT_EQ(to_srgb.pixels, expected_calls * 100);
+  EXPECT_EQ(from_srgb.calls, expected_calls);
+  EXPECT_EQ(from_srgb.pixels, expected_calls * 10);
+  EXPECT_EQ(unused.calls, 0);
+}
+
+TEST_F(MetricsTest, ResetClearsCounters) {
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(src, dst);
+  psm::metrics::Reset();
+
+  const auto snapshot = psm::metrics::Collect();
+  EXPECT_EQ(
+      snapshot.conversion(Module::AdobeRGB, Module::sRGB, PixelType::UInt8)
+          .calls,
+      0);
+}
+
+TEST_F(MetricsTest, LabelsAreReadable) {
+  EXPECT_EQ(psm::metrics::toString(Module::ProPhotoRGB), "ProPhotoRGB");
+  EXPECT_EQ(psm::metrics::toString(Stage::FromSRGB), "fromSRGB");
+  EXPECT_EQ(psm::metrics::toString(PixelType::UInt16), "uint16");
+}
+
+}  // namespace psm_test::metrics
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "psm/adjust_channels.hpp"
+#include "psm/psm.hpp"
+#include "psm/rgba.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::rgba {
+
+template <typename T>
+std::vector<T> colorChannels(const std::vector<T>& rgba) {
+  std::vector<T> rgb;
+  for (std::size_t i = 0; i < rgba.size(); i += 4) {
+    rgb.insert(rgb.end(), {rgba[i], rgba[i + 1], rgba[i + 2]});
+  }
+  return rgb;
+}
+
+template <typename T>
+std::vector<T> alphaChannel(const std::vector<T>& rgba) {
+  std::vector<T> alpha;
+  for (std::size_t i = 3; i < rgba.size(); i += 4) {
+    alpha.push_back(rgba[i]);
+  }
+  return alpha;
+}
+
+class RGBATest : public ::testing::Test {
+ protected:
+  // More pixels than one band, ending in a partial band
+  static constexpr std::size_t pixels = 4096 * 2 + 123;
+
+  void SetUp() override {
+    rgba8.resize(pixels * 4);
+    rgba16.resize(pixels * 4);
+    for (std::size_t i = 0; i < rgba8.size(); ++i) {
+      rgba8[i] = static_cast<std::uint8_t>((i * 37 + i / 4) % 256);
+      rgba16[i] = static_cast<std::uint16_t>((i * 4099 + i / 4) % 65536);
+    }
+  }
+
+  std::vector<std::uint8_t> rgba8;
+  std::vector<std::uint16_t> rgba16;
+};
+
+TEST_F(RGBATest, ColorMatchesConvertOfRgb) {
+  const auto rgb = colorChannels(rgba8);
+  std::vector<std::uint8_t> expected(rgb.size());
+  psm::Convert<psm::sRGB, psm::AdobeRGB>(rgb, expected);
+
+  std::vector<std::uint8_t> out(rgba8.size());
+  psm::ConvertRGBA<psm::sRGB, psm::AdobeRGB>(rgba8, out);
+
+  EXPECT_EQ(colorChannels(out), expected);
+  EXPECT_EQ(alphaChannel(out), alphaChannel(rgba8));
+}
+
+TEST_F(RGBATest, SixteenBitAlphaPassesThrough) {
+  const auto rgb = colorChannels(rgba16);
+  std::vector<std::uint16_t> expected(rgb.size());
+  psm::Convert<psm::AdobeRGB, psm::sRGB>(rgb, expected);
+
+  std::vector<std::uint16_t> out(rgba16.size());
+  psm::ConvertRGBA<psm::AdobeRGB, psm::sRGB>(rgba16, out);
+
+  EXPECT_EQ(colorChannels(out), expected);
+  EXPECT_EQ(alphaChannel(out), alphaChannel(rgba16));
+}
+
+TEST_F(RGBATest, ConvertsInPlace) {
+  std::vector<std::uint8_t> expected(rgba8.size());
+  psm::ConvertRGBA<psm::sRGB, psm::AdobeRGB>(rgba8, expected);
+
+  psm::ConvertRGBA<psm::sRGB, psm::AdobeRGB>(rgba8, rgba8);
+
+  EXPECT_EQ(rgba8, expected);
+}
+
+TEST_F(RGBATest, AdjustLeavesAlpha) {
+  auto rgb = colorChannels(rgba8);
+  const psm::Percent percent(20, -30, 0);
+  psm::AdjustChannels(rgb, percent);
+
+  auto out = rgba8;
+  psm::AdjustChannelsRGBA(out, percent);
+
+  EXPECT_EQ(colorChannels(out), rgb);
+  EXPECT_EQ(alphaChannel(out), alphaChannel(rgba8));
+}
+
+TEST_F(RGBATest, TransformSeesWholeBands) {
+  std::size_t calls = 0;
+  std::size_t samples = 0;
+  std::vector<std::uint8_t> out(rgba8.size());
+  psm::TransformRGBA<std::uint8_t>(
+      rgba8, out,
+      [&](std::span<const std::uint8_t> rgb_in,
+          std::span<std::uint8_t> rgb_out) {
+        ++calls;
+        samples += rgb_in.size();
+        ASSERT_EQ(rgb_in.size(), rgb_out.size());
+        std::copy(rgb_in.begin(), rgb_in.end(), rgb_out.begin());
+      });
+
+  EXPECT_EQ(calls, 3u);
+  EXPECT_EQ(samples, pixels * 3);
+  EXPECT_EQ(out, rgba8);
+}
+
+TEST_F(RGBATest, BandBuffersAreTrackedScratch) {
+  std::vector<std::uint16_t> out(rgba16.size());
+  const auto stats = ScratchUsage([&] {
+    psm::TransformRGBA<std::uint16_t>(
+        rgba16, out,
+        [](std::span<const std::uint16_t> rgb_in,
+           std::span<std::uint16_t> rgb_out) {
+          std::copy(rgb_in.begin(), rgb_in.end(), rgb_out.begin());
+        });
+  });
+
+  // One RGB band in and one out, whatever the image size
+  const std::size_t band_bytes = 4096 * 3 * sizeof(std::uint16_t);
+  EXPECT_EQ(stats.allocations, 2u);
+  EXPECT_EQ(stats.bytes_allocated, 2 * band_bytes);
+  EXPECT_EQ(stats.peak_bytes, 2 * band_bytes);
+}
+
+TEST_F(RGBATest, RejectsMismatchedBuffers) {
+  std::vector<std::uint8_t> partial(rgba8.begin(), rgba8.end() - 1);
+  std::vector<std::uint8_t> out(partial.size());
+  EXPECT_THROW((psm::ConvertRGBA<psm::sRGB, psm::AdobeRGB>(partial, out)),
+               std::invalid_argument);
+
+  std::vector<std::uint8_t> small(rgba8.size() - 4);
+  EXPECT_THROW((psm::ConvertRGBA<psm::sRGB, psm::AdobeRGB>(rgba8, small)),
+               std::invalid_argument);
+}
+
+}  // namespace psm_test::rgba
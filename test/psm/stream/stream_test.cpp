@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "psm/psm.hpp"
+#include "psm/stream.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::stream {
+
+using Stream = psm::StreamConverter<psm::AdobeRGB, psm::sRGB, unsigned char>;
+
+class StreamTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    src.resize(3000);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+      src[i] = static_cast<unsigned char>(i * 7);
+    }
+    expected.resize(src.size());
+    psm::Convert<psm::AdobeRGB, psm::sRGB>(src, expected);
+  }
+
+  std::vector<unsigned char> src;
+  std::vector<unsigned char> expected;
+};
+
+TEST_F(StreamTest, UnalignedPushesMatchConvert) {
+  Stream stream(64);
+  std::vector<unsigned char> out;
+  const auto sink = [&](std::span<const unsigned char> converted) {
+    out.insert(out.end(), converted.begin(), converted.end());
+  };
+
+  const std::span<const unsigned char> input{src};
+  const std::size_t sizes[] = {1, 1, 2, 5, 7, 300, 1000, 4};
+  std::size_t offset = 0;
+  for (std::size_t i = 0; offset < input.size(); ++i) {
+    const std::size_t size =
+        std::min(sizes[i % std::size(sizes)], input.size() - offset);
+    stream.push(input.subspan(offset, size), sink);
+    offset += size;
+  }
+  stream.finish();
+
+  EXPECT_EQ(out, expected);
+}
+
+TEST_F(StreamTest, SinkChunksAreBounded) {
+  Stream stream(100);
+  std::size_t largest = 0;
+
+  stream.push(std::span<const unsigned char>{src},
+              [&](std::span<const unsigned char> converted) {
+                largest = std::max(largest, converted.size());
+              });
+
+  EXPECT_EQ(largest, 100 * 3);
+}
+
+TEST_F(StreamTest, CarriesPartialPixel) {
+  Stream stream;
+  std::size_t emitted = 0;
+  const auto sink = [&](std::span<const unsigned char> converted) {
+    emitted += converted.size();
+  };
+
+  stream.push(std::span<const unsigned char>{src}.first(4), sink);
+  EXPECT_EQ(emitted, 3);
+  EXPECT_EQ(stream.pending(), 1);
+
+  stream.push(std::span<const unsigned char>{src}.subspan(4, 1), sink);
+  EXPECT_EQ(emitted, 3);
+  EXPECT_EQ(stream.pending(), 2);
+
+  stream.push(std::span<const unsigned char>{src}.subspan(5, 1), sink);
+  EXPECT_EQ(emitted, 6);
+  EXPECT_EQ(stream.pending(), 0);
+}
+
+TEST_F(StreamTest, PullIntoCallerBuffer) {
+  Stream stream;
+  std::vector<unsigned char> out(src.size());
+  const std::span<const unsigned char> input{src};
+
+  auto first = stream.push(input.first(1001), std::span{out});
+  EXPECT_EQ(first.size(), 999);
+  auto second =
+      stream.push(input.subspan(1001), std::span{out}.subspan(first.size()));
+  EXPECT_EQ(first.size() + second.size(), out.size());
+  stream.finish();
+
+  EXPECT_EQ(out, expected);
+}
+
+TEST_F(StreamTest, PullRejectsShortOutput) {
+  Stream stream;
+  std::vector<unsigned char> out(5);
+
+  EXPECT_THROW(stream.push(std::span<const unsigned char>{src}.first(6),
+                           std::span{out}),
+               std::invalid_argument);
+}
+
+TEST_F(StreamTest, FinishRejectsPartialPixel) {
+  Stream stream;
+  stream.push(std::span<const unsigned char>{src}.first(2),
+              [](std::span<const unsigned char>) {});
+
+  EXPECT_THROW(stream.finish(), std::invalid_argument);
+  EXPECT_EQ(stream.pending(), 0);
+}
+
+TEST_F(StreamTest, ScratchIsBoundedByChunkSize) {
+  Stream stream(50);
+
+  const auto stats = ScratchUsage([&] {
+    stream.push(std::span<const unsigned char>{src},
+                [](std::span<const unsigned char>) {});
+  });
+
+  EXPECT_LE(stats.peak_bytes, 2 * 50 * 3 * sizeof(float));
+}
+
+TEST_F(StreamTest, SixteenBitRows) {
+  const std::vector<std::uint16_t> row = {0, 1000, 65535, 30000, 2, 40000};
+  std::vector<std::uint16_t> bulk(row.size());
+  psm::Convert<psm::sRGB, psm::ProPhotoRGB>(row, bulk);
+
+  psm::StreamConverter<psm::sRGB, psm::ProPhotoRGB, std::uint16_t> stream;
+  std::vector<std::uint16_t> out(row.size());
+  stream.push(std::span<const std::uint16_t>{row}, std::span{out});
+
+  EXPECT_EQ(out, bulk);
+}
+
+}  // namespace psm_test::stream
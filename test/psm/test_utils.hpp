@@ -3,10 +3,28 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <utility>
 #include <vector>
 
+#include "psm/memory.hpp"
+
 namespace psm_test {
 
+/**
+ * @brief Runs @p fn and returns the psm scratch memory it used
+ *
+ * @code
+ * const auto stats = ScratchUsage([&] { psm::Convert<...>(src, dst); });
+ * EXPECT_LE(stats.allocations, 2);
+ * @endcode
+ */
+template <typename Fn>
+psm::memory::Stats ScratchUsage(Fn&& fn) {
+  const psm::memory::ScopedTracker tracker;
+  std::forward<Fn>(fn)();
+  return tracker.stats();
+}
+
 MATCHER_P2(IsNearVector, expected, tolerance, "") {
   const auto& actual = arg;
   if (actual.size() != expected.size()) {
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <ranges>
+#include <stdexcept>
+#include <vector>
+
+#include "psm/psm.hpp"
+#include "psm/views.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::views {
+
+class ViewsTest : public ::testing::Test {
+ protected:
+  static constexpr std::size_t PixelCount = 64;
+
+  void SetUp() override {
+    for (std::size_t i = 0; i < PixelCount; ++i) {
+      const auto v = static_cast<unsigned char>(i * 4);
+      pixels.push_back({v, static_cast<unsigned char>(255 - v), 128});
+      samples.insert(samples.end(), pixels.back().begin(),
+                     pixels.back().end());
+    }
+    expected.resize(samples.size());
+    psm::Convert<psm::AdobeRGB, psm::sRGB>(samples, expected);
+  }
+
+  psm::Pixel<unsigned char> Expected(std::size_t pixel) const {
+    return {expected[pixel * 3], expected[pixel * 3 + 1],
+            expected[pixel * 3 + 2]};
+  }
+
+  std::vector<psm::Pixel<unsigned char>> pixels;
+  std::vector<unsigned char> samples;
+  std::vector<unsigned char> expected;
+};
+
+TEST_F(ViewsTest, PixelRangeMatchesConvert) {
+  std::size_t i = 0;
+  for (const auto& pixel :
+       pixels | psm::views::convert<psm::AdobeRGB, psm::sRGB>) {
+    EXPECT_EQ(pixel, Expected(i++));
+  }
+  EXPECT_EQ(i, PixelCount);
+}
+
+TEST_F(ViewsTest, SampleRangeMatchesConvert) {
+  const auto view = psm::views::convert<psm::AdobeRGB, psm::sRGB>(samples);
+
+  ASSERT_EQ(std::ranges::size(view), PixelCount);
+  for (std::size_t i = 0; i < PixelCount; ++i) {
+    EXPECT_EQ(view[i], Expected(i));
+  }
+}
+
+TEST_F(ViewsTest, ComposesWithTakeAndDrop) {
+  auto row = samples | psm::views::convert<psm::AdobeRGB, psm::sRGB> |
+             std::views::drop(8) | std::views::take(8);
+
+  std::size_t i = 8;
+  for (const auto& pixel : row) {
+    EXPECT_EQ(pixel, Expected(i++));
+  }
+  EXPECT_EQ(i, 16);
+}
+
+TEST_F(ViewsTest, ComposesWithFilter) {
+  auto bright = pixels | psm::views::convert<psm::AdobeRGB, psm::sRGB> |
+                std::views::filter([](const auto& p) { return p[0] > 200; });
+
+  for (const auto& pixel : bright) {
+    EXPECT_GT(pixel[0], 200);
+  }
+}
+
+#if defined(__cpp_lib_ranges_stride)
+TEST_F(ViewsTest, ComposesWithStride) {
+  auto sampled = samples | psm::views::convert<psm::AdobeRGB, psm::sRGB> |
+                 std::views::stride(16);
+
+  std::size_t i = 0;
+  for (const auto& pixel : sampled) {
+    EXPECT_EQ(pixel, Expected(i));
+    i += 16;
+  }
+  EXPECT_EQ(i, PixelCount);
+}
+#endif
+
+TEST_F(ViewsTest, ConvertsOnlyDereferencedPixels) {
+  std::size_t reads = 0;
+  auto counted = pixels | std::views::transform([&reads](const auto& p) {
+                   ++reads;
+                   return p;
+                 });
+
+  auto first = counted | psm::views::convert<psm::AdobeRGB, psm::sRGB> |
+               std::views::take(3);
+  EXPECT_EQ(reads, 0);
+
+  for (const auto& pixel : first) {
+    static_cast<void>(pixel);
+  }
+  EXPECT_EQ(reads, 3);
+}
+
+TEST_F(ViewsTest, DoesNotAllocateScratch) {
+  const auto stats = ScratchUsage([&] {
+    for (const auto& pixel :
+         samples | psm::views::convert<psm::AdobeRGB, psm::sRGB>) {
+      static_cast<void>(pixel);
+    }
+  });
+
+  EXPECT_EQ(stats.allocations, 0);
+}
+
+TEST_F(ViewsTest, SixteenBitSamples) {
+  const std::vector<std::uint16_t> src = {65535, 0, 0, 0, 65535, 0};
+  std::vector<std::uint16_t> bulk(src.size());
+  psm::Convert<psm::sRGB, psm::ProPhotoRGB>(src, bulk);
+
+  const auto view = psm::views::convert<psm::sRGB, psm::ProPhotoRGB>(src);
+  EXPECT_EQ(view[1], (psm::Pixel<std::uint16_t>{bulk[3], bulk[4], bulk[5]}));
+}
+
+TEST_F(ViewsTest, InvalidSampleCount) {
+  const std::vector<unsigned char> src = {1, 2, 3, 4};
+  EXPECT_THROW((psm::views::convert<psm::sRGB, psm::AdobeRGB>(src)),
+               std::invalid_argument);
+}
+
+}  // namespace psm_test::views
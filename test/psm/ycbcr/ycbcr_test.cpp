@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "psm/psm.hpp"
+#include "psm/ycbcr.hpp"
+#include "test_utils.hpp"
+
+namespace psm_test::ycbcr {
+
+using psm_test::IsNearVector;
+
+// JFIF R'G'B' to full-range YCbCr, the inverse of what ConvertYCbCr applies
+struct Planar {
+  std::vector<std::uint8_t> y;
+  std::vector<std::uint8_t> cb;
+  std::vector<std::uint8_t> cr;
+};
+
+std::uint8_t toSample(double value) {
+  return static_cast<std::uint8_t>(
+      std::clamp(std::round(value), 0.0, 255.0));
+}
+
+Planar toYCbCr(const std::vector<std::uint8_t>& rgb) {
+  Planar planar;
+  for (std::size_t i = 0; i < rgb.size(); i += 3) {
+    const double r = rgb[i];
+    const double g = rgb[i + 1];
+    const double b = rgb[i + 2];
+    planar.y.push_back(toSample(0.299 * r + 0.587 * g + 0.114 * b));
+    planar.cb.push_back(
+        toSample(-0.168736 * r - 0.331264 * g + 0.5 * b + 128.0));
+    planar.cr.push_back(
+        toSample(0.5 * r - 0.418688 * g - 0.081312 * b + 128.0));
+  }
+  return planar;
+}
+
+psm::YCbCrPlanes fullResolution(const Planar& planar, std::size_t width,
+                                std::size_t height) {
+  return {.y = planar.y,
+          .cb = planar.cb,
+          .cr = planar.cr,
+          .width = width,
+          .height = height,
+          .y_stride = width,
+          .chroma_stride = width};
+}
+
+class YCbCrTest : public ::testing::Test {
+ protected:
+  static constexpr std::size_t width = 37;
+  static constexpr std::size_t height = 29;
+
+  void SetUp() override {
+    rgb.resize(width * height * 3);
+    for (std::size_t i = 0; i < rgb.size(); ++i) {
+      rgb[i] = static_cast<std::uint8_t>((i * 37 + i / 3) % 256);
+    }
+  }
+
+  std::vector<std::uint8_t> rgb;
+};
+
+TEST_F(YCbCrTest, FullResolutionRecoversRgb) {
+  const Planar planar = toYCbCr(rgb);
+  std::vector<std::uint8_t> out(rgb.size());
+
+  psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(fullResolution(planar, width, height),
+                                          out);
+
+  // One unit from quantizing the YCbCr samples, one from rounding back
+  EXPECT_THAT(out, IsNearVector(rgb, 2));
+}
+
+TEST_F(YCbCrTest, MatchesConvertOfDecodedRgb) {
+  const Planar planar = toYCbCr(rgb);
+  const auto planes = fullResolution(planar, width, height);
+
+  std::vector<std::uint8_t> decoded(rgb.size());
+  psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, decoded);
+  std::vector<std::uint8_t> expected(rgb.size());
+  psm::Convert<psm::sRGB, psm::AdobeRGB>(decoded, expected);
+
+  std::vector<std::uint8_t> out(rgb.size());
+  psm::ConvertYCbCr<psm::sRGB, psm::AdobeRGB>(planes, out);
+
+  EXPECT_EQ(out, expected);
+}
+
+TEST_F(YCbCrTest, UpsamplesSubsampledChroma) {
+  // 4:2:0 with an odd width, luma padded to a whole MCU like TurboJPEG
+  const std::size_t y_stride = width + 1;
+  const std::size_t chroma_width = (width + 1) / 2;
+  const std::size_t chroma_height = (height + 1) / 2;
+
+  std::vector<std::uint8_t> y(y_stride * height, 120);
+  std::vector<std::uint8_t> cb(chroma_width * chroma_height, 90);
+  std::vector<std::uint8_t> cr(chroma_width * chroma_height, 170);
+  const psm::YCbCrPlanes planes{.y = y,
+                                .cb = cb,
+                                .cr = cr,
+                                .width = width,
+                                .height = height,
+                                .y_stride = y_stride,
+                                .chroma_stride = chroma_width,
+                                .subsample_x = 2,
+                                .subsample_y = 2};
+
+  std::vector<std::uint8_t> out(width * height * 3);
+  psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, out);
+
+  // Constant chroma upsamples to itself
+  const std::uint8_t r = toSample(120.0 + 1.402 * 42.0);
+  const std::uint8_t g = toSample(120.0 + 0.344136 * 38.0 - 0.714136 * 42.0);
+  const std::uint8_t b = toSample(120.0 - 1.772 * 38.0);
+  for (std::size_t i = 0; i < out.size(); i += 3) {
+    ASSERT_EQ(out[i], r) << "pixel " << i / 3;
+    ASSERT_EQ(out[i + 1], g) << "pixel " << i / 3;
+    ASSERT_EQ(out[i + 2], b) << "pixel " << i / 3;
+  }
+}
+
+TEST_F(YCbCrTest, UpsamplingInterpolatesBetweenChromaSamples) {
+  // 4:2:2 single row: chroma steps from 128 to 228 halfway
+  const std::vector<std::uint8_t> y(4, 128);
+  const std::vector<std::uint8_t> cb(2, 128);
+  const std::vector<std::uint8_t> cr{128, 228};
+  const psm::YCbCrPlanes planes{.y = y,
+                                .cb = cb,
+                                .cr = cr,
+                                .width = 4,
+                                .height = 1,
+                                .y_stride = 4,
+                                .chroma_stride = 2,
+                                .subsample_x = 2};
+
+  std::vector<std::uint8_t> out(12);
+  psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, out);
+
+  // Cr seen by each pixel: 128, 153, 203, 228
+  EXPECT_EQ(out[0], 128);
+  EXPECT_EQ(out[3], toSample(128.0 + 1.402 * 25.0));
+  EXPECT_EQ(out[6], toSample(128.0 + 1.402 * 75.0));
+  EXPECT_EQ(out[9], toSample(128.0 + 1.402 * 100.0));
+}
+
+TEST_F(YCbCrTest, GrayscaleHasNoChroma) {
+  std::vector<std::uint8_t> y(width * height);
+  for (std::size_t i = 0; i < y.size(); ++i) {
+    y[i] = static_cast<std::uint8_t>(i);
+  }
+  const psm::YCbCrPlanes planes{
+      .y = y, .width = width, .height = height, .y_stride = width};
+
+  std::vector<std::uint8_t> out(width * height * 3);
+  psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, out);
+
+  for (std::size_t i = 0; i < y.size(); ++i) {
+    ASSERT_EQ(out[i * 3], y[i]);
+    ASSERT_EQ(out[i * 3 + 1], y[i]);
+    ASSERT_EQ(out[i * 3 + 2], y[i]);
+  }
+}
+
+TEST_F(YCbCrTest, WorkingBuffersAreTrackedScratch) {
+  const Planar planar = toYCbCr(rgb);
+  const auto planes = fullResolution(planar, width, height);
+  std::vector<std::uint8_t> out(rgb.size());
+
+  const auto stats = ScratchUsage(
+      [&] { psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, out); });
+
+  // The column taps and one band, which covers this small image whole
+  const std::size_t tap_bytes = width * sizeof(psm::detail::UpsampleTap);
+  const std::size_t band_bytes = width * height * 3;
+  EXPECT_EQ(stats.allocations, 2u);
+  EXPECT_EQ(stats.bytes_allocated, tap_bytes + band_bytes);
+  EXPECT_EQ(stats.peak_bytes, tap_bytes + band_bytes);
+
+  // Grayscale needs no taps
+  const psm::YCbCrPlanes gray{
+      .y = planar.y, .width = width, .height = height, .y_stride = width};
+  const auto gray_stats = ScratchUsage(
+      [&] { psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(gray, out); });
+  EXPECT_EQ(gray_stats.allocations, 1u);
+  EXPECT_EQ(gray_stats.bytes_allocated, band_bytes);
+}
+
+TEST_F(YCbCrTest, RejectsMismatchedBuffers) {
+  const Planar planar = toYCbCr(rgb);
+  const auto planes = fullResolution(planar, width, height);
+
+  std::vector<std::uint8_t> small(rgb.size() - 3);
+  EXPECT_THROW((psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(planes, small)),
+               std::invalid_argument);
+
+  auto short_luma = planes;
+  short_luma.y = short_luma.y.first(short_luma.y.size() - 1);
+  std::vector<std::uint8_t> out(rgb.size());
+  EXPECT_THROW((psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(short_luma, out)),
+               std::invalid_argument);
+
+  auto short_chroma = planes;
+  short_chroma.cr = short_chroma.cr.first(10);
+  EXPECT_THROW((psm::ConvertYCbCr<psm::sRGB, psm::sRGB>(short_chroma, out)),
+               std::invalid_argument);
+}
+
+}  // namespace psm_test::ycbcr